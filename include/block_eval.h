@@ -0,0 +1,40 @@
+#ifndef __BLOCK_EVAL_H_DEFINED__
+#define __BLOCK_EVAL_H_DEFINED__
+
+#include <vector>
+
+#include "formula.h"
+
+namespace HyperPLTL {
+
+/**
+ * BlockEvaluator evaluates a formula at every cycle of a set of traces at
+ * once, 64 cycles to a word: bit c % 64 of word c / 64 is the value eval()
+ * returns at cycle c when the formula is evaluated from the last cycle down
+ * to 0, as evaluateTraces() does.
+ *
+ * Atoms are computed from the change points of the traces, connectives are
+ * bitwise operations on whole words, and temporal operators are scans over
+ * the words from the last cycle down. The cost is one pass over the words
+ * per node instead of a call per node per cycle.
+ */
+class BlockEvaluator {
+  const TraceList traces;
+
+  using Bits = std::vector<uint64_t>;
+
+  Bits eval(const HyperProp* f, uint32_t top);
+  Bits equal(unsigned var, bool array, uint32_t top);
+
+ public:
+  /** The evaluator keeps its own list of the traces, so traces may be a
+      temporary. */
+  explicit BlockEvaluator(TraceList traces);
+
+  /** Return the values of formula, as newly constructed, at every cycle. */
+  Bits evaluate(PHyperProp formula);
+};
+
+}  // namespace HyperPLTL
+
+#endif
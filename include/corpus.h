@@ -0,0 +1,127 @@
+#ifndef __CORPUS_H_DEFINED__
+#define __CORPUS_H_DEFINED__
+
+#include <iterator>
+#include <string>
+
+#include "formula.h"
+
+/*
+ * A corpus file holds many traces over the same signals:
+ *
+ *   header | schema | table | trace 0 | ... | trace k - 1 | table | trace k ...
+ *
+ * The schema lists the signals of the VarMap the traces were recorded
+ * against. Traces are stored in the order they were added, each as written
+ * by TraceSerialize::store(), so reading the corpus in order reads the file
+ * sequentially. Every append writes its traces and then a table of contents
+ * giving the offset, size, length and fingerprint of each of them, with the
+ * offset of the table before it; the header points to the newest table.
+ * The tables of a corpus take one entry per trace in all. The header is
+ * changed only once the traces and their table are on disk, so the corpus
+ * stays readable if adding is interrupted.
+ */
+
+/** Where a trace of a corpus is stored. */
+struct CorpusEntry {
+  uint64_t offset;
+  uint64_t size;
+  /// FNV-1a hash of the stored bytes, see Corpus::verify().
+  uint64_t fingerprint;
+  /// number of cycles of the trace.
+  uint32_t length;
+  uint32_t reserved;
+};
+
+/**
+ * Corpus reads the traces of a corpus file, which is mapped into memory as a
+ * whole: opening it is the only file operation, and a trace stored in
+ * TraceFormat::MAPPED is read in place. Traces can be added to an open
+ * corpus.
+ */
+class Corpus {
+  std::string path;
+  HyperPLTL::PVarMap varmap;
+  TraceFormat format;
+  std::vector<CorpusEntry> entries;
+  /// the mapped file, held by the views of its traces.
+  std::shared_ptr<const uint8_t> mapping;
+  size_t mappedSize;
+  /// offset of the newest table of contents.
+  uint64_t toc;
+
+  Corpus() = default;
+  bool map();
+
+ public:
+  /** Iterates over the traces of a corpus in order. */
+  class iterator {
+    const Corpus* corpus;
+    size_t index;
+
+   public:
+    using iterator_category = std::input_iterator_tag;
+    using value_type = PTrace;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const PTrace*;
+    using reference = PTrace;
+
+    iterator(const Corpus* corpus, size_t index) : corpus(corpus), index(index) {}
+    PTrace operator*() const { return corpus->trace(index); }
+    iterator& operator++() {
+      ++index;
+      return *this;
+    }
+    bool operator==(const iterator& other) const { return index == other.index; }
+    bool operator!=(const iterator& other) const { return index != other.index; }
+  };
+
+  /**
+   * Create an empty corpus at path for traces over the signals of varmap,
+   * stored in format, and open it; return nullptr if it can not be written.
+   */
+  static std::shared_ptr<Corpus> create(const std::string& path,
+                                        HyperPLTL::PVarMap varmap,
+                                        TraceFormat format = TraceFormat::CHANGES);
+
+  /** Open the corpus at path; return nullptr if it can not be read. */
+  static std::shared_ptr<Corpus> open(const std::string& path);
+
+  /** Return the signals the traces were recorded against. */
+  HyperPLTL::PVarMap getVarMap() const { return varmap; }
+
+  /** Return the number of traces. */
+  size_t size() const { return entries.size(); }
+
+  const CorpusEntry& entry(size_t i) const {
+    assert(i < entries.size());
+    return entries[i];
+  }
+
+  /** Return trace i, loaded from the mapped file or viewed in place. */
+  PTrace trace(size_t i) const;
+
+  /** Return traces first to last - 1, ready for evaluation. */
+  TraceList traces(size_t first, size_t last) const;
+
+  iterator begin() const { return iterator(this, 0); }
+  iterator end() const { return iterator(this, entries.size()); }
+
+  /** Return true if the stored bytes of trace i match its fingerprint. */
+  bool verify(size_t i) const;
+
+  /**
+   * Store traces at the end of the corpus. The traces and their table are
+   * synced to disk before the header points to them, and the header is
+   * synced in turn, so an interrupted append leaves the corpus as it was.
+   * Return false if the traces could not be stored, or the file could not
+   * be mapped again once they were; the corpus then still reads the traces
+   * it had, and reopening the file reads those that were stored. Traces and
+   * views obtained before stay valid.
+   */
+  bool append(const TraceList& traces);
+};
+
+typedef std::shared_ptr<Corpus> PCorpus;
+
+#endif
@@ -3,6 +3,7 @@
 
 #include <iostream>
 #include <map>
+#include <memory>
 #include <string>
 #include <vector>
 #include "trace.h"
@@ -35,10 +36,16 @@ class VarMap {
   std::vector<std::string> varNames;
   std::vector<std::string> propNames;
   std::map<std::string, VarType> varInfo;
+  // declared dimension of each term variable, 0 if not fixed.
+  std::vector<uint32_t> varDims;
+  // declared bit width of the values of each term variable.
+  std::vector<uint32_t> varWidths;
 
  public:
   unsigned addArrayVar(const std::string&);
-  unsigned addIntVar(const std::string&);
+  unsigned addArrayVar(const std::string&, uint32_t dim,
+                       uint32_t width = Trace::MAX_WIDTH);
+  unsigned addIntVar(const std::string&, uint32_t width = Trace::MAX_WIDTH);
   unsigned addPropVar(const std::string&);
   unsigned addVar(const std::string&, VarType);
 
@@ -46,6 +53,17 @@ class VarMap {
   unsigned getPropIndex(const std::string& name) const;
   VarType getVarType(const std::string& name) const;
   const std::string& getVarName(unsigned i) const;
+  const std::string& getPropName(unsigned i) const;
+  uint32_t getArrayDim(unsigned i) const;
+  uint32_t getVarWidth(unsigned i) const;
+
+  unsigned numVars() const { return varNames.size(); }
+  unsigned numProps() const { return propNames.size(); }
+
+  // create an empty trace with room for every variable in the map; each term
+  // variable is declared with its type (and array dimension and bit width) so
+  // that its signal handle can be obtained right away.
+  PTrace createTrace() const;
 
   bool hasVar(const std::string& name);
   bool hasArrayVar(const std::string& name);
@@ -54,12 +72,73 @@ class VarMap {
   bool empty() { return varInfo.empty(); }
 };
 
+/**
+ * EvalState holds everything evaluating a formula changes: the state of its
+ * temporal operators and the datapoint each variable last read in each
+ * trace. Every node of a formula is given a fixed part of the state when the
+ * formula is built, its own first and then those of its arguments in order,
+ * so evaluation never modifies the formula and one formula may be evaluated
+ * with many states at once, e.g. one per thread.
+ */
+class EvalState {
+  std::vector<uint8_t> flags;
+  std::vector<uint8_t> initial;
+  std::vector<size_t> hints;
+  uint32_t numLeaves;
+  size_t numTraces;
+
+ public:
+  /// the part of a state that belongs to a subformula; each variable has a
+  /// row of hints with one per trace.
+  struct Ref {
+    uint8_t* flags;
+    size_t* hints;
+    size_t numTraces;
+  };
+
+  /** Create the state of formula before its first evaluation. */
+  explicit EvalState(const Formula& formula);
+
+  /** Return to the state before the first evaluation. */
+  void reset();
+
+  /** Return the state of the whole formula, to evaluate it over traces. */
+  Ref bind(const TraceList& traces) {
+    if (traces.size() != numTraces) {
+      numTraces = traces.size();
+      hints.assign(size_t(numLeaves) * numTraces, 0);
+    }
+    return Ref{flags.data(), hints.data(), numTraces};
+  }
+
+  /// Return the number of bytes of operator state.
+  size_t size() const { return flags.size(); }
+};
+
 class Formula {
  protected:
   PVarMap var_map;
   std::vector<PFormula> args;
-  // constructor.
-  Formula(PVarMap m) : var_map(m) {}
+  // bytes of operator state and rows of hints of the whole subformula, and
+  // where those of each argument start; see EvalState.
+  uint32_t stateSize;
+  uint32_t numLeaves;
+  std::vector<uint32_t> argFlags;
+  std::vector<uint32_t> argLeaves;
+
+  // constructor; ownState and ownLeaves are the parts of the state the node
+  // itself uses.
+  Formula(PVarMap m, uint32_t ownState = 0, uint32_t ownLeaves = 0)
+      : var_map(m), stateSize(ownState), numLeaves(ownLeaves) {}
+
+  // append an argument, placing its state after the state so far.
+  void addArg(PFormula f);
+
+  // the part of state that belongs to argument k.
+  EvalState::Ref argState(EvalState::Ref state, size_t k) const {
+    return EvalState::Ref{state.flags + argFlags[k],
+                          state.hints + argLeaves[k] * state.numTraces, state.numTraces};
+  }
 
  public:
   // write this formula to the screen.
@@ -71,36 +150,77 @@ class Formula {
   unsigned getPropId(std::string const& varName) {
     return var_map->getPropIndex(varName);
   }
+
+  // number of cycles before the present that the formula refers to, i.e. the
+  // nesting depth of X operators.
+  virtual unsigned historyDepth() const;
+
+  // add the signals the formula reads to projection.
+  virtual void collectSignals(TraceProjection& projection) const;
+
+  // subformulas, in the order they are evaluated.
+  const std::vector<PFormula>& getArgs() const { return args; }
+
+  uint32_t getStateSize() const { return stateSize; }
+  uint32_t getNumLeaves() const { return numLeaves; }
+
+  // write the state of the formula before its first evaluation to state.
+  virtual void initState(uint8_t* state) const;
 };
 
 // integer-sorted terms.
 class Term : public Formula {
  protected:
-  Term(PVarMap m) : Formula(m) {}
+  Term(PVarMap m) : Formula(m, 0, 1) {}
 
  public:
-  virtual ValueType termValue(uint32_t cycle, unsigned trace,
-                              const TraceList& traces) = 0;
+  // value in a particular trace; hints is the row of the variable.
+  virtual ValueType termValue(uint32_t cycle, unsigned trace, const TraceList& traces,
+                              size_t* hints) const = 0;
 };
 
 // trace propositions (booleans).
 class TraceProp : public Formula {
  protected:
-  TraceProp(PVarMap m) : Formula(m) {}
+  TraceProp(PVarMap m, uint32_t ownLeaves = 0) : Formula(m, 0, ownLeaves) {}
 
  public:
-  // evaluate the proposition in a particular trace.
-  virtual bool propValue(uint32_t cycle, unsigned trace, const TraceList& traces) = 0;
+  // evaluate the proposition in a particular trace; hints is the row of the
+  // proposition, as for Term::termValue().
+  virtual bool propValue(uint32_t cycle, unsigned trace, const TraceList& traces,
+                         size_t* hints) const = 0;
+
+  // evaluate the proposition over cycles 64w to 64w+63 of a particular trace;
+  // bit i of the result is the value at cycle 64w+i.
+  virtual uint64_t propWord(uint32_t w, unsigned trace, const TraceList& traces,
+                            size_t* hints) const = 0;
 };
 
 // hyper-propositions (defined over multiple traces).
 class HyperProp : public Formula {
+  // state of eval(cycle, traces), created on first use.
+  std::unique_ptr<EvalState> own;
+
  protected:
-  HyperProp(PVarMap m) : Formula(m) {}
+  HyperProp(PVarMap m, uint32_t ownState = 0) : Formula(m, ownState) {}
+
+  EvalState::Ref ownState(const TraceList& traces);
 
  public:
-  // evaluate the formula at this time index.
-  virtual bool eval(uint32_t cycle, const TraceList& traces) = 0;
+  // evaluate the formula at this time index, updating state.
+  bool eval(uint32_t cycle, const TraceList& traces, EvalState& state) const {
+    return evaluate(cycle, traces, state.bind(traces));
+  }
+
+  // evaluate the formula at this time index with a state kept by the formula
+  // itself, which can not then be evaluated by more than one thread.
+  bool eval(uint32_t cycle, const TraceList& traces) {
+    return evaluate(cycle, traces, ownState(traces));
+  }
+
+  // evaluate the formula given the part of the state that belongs to it.
+  virtual bool evaluate(uint32_t cycle, const TraceList& traces,
+                        EvalState::Ref state) const = 0;
 };
 
 /** Formula TermVar(name): this is an integer valued variable. */
@@ -109,9 +229,17 @@ class TermVar : public Term {
 
  public:
   TermVar(PVarMap m, unsigned i) : Term(m), index(i) {}
+  unsigned getIndex() const { return index; }
 
   virtual void display(std::ostream& out) const;
-  virtual ValueType termValue(uint32_t cycle, unsigned trace, const TraceList& traces);
+  virtual ValueType termValue(uint32_t cycle, unsigned trace, const TraceList& traces,
+                              size_t* hints) const;
+
+  // value in a trace, read through the trace's integer column; the trace
+  // must store the variable as an integer (see Trace::allTermKind).
+  uint32_t intValue(uint32_t cycle, unsigned trace, const TraceList& traces,
+                    size_t* hints) const;
+  virtual void collectSignals(TraceProjection& projection) const;
 };
 
 class TermArrayVar : public Term {
@@ -119,9 +247,17 @@ class TermArrayVar : public Term {
 
  public:
   TermArrayVar(PVarMap m, unsigned vi) : Term(m), index(vi) {}
+  unsigned getIndex() const { return index; }
 
   virtual void display(std::ostream& out) const;
-  virtual ValueType termValue(uint32_t cycle, unsigned trace, const TraceList& traces);
+  virtual ValueType termValue(uint32_t cycle, unsigned trace, const TraceList& traces,
+                              size_t* hints) const;
+
+  // view of the value in a trace, valid until that trace is updated; the
+  // trace must store the variable as an array.
+  ArrayView arrayValue(uint32_t cycle, unsigned trace, const TraceList& traces,
+                       size_t* hints) const;
+  virtual void collectSignals(TraceProjection& projection) const;
 };
 
 /** Formula PropVar(name): this is a boolean variable. */
@@ -129,10 +265,15 @@ class PropVar : public TraceProp {
   unsigned index;
 
  public:
-  PropVar(PVarMap m, unsigned i) : TraceProp(m), index(i) {}
+  PropVar(PVarMap m, unsigned i) : TraceProp(m, 1), index(i) {}
+  unsigned getIndex() const { return index; }
 
   virtual void display(std::ostream& out) const;
-  virtual bool propValue(uint32_t cycle, unsigned trace, const TraceList& traces);
+  virtual bool propValue(uint32_t cycle, unsigned trace, const TraceList& traces,
+                         size_t* hints) const;
+  virtual uint64_t propWord(uint32_t w, unsigned trace, const TraceList& traces,
+                            size_t* hints) const;
+  virtual void collectSignals(TraceProjection& projection) const;
 };
 
 /** Formula true. */
@@ -141,16 +282,32 @@ class True : public TraceProp {
   True(PVarMap m) : TraceProp(m) {}
 
   virtual void display(std::ostream& out) const;
-  virtual bool propValue(uint32_t cycle, unsigned trace, const TraceList& traces);
+  virtual bool propValue(uint32_t cycle, unsigned trace, const TraceList& traces,
+                         size_t* hints) const;
+  virtual uint64_t propWord(uint32_t w, unsigned trace, const TraceList& traces,
+                            size_t* hints) const;
 };
 
 /** Predicate (eq v_1,v_2,...,v_n). */
 class Equal : public HyperProp {
+  // the argument, resolved to its concrete type once at construction.
+  TermVar* intArg;
+  TermArrayVar* arrayArg;
+
  public:
-  Equal(PVarMap m, PTerm term) : HyperProp(m) { args.push_back(term); }
-  Equal(PVarMap m, PTermArray termArr) : HyperProp(m) { args.push_back(termArr); }
+  Equal(PVarMap m, PTerm term)
+      : HyperProp(m),
+        intArg(dynamic_cast<TermVar*>(term.get())),
+        arrayArg(dynamic_cast<TermArrayVar*>(term.get())) {
+    addArg(term);
+  }
+  Equal(PVarMap m, PTermArray termArr)
+      : HyperProp(m), intArg(nullptr), arrayArg(termArr.get()) {
+    addArg(termArr);
+  }
   virtual void display(std::ostream& out) const;
-  virtual bool eval(uint32_t cycle, const TraceList& traces);
+  virtual bool evaluate(uint32_t cycle, const TraceList& traces,
+                        EvalState::Ref state) const;
 };
 
 /** TraceSelect. */
@@ -159,110 +316,132 @@ class TraceSelect : public HyperProp {
 
  public:
   TraceSelect(PVarMap m, unsigned tr, PTraceProp p) : HyperProp(m), trace(tr) {
-    args.push_back(p);
+    addArg(p);
   }
+  unsigned getTrace() const { return trace; }
   virtual void display(std::ostream& out) const;
-  virtual bool eval(uint32_t cycle, const TraceList& traces);
+  virtual bool evaluate(uint32_t cycle, const TraceList& traces,
+                        EvalState::Ref state) const;
+
+  // evaluate the selection over cycles 64w to 64w+63, see TraceProp::propWord.
+  uint64_t evalWord(uint32_t w, const TraceList& traces);
+  uint64_t evalWord(uint32_t w, const TraceList& traces, EvalState::Ref state) const;
 };
 
 /** Formula !a */
 class Not : public HyperProp {
  public:
-  Not(PVarMap m, PHyperProp f) : HyperProp(m) { args.push_back(f); }
+  Not(PVarMap m, PHyperProp f) : HyperProp(m) { addArg(f); }
   virtual void display(std::ostream& out) const;
-  virtual bool eval(uint32_t cycle, const TraceList& traces);
+  virtual bool evaluate(uint32_t cycle, const TraceList& traces,
+                        EvalState::Ref state) const;
 };
 
 /** Formula a /\ b */
 class And : public HyperProp {
  public:
   And(PVarMap m, std::vector<PHyperProp> props) : HyperProp(m) {
-    std::copy(props.begin(), props.end(), std::back_inserter(args));
+    for (auto& p : props) addArg(p);
   }
   virtual void display(std::ostream& out) const;
-  virtual bool eval(uint32_t cycle, const TraceList& traces);
+  virtual bool evaluate(uint32_t cycle, const TraceList& traces,
+                        EvalState::Ref state) const;
 };
 
 /** Formula a \/ b */
 class Or : public HyperProp {
  public:
   Or(PVarMap m, std::vector<PHyperProp> props) : HyperProp(m) {
-    std::copy(props.begin(), props.end(), std::back_inserter(args));
+    for (auto& p : props) addArg(p);
   }
   virtual void display(std::ostream& out) const;
-  virtual bool eval(uint32_t cycle, const TraceList& traces);
+  virtual bool evaluate(uint32_t cycle, const TraceList& traces,
+                        EvalState::Ref state) const;
 };
 
 /** Formula a => b */
 class Implies : public HyperProp {
  public:
   Implies(PVarMap m, PHyperProp a, PHyperProp b) : HyperProp(m) {
-    args.push_back(a);
-    args.push_back(b);
+    addArg(a);
+    addArg(b);
   }
   virtual void display(std::ostream& out) const;
-  virtual bool eval(uint32_t cycle, const TraceList& traces);
+  virtual bool evaluate(uint32_t cycle, const TraceList& traces,
+                        EvalState::Ref state) const;
 };
 
 /** Formula G(phi). */
 class AlwaysPlus : public HyperProp {
-  bool past;
+  // state: the argument has held at every cycle so far.
 
  public:
-  AlwaysPlus(PVarMap m, PHyperProp f) : HyperProp(m), past(true) { args.push_back(f); }
+  AlwaysPlus(PVarMap m, PHyperProp f) : HyperProp(m, 1) { addArg(f); }
 
   virtual void display(std::ostream& out) const;
-  virtual bool eval(uint32_t cycle, const TraceList& traces);
+  virtual bool evaluate(uint32_t cycle, const TraceList& traces,
+                        EvalState::Ref state) const;
+  virtual void initState(uint8_t* state) const;
 };
 
 // pessimistic
 class AlwaysMinus : public HyperProp {
  public:
-  AlwaysMinus(PVarMap m, PHyperProp f) : HyperProp(m) { args.push_back(f); }
+  AlwaysMinus(PVarMap m, PHyperProp f) : HyperProp(m) { addArg(f); }
 
   virtual void display(std::ostream& out) const;
-  virtual bool eval(uint32_t cycle, const TraceList& traces);
+  virtual bool evaluate(uint32_t cycle, const TraceList& traces,
+                        EvalState::Ref state) const;
 };
 
 class NextPlus : public HyperProp {
-  bool present;
+  // state: the value of the argument at the previous cycle evaluated.
 
  public:
-  NextPlus(PVarMap m, PHyperProp f) : HyperProp(m), present(true) { args.push_back(f); }
+  NextPlus(PVarMap m, PHyperProp f) : HyperProp(m, 1) { addArg(f); }
 
   virtual void display(std::ostream& out) const;
-  virtual bool eval(uint32_t cycle, const TraceList& traces);
+  virtual bool evaluate(uint32_t cycle, const TraceList& traces,
+                        EvalState::Ref state) const;
+  virtual void initState(uint8_t* state) const;
+  virtual unsigned historyDepth() const;
 };
 
 class NextMinus : public HyperProp {
-  bool present;
+  // state: as for NextPlus.
 
  public:
   // initializing preent value to false ==> pessimistic
-  NextMinus(PVarMap m, PHyperProp f) : HyperProp(m), present(false) { args.push_back(f); }
+  NextMinus(PVarMap m, PHyperProp f) : HyperProp(m, 1) { addArg(f); }
 
   virtual void display(std::ostream& out) const;
-  virtual bool eval(uint32_t cycle, const TraceList& traces);
+  virtual bool evaluate(uint32_t cycle, const TraceList& traces,
+                        EvalState::Ref state) const;
+  virtual void initState(uint8_t* state) const;
+  virtual unsigned historyDepth() const;
 };
 
 class FutureMinus : public HyperProp {
-  bool valid;
+  // state: the argument has held at some cycle so far.
 
  public:
-  FutureMinus(PVarMap m, PHyperProp f) : HyperProp(m), valid(false) { args.push_back(f); }
+  FutureMinus(PVarMap m, PHyperProp f) : HyperProp(m, 1) { addArg(f); }
 
   virtual void display(std::ostream& out) const;
-  virtual bool eval(uint32_t cycle, const TraceList& traces);
+  virtual bool evaluate(uint32_t cycle, const TraceList& traces,
+                        EvalState::Ref state) const;
+  virtual void initState(uint8_t* state) const;
 };
 
 // optimistic
 class FuturePlus : public HyperProp {
 
  public:
-  FuturePlus(PVarMap m, PHyperProp f) : HyperProp(m) { args.push_back(f); }
+  FuturePlus(PVarMap m, PHyperProp f) : HyperProp(m) { addArg(f); }
 
   virtual void display(std::ostream& out) const;
-  virtual bool eval(uint32_t cycle, const TraceList& traces);
+  virtual bool evaluate(uint32_t cycle, const TraceList& traces,
+                        EvalState::Ref state) const;
 };
 
 ///////////////////////////////////////////////////////
@@ -271,17 +450,18 @@ class FuturePlus : public HyperProp {
 ///////////////////////////////////////////////////////
 
 class Since : public HyperProp {
-  bool validF1, validF2;
+  // state: validF1, and validF2, which is set once f2 has held.
 
  public:
-  Since(PVarMap m, PHyperProp f1, PHyperProp f2)
-      : HyperProp(m), validF1(true), validF2(false) {
-    args.push_back(f1);
-    args.push_back(f2);
+  Since(PVarMap m, PHyperProp f1, PHyperProp f2) : HyperProp(m, 2) {
+    addArg(f1);
+    addArg(f2);
   }
 
   virtual void display(std::ostream& out) const;
-  virtual bool eval(uint32_t cycle, const TraceList& traces);
+  virtual bool evaluate(uint32_t cycle, const TraceList& traces,
+                        EvalState::Ref state) const;
+  virtual void initState(uint8_t* state) const;
 };
 
 }  // namespace HyperPLTL
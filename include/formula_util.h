@@ -1,9 +1,56 @@
 #ifndef __FORMULA_UTIL_H__
 #define __FORMULA_UTIL_H__
 
+#include "block_eval.h"
+#include "corpus.h"
 #include "formula.h"
+#include "program.h"
 #include "trace.h"
 
 bool evaluateTraces(HyperPLTL::PHyperProp formula, TraceList const& traces);
 
+// same, with state instead of the state kept by formula, which is left
+// untouched; state is reset first. Safe to call from many threads at once
+// with the same formula and a state each.
+bool evaluateTraces(HyperPLTL::PHyperProp formula, TraceList const& traces,
+                    HyperPLTL::EvalState& state);
+
+// same as evaluateTraces(formula, traces) for the formula program was compiled
+// from, running the compiled program with a state of its own instead.
+bool evaluateTraces(const HyperPLTL::Program& program, TraceList const& traces);
+
+// same, with state, which is reset first.
+bool evaluateTraces(const HyperPLTL::Program& program, TraceList const& traces,
+                    HyperPLTL::ProgramState& state);
+
+// indices into a corpus of the traces of a tuple, in the order they are given
+// to a formula.
+typedef std::vector<size_t> TraceTuple;
+
+// evaluate formula on every ordered tuple of k distinct traces of corpus,
+// spread over the threads of pool with a state each, and return the tuples
+// it does not hold on, in order. With stopAtFirst, no tuple is started once
+// one fails, and only the failures found until then are returned. A corpus
+// with more tuples than a size_t can count is rejected with an error.
+std::vector<TraceTuple> checkAllTuples(HyperPLTL::PHyperProp formula,
+                                       const Corpus& corpus, unsigned k, ThreadPool& pool,
+                                       bool stopAtFirst = false);
+
+// same for pairs, on a pool of threads threads, one per hardware thread if 0.
+std::vector<TraceTuple> checkAllPairs(HyperPLTL::PHyperProp formula, const Corpus& corpus,
+                                      unsigned threads = 0, bool stopAtFirst = false);
+
+// same as evaluateTraces(formula, traces), evaluating 64 cycles at a time with
+// a BlockEvaluator.
+bool evaluateBlocks(HyperPLTL::PHyperProp formula, TraceList const& traces);
+
+// number of recent cycles a monitor of formula must be able to read: the
+// present cycle and one more for every nested X operator. Suitable for
+// Trace::setHistoryLimit().
+uint32_t historyHorizon(HyperPLTL::PHyperProp formula);
+
+// signals of a trace that formula reads; loading only those with
+// TraceSerialize::load(source, projection) is enough to evaluate formula.
+TraceProjection traceProjection(HyperPLTL::PHyperProp formula);
+
 #endif
@@ -0,0 +1,94 @@
+#ifndef __MONITOR_H_DEFINED__
+#define __MONITOR_H_DEFINED__
+
+#include <memory>
+#include <vector>
+
+#include "formula.h"
+#include "program.h"
+
+namespace HyperPLTL {
+
+/**
+ * Monitor follows a set of traces as they grow, one cycle at a time, and
+ * reports the verdict evaluateTraces() would give on the whole run as soon
+ * as no later cycle can change it.
+ *
+ * The formula is split into a skeleton of boolean connectives over three
+ * kinds of subformulas, evaluated as cycles arrive:
+ *  - formulas built from atoms, connectives and X operators, whose value at
+ *    a cycle is known once the cycles they look ahead to have arrived;
+ *  - G+ and F- over such formulas, folded cycle by cycle, which become
+ *    final once false and once true respectively;
+ *  - any other formula, evaluated over the whole run by finish().
+ * Each subformula is compiled into a Program, which evaluates the first kind
+ * with Program::evalAt(); the Monitor itself only combines three-valued
+ * verdicts. Each step costs one pass over the formula. Only the first two
+ * kinds are decided early, and only they can be monitored over traces whose
+ * history is bounded to historyHorizon(formula) cycles; finish() rejects
+ * such traces if the formula has any other kind.
+ */
+class Monitor {
+ public:
+  enum class Verdict : uint8_t { VIOLATED, SATISFIED, UNKNOWN };
+
+ private:
+  /// node of the skeleton, in postorder.
+  struct Node {
+    enum Kind : uint8_t { NOT, AND, OR, IMPLIES, ALWAYS, ONCE, LOCAL, OPAQUE };
+    Kind kind;
+    /// children of a connective.
+    std::vector<uint32_t> args;
+    /// the argument of an ALWAYS or ONCE node, or the formula of a LOCAL or
+    /// OPAQUE node, compiled, and the state it runs with.
+    std::unique_ptr<Program> program;
+    std::unique_ptr<ProgramState> state;
+    /// next cycle an ALWAYS or ONCE node folds in.
+    uint32_t next;
+    Verdict value;
+  };
+
+  TraceList traces;
+  std::vector<Node> nodes;
+  uint32_t consumed;
+  bool finished;
+  Verdict current;
+
+  uint32_t addNode(PHyperProp f);
+  void fold(Node& node, uint32_t upto, uint32_t last);
+  void consume(uint32_t last);
+
+ public:
+  /** Monitor formula over traces, which must all grow at the same pace. */
+  Monitor(PHyperProp formula, const TraceList& traces);
+
+  /**
+   * Consume the next cycle, which every trace must already hold, and return
+   * the verdict so far. Once the verdict is final, nothing is evaluated.
+   */
+  Verdict step();
+
+  /** Consume every cycle the traces hold and return the verdict so far. */
+  Verdict update();
+
+  /**
+   * Consume the remaining cycles, taking the last one the traces hold as
+   * the end of the run, and return the verdict, which is then final. A
+   * formula that is not decided online needs the whole run, so traces
+   * that no longer hold cycle 0 are rejected with an error.
+   */
+  Verdict finish();
+
+  /// Return the verdict so far.
+  Verdict verdict() const { return current; }
+
+  /// Return true once no further cycle can change the verdict.
+  bool isFinal() const { return current != Verdict::UNKNOWN; }
+
+  /// Return the number of cycles consumed.
+  uint32_t cycles() const { return consumed; }
+};
+
+}  // namespace HyperPLTL
+
+#endif
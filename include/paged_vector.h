@@ -0,0 +1,244 @@
+#ifndef __PAGED_VECTOR_H_DEFINED__
+#define __PAGED_VECTOR_H_DEFINED__
+
+#include <algorithm>
+#include <cassert>
+#include <vector>
+
+/**
+ * PagedVector is an append-only sequence kept in pages of PAGE_SIZE elements,
+ * reached through a small index of page pointers. Unlike std::vector it never
+ * reallocates the whole sequence as it grows: a full page is never moved, so
+ * appending needs no more than one extra page of memory and elements can be
+ * read in O(1) from their index.
+ *
+ * The first page starts small and doubles up to PAGE_SIZE, so that short
+ * sequences stay small; every later page is allocated at full size.
+ *
+ * An element may also be a row of width() values stored next to each other,
+ * see setWidth(), row() and appendRow().
+ *
+ * A contiguous array laid out the same way can be borrowed instead of copied,
+ * see borrow(); the sequence is then read-only.
+ */
+template <class T, unsigned PAGE_BITS = 10>
+class PagedVector {
+ public:
+  static constexpr size_t PAGE_SIZE = size_t(1) << PAGE_BITS;
+  static constexpr size_t PAGE_MASK = PAGE_SIZE - 1;
+
+ private:
+  /// capacity of the first page when it is allocated.
+  static constexpr size_t MIN_CAPACITY = 4;
+
+  std::vector<T*> pages;
+
+  /// true if the pages belong to someone else.
+  bool borrowed;
+
+  /// number of elements.
+  size_t count;
+
+  /// number of elements the last page can hold.
+  size_t tailCapacity;
+
+  /// number of values of T in each element.
+  uint32_t width;
+
+  /// Return the number of elements stored in the last page.
+  size_t tailSize() const { return count - ((pages.size() - 1) << PAGE_BITS); }
+
+  /// Reallocate the last page to hold capacity elements.
+  void resizeTail(size_t capacity) {
+    assert(!borrowed);
+    T* page = new T[capacity * width];
+    std::copy(pages.back(), pages.back() + tailSize() * width, page);
+    delete[] pages.back();
+    pages.back() = page;
+    tailCapacity = capacity;
+  }
+
+  /// Make room for one more element.
+  void reserveOne() {
+    assert(!borrowed);
+    if (pages.empty()) {
+      pages.push_back(new T[MIN_CAPACITY * width]);
+      tailCapacity = MIN_CAPACITY;
+    } else if (tailSize() == PAGE_SIZE) {
+      pages.push_back(new T[PAGE_SIZE * width]);
+      tailCapacity = PAGE_SIZE;
+    } else if (tailSize() == tailCapacity) {
+      resizeTail(std::min(2 * tailCapacity, PAGE_SIZE));
+    }
+  }
+
+  /// Free the pages, unless they are borrowed.
+  void release() {
+    if (borrowed) return;
+    for (T* page : pages) delete[] page;
+  }
+
+ public:
+  PagedVector() : borrowed(false), count(0), tailCapacity(0), width(1) {}
+
+  ~PagedVector() { release(); }
+
+  PagedVector(const PagedVector& other) : PagedVector() { *this = other; }
+
+  PagedVector(PagedVector&& other) : PagedVector() { swap(other); }
+
+  /// Copies always own their pages, even of a borrowed sequence.
+  PagedVector& operator=(const PagedVector& other) {
+    if (this == &other) return *this;
+    clear();
+    width = other.width;
+    count = other.count;
+    for (size_t p = 0; p < other.pages.size(); ++p) {
+      size_t rows = other.pageSize(p);
+      pages.push_back(new T[rows * width]);
+      std::copy(other.page(p), other.page(p) + rows * width, pages.back());
+      tailCapacity = rows;
+    }
+    return *this;
+  }
+
+  PagedVector& operator=(PagedVector&& other) {
+    PagedVector tmp(std::move(other));
+    swap(tmp);
+    return *this;
+  }
+
+  /** Set the number of values in each element, before any is added. */
+  void setWidth(uint32_t w) {
+    assert(count == 0 && w > 0);
+    if (w == width) return;
+    clear();
+    width = w;
+  }
+
+  /**
+   * Read n elements in place from data, which must outlive the sequence and
+   * not change. No element is copied: the pages point into data.
+   */
+  void borrow(const T* data, size_t n) {
+    clear();
+    for (size_t first = 0; first < n; first += PAGE_SIZE) {
+      pages.push_back(const_cast<T*>(data) + first * width);
+    }
+    count = n;
+    tailCapacity = n - (pages.empty() ? 0 : (pages.size() - 1) << PAGE_BITS);
+    borrowed = true;
+  }
+
+  /// Return true if the elements are borrowed, see borrow().
+  bool isBorrowed() const { return borrowed; }
+
+  uint32_t getWidth() const { return width; }
+
+  size_t size() const { return count; }
+  bool empty() const { return count == 0; }
+
+  /// Return the number of elements that fit without allocating a page.
+  size_t capacity() const {
+    return pages.empty() ? 0 : ((pages.size() - 1) << PAGE_BITS) + tailCapacity;
+  }
+
+  /// Return the number of heap bytes held, the page index included.
+  size_t memoryUsage() const {
+    size_t index = pages.capacity() * sizeof(pages[0]);
+    return borrowed ? index : index + capacity() * width * sizeof(T);
+  }
+
+  T& operator[](size_t i) {
+    assert(!borrowed);
+    return pages[i >> PAGE_BITS][i & PAGE_MASK];
+  }
+  const T& operator[](size_t i) const { return pages[i >> PAGE_BITS][i & PAGE_MASK]; }
+
+  T& back() { return (*this)[count - 1]; }
+  const T& back() const { return (*this)[count - 1]; }
+
+  /// Return the values of element i.
+  const T* row(size_t i) const {
+    return pages[i >> PAGE_BITS] + (i & PAGE_MASK) * width;
+  }
+
+  void push_back(const T& v) {
+    reserveOne();
+    (*this)[count++] = v;
+  }
+
+  /// Append an element made of the width() values at src.
+  void appendRow(const T* src) {
+    reserveOne();
+    std::copy(src, src + width, pages[count >> PAGE_BITS] + (count & PAGE_MASK) * width);
+    ++count;
+  }
+
+  /// Append elements with value v until there are n.
+  void resize(size_t n, const T& v) {
+    while (count < n) push_back(v);
+  }
+
+  /// Return the number of pages.
+  size_t numPages() const { return pages.size(); }
+
+  /// Return the first element of page p; elements of a page are contiguous.
+  const T* page(size_t p) const { return pages[p]; }
+
+  /// Return the number of elements stored in page p.
+  size_t pageSize(size_t p) const {
+    return p + 1 < pages.size() ? PAGE_SIZE : tailSize();
+  }
+
+  /**
+   * Release the first n pages. Elements keep their order, and the index of
+   * each remaining element drops by n * PAGE_SIZE.
+   */
+  void dropPages(size_t n) {
+    assert(n < pages.size() || (n == pages.size() && n == 0));
+    if (!borrowed) {
+      for (size_t p = 0; p < n; ++p) delete[] pages[p];
+    }
+    pages.erase(pages.begin(), pages.begin() + n);
+    count -= n << PAGE_BITS;
+  }
+
+  void clear() {
+    release();
+    pages.clear();
+    borrowed = false;
+    count = 0;
+    tailCapacity = 0;
+  }
+
+  /// Release capacity reserved for further elements.
+  void shrink_to_fit() {
+    if (count == 0) {
+      clear();
+    } else if (!borrowed && tailSize() < tailCapacity) {
+      resizeTail(tailSize());
+    }
+    pages.shrink_to_fit();
+  }
+
+  void swap(PagedVector& other) {
+    pages.swap(other.pages);
+    std::swap(borrowed, other.borrowed);
+    std::swap(count, other.count);
+    std::swap(tailCapacity, other.tailCapacity);
+    std::swap(width, other.width);
+  }
+
+  bool operator!=(const PagedVector& other) const { return !(*this == other); }
+  bool operator==(const PagedVector& other) const {
+    if (count != other.count || width != other.width) return false;
+    for (size_t p = 0; p < pages.size(); ++p) {
+      const T* a = page(p);
+      if (!std::equal(a, a + pageSize(p) * width, other.page(p))) return false;
+    }
+    return true;
+  }
+};
+
+#endif
@@ -0,0 +1,138 @@
+#ifndef __PROGRAM_H_DEFINED__
+#define __PROGRAM_H_DEFINED__
+
+#include <vector>
+
+#include "formula.h"
+
+namespace HyperPLTL {
+
+class Program;
+
+/**
+ * ProgramState holds everything running a Program changes, as EvalState
+ * does for a formula: the result of each instruction, the state of each
+ * temporal operator and the datapoint each reading instruction last read in
+ * each trace. A Program is never modified by eval(), so one Program may run
+ * with many states at once, e.g. one per thread.
+ */
+class ProgramState {
+  std::vector<uint8_t> slots;
+  std::vector<uint8_t> state;
+  std::vector<uint8_t> initial;
+  std::vector<size_t> hints;
+  uint32_t numHints;
+  size_t numTraces;
+
+  friend class Program;
+
+ public:
+  /** Create the state of program before its first evaluation. */
+  explicit ProgramState(const Program& program);
+
+  /** Return every operator to its initial state. */
+  void reset();
+};
+
+/**
+ * Program is a HyperProp compiled into a flat array of instructions, which
+ * eval() runs in a single pass per cycle without virtual calls or pointer
+ * chasing. Instructions are in postorder: each writes its result to a slot
+ * of its own, which only later instructions read. Temporal operators keep
+ * their state in a separate array, so a Program evaluates exactly like a
+ * newly constructed copy of the formula it was compiled from, including
+ * operators that evaluate only some of their arguments. Slots, state and
+ * hints live in a ProgramState.
+ */
+class Program {
+ public:
+  enum class Op : uint8_t {
+    /// dst = a.
+    CONST,
+    /// dst = proposition a of trace b; c is the row of hints it reads from.
+    PROP,
+    /// dst = term variable a is equal in every trace; c is as for PROP.
+    EQ_INT,
+    EQ_ARRAY,
+    NOT,
+    AND,
+    OR,
+    IMPLIES,
+    /// dst = (state c &= a).
+    ALWAYS,
+    /// dst = state c, then state c = a.
+    NEXT,
+    /// dst = (state c |= a).
+    ONCE,
+    /// go to instruction a if state c + 1 is set.
+    SINCE_TEST,
+    /// state c + 1 = a, dst = false, then go to instruction b.
+    SINCE_RIGHT,
+    /// dst = (state c &= a).
+    SINCE_LEFT,
+  };
+
+  struct Instr {
+    Op op;
+    uint32_t dst;
+    uint32_t a;
+    uint32_t b;
+    uint32_t c;
+    /// number of X operators above the instruction.
+    uint32_t offset;
+  };
+
+ private:
+  std::vector<Instr> code;
+  /// initial state of each temporal operator.
+  std::vector<uint8_t> initialState;
+  uint32_t result;
+  /// number of rows of hints, one per reading instruction.
+  uint32_t numHints;
+  /// number of X operators above the instruction being compiled, the most
+  /// cycles ahead any instruction reads, and whether there is no G+, F- or U.
+  uint32_t depth;
+  uint32_t reach;
+  bool local;
+
+  template <bool window>
+  bool run(uint32_t cycle, uint32_t last, const TraceList& traces,
+           ProgramState& state) const;
+  uint32_t emit(Op op, uint32_t a = 0, uint32_t b = 0, uint32_t c = 0);
+  uint32_t allocState(std::initializer_list<bool> init);
+  uint32_t compile(const HyperProp* f);
+
+ public:
+  explicit Program(PHyperProp formula);
+
+  /** Evaluate the formula at cycle, updating state. */
+  bool eval(uint32_t cycle, const TraceList& traces, ProgramState& state) const;
+
+  /**
+   * Evaluate a formula without G+, F- or U at cycle directly, leaving the
+   * state of its operators untouched: a leaf under k X operators is read at
+   * cycle + k, and is false past last, the last cycle of the run; an X
+   * operator at last takes its initial value. While the run goes on, last
+   * is UINT32_MAX and the traces must hold cycle + lookahead().
+   */
+  bool evalAt(uint32_t cycle, uint32_t last, const TraceList& traces,
+              ProgramState& state) const;
+
+  /// Return true if the formula has no G+, F- or U, see evalAt().
+  bool isLocal() const { return local; }
+
+  /// Return the number of cycles after the evaluated one evalAt() reads.
+  uint32_t lookahead() const { return reach; }
+
+  const std::vector<Instr>& instructions() const { return code; }
+
+  /// Return the initial state of the temporal operators.
+  const std::vector<uint8_t>& initial() const { return initialState; }
+
+  /// Return the number of rows of hints a state keeps.
+  uint32_t getNumHints() const { return numHints; }
+};
+
+}  // namespace HyperPLTL
+
+#endif
@@ -0,0 +1,130 @@
+#ifndef __THREAD_POOL_H_DEFINED__
+#define __THREAD_POOL_H_DEFINED__
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * ThreadPool runs loops of independent iterations on a fixed set of worker
+ * threads. The thread calling parallelFor() takes part in its loop and only
+ * waits for iterations already started by workers, so a loop may be run from
+ * within another one without tying up the pool. Threads claim iterations one
+ * at a time as they become free, so iterations of uneven cost are spread
+ * evenly.
+ */
+class ThreadPool {
+  std::vector<std::thread> workers;
+  std::deque<std::function<void()>> tasks;
+  std::mutex mutex;
+  std::condition_variable wake;
+  bool stopping;
+
+  void work() {
+    for (;;) {
+      std::function<void()> task;
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        wake.wait(lock, [this] { return stopping || !tasks.empty(); });
+        if (tasks.empty()) return;
+        task = std::move(tasks.front());
+        tasks.pop_front();
+      }
+      task();
+    }
+  }
+
+  /** Iterations of one parallelFor() loop, shared by the threads running it. */
+  struct Loop {
+    size_t n;
+    std::function<void(size_t, unsigned)> body;
+    const std::atomic<bool>* stop;
+    std::atomic<size_t> next{0};
+    size_t done = 0;
+    std::mutex mutex;
+    std::condition_variable finished;
+
+    Loop(size_t n, std::function<void(size_t, unsigned)> body,
+         const std::atomic<bool>* stop)
+        : n(n), body(std::move(body)), stop(stop) {}
+
+    /// Run iterations as thread slot until none is left.
+    void run(unsigned slot) {
+      size_t count = 0;
+      for (size_t i; (i = next++) < n; ++count) {
+        if (stop && stop->load(std::memory_order_relaxed)) {
+          // claim every iteration left, so that the loop ends without them.
+          const size_t rest = next.exchange(n);
+          count += 1 + (rest < n ? n - rest : 0);
+          break;
+        }
+        body(i, slot);
+      }
+      if (count == 0) return;
+      std::lock_guard<std::mutex> lock(mutex);
+      done += count;
+      if (done == n) finished.notify_all();
+    }
+  };
+
+ public:
+  /** Start numThreads workers; 0 uses one per hardware thread. */
+  explicit ThreadPool(unsigned numThreads = 0) : stopping(false) {
+    if (numThreads == 0) numThreads = std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned k = 0; k < numThreads; ++k) workers.emplace_back([this] { work(); });
+  }
+
+  /** Finish the queued tasks and join the workers. */
+  ~ThreadPool() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stopping = true;
+    }
+    wake.notify_all();
+    for (auto& w : workers) w.join();
+  }
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  unsigned size() const { return workers.size(); }
+
+  /** Run body(i) for every i in [0, n) and return when all have run. */
+  void parallelFor(size_t n, std::function<void(size_t)> body) {
+    parallelFor(n, [body = std::move(body)](size_t i, unsigned) { body(i); }, nullptr);
+  }
+
+  /**
+   * Same as parallelFor(n, body), passing body the slot of the thread that
+   * runs the iteration as well: 0 for the calling thread and 1 to size() for
+   * the workers, so that each thread may keep state of its own in a slot. No
+   * iteration starts once stop is set; return when those started have run.
+   */
+  void parallelFor(size_t n, std::function<void(size_t, unsigned)> body,
+                   const std::atomic<bool>* stop) {
+    if (n == 0) return;
+    auto loop = std::make_shared<Loop>(n, std::move(body), stop);
+    const size_t helpers = std::min<size_t>(n - 1, workers.size());
+    if (helpers > 0) {
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (size_t k = 0; k < helpers; ++k) {
+          tasks.emplace_back([loop, k] { loop->run(k + 1); });
+        }
+      }
+      wake.notify_all();
+    }
+    loop->run(0);
+
+    std::unique_lock<std::mutex> lock(loop->mutex);
+    loop->finished.wait(lock, [&] { return loop->done == n; });
+  }
+};
+
+#endif
@@ -4,21 +4,122 @@
 #include <algorithm>
 #include <cassert>
 #include <cstring>
+#include <functional>
 #include <iomanip>
 #include <iostream>
 #include <memory>
 #include <variant>
 #include <vector>
 
+#include "paged_vector.h"
+
 class Trace;
+class ThreadPool;
 typedef std::shared_ptr<Trace> PTrace;
 typedef std::vector<PTrace> TraceList;
 
+/**
+ * Return the index of the last element of the sorted array times[0..n) that
+ * is not greater than key; times[0] must not be greater than key. The loop
+ * body compiles to a conditional move, so the search has no data-dependent
+ * branches and touches only the timestamp column.
+ */
+inline size_t searchChange(const uint32_t* times, size_t n, uint32_t key) {
+  assert(n > 0 && times[0] <= key);
+  const uint32_t* base = times;
+  while (n > 1) {
+    size_t half = n / 2;
+#if defined(__GNUC__)
+    // fetch both candidates for the next round while this one resolves.
+    __builtin_prefetch(base + half / 2);
+    __builtin_prefetch(base + half + half / 2);
+#endif
+    base = (base[half] <= key) ? base + half : base;
+    n -= half;
+  }
+  return base - times;
+}
+
+/**
+ * Same as searchChange(), but starts at index hint and gallops away from it
+ * in either direction, so a monotonic scan only pays for the change points it
+ * steps over.
+ */
+inline size_t seekChange(const uint32_t* times, size_t n, size_t hint, uint32_t key) {
+  assert(n > 0);
+  const size_t last = n - 1;
+  size_t lo, hi;
+
+  if (hint > last) hint = last;
+
+  if (times[hint] <= key) {
+    // forward: times[lo] is known to be at or before key.
+    size_t step = 1;
+    lo = hint;
+    while (lo + step <= last && times[lo + step] <= key) {
+      lo += step;
+      step <<= 1;
+    }
+    hi = std::min(lo + step, last + 1);
+  } else {
+    // backward: times[hi] is known to be after key.
+    size_t step = 1;
+    hi = hint;
+    while (hi >= step && times[hi - step] > key) {
+      hi -= step;
+      step <<= 1;
+    }
+    lo = hi >= step ? hi - step : 0;
+  }
+
+  return lo + searchChange(times + lo, hi - lo, key);
+}
+
+/**
+ * searchChange() over a paged column: the page is found by a binary search
+ * over the first timestamp of each page, and the datapoint inside it.
+ */
+template <unsigned B>
+size_t searchChange(const PagedVector<uint32_t, B>& times, uint32_t key) {
+  size_t lo = 0, n = times.numPages();
+  while (n > 1) {
+    size_t half = n / 2;
+    lo = (times.page(lo + half)[0] <= key) ? lo + half : lo;
+    n -= half;
+  }
+  return (lo << B) + searchChange(times.page(lo), times.pageSize(lo), key);
+}
+
+/**
+ * seekChange() over a paged column. The gallop stays inside the page of hint,
+ * or the page after it; any other key falls back to searchChange().
+ */
+template <unsigned B>
+size_t seekChange(const PagedVector<uint32_t, B>& times, size_t hint, uint32_t key) {
+  assert(times.size() > 0);
+  hint = std::min(hint, times.size() - 1);
+  const size_t pages = times.numPages();
+
+  for (size_t p = hint >> B; p < pages && p <= (hint >> B) + 1; ++p) {
+    const uint32_t* page = times.page(p);
+    if (page[0] > key) break;
+    if (p + 1 == pages || key < times.page(p + 1)[0]) {
+      size_t start = (p == hint >> B) ? hint & ((size_t(1) << B) - 1) : 0;
+      return (p << B) + seekChange(page, times.pageSize(p), start, key);
+    }
+  }
+  return searchChange(times, key);
+}
+
 template <class T>
 struct VarTrace {
-  /// DataPoint stores the value of a signal at a particular time index.
-  using DataPoint = std::pair<uint32_t, T>;
-  std::vector<DataPoint> datapoints;
+  /// times[i] is the cycle at which the signal takes on values[i]; the two
+  /// columns are kept separately so that searches only touch the timestamps.
+  /// Both are paged, so a long trace grows without moving its datapoints.
+  PagedVector<uint32_t> times;
+  PagedVector<T> values;
+
+  using ValueRef = const T&;
 
   /// time when the last addition was performed.
   uint32_t lastCycle;
@@ -27,138 +128,1234 @@ struct VarTrace {
   VarTrace() : lastCycle(0) {}
 
   /**
-   * updateValue(t, value) must be called every cycle.
-   * It will insert into the vector if needed.
+   * updateValue(t, value) records that the signal holds value from cycle t
+   * on; it only needs to be called when the value may have changed. Cycles
+   * skipped since the previous update hold the previous value, and a signal
+   * first updated after cycle 0 holds T() until then.
    */
   void updateValue(uint32_t time, const T& v) {
-    if (datapoints.size() == 0) {
-      assert(time == 0);
-      datapoints.push_back(DataPoint(time, v));
+    if (times.size() == 0 && time > 0) {
+      times.push_back(0);
+      values.push_back(T());
+    }
+
+    if (times.size() == 0) {
+      times.push_back(time);
+      values.push_back(v);
     } else {
       // must update a time index only once.
       assert(time > lastCycle);
 
       // find the last index into the array.
-      size_t last = datapoints.size() - 1;
+      size_t last = times.size() - 1;
       assert(last <= time);
 
-      // check if we need to add.g
-      if (datapoints[last].second != v) {
-        std::pair<uint32_t, T> tempdata(time, v);
-        datapoints.emplace_back(tempdata);
+      // check if we need to add.
+      if (values[last] != v) {
+        times.push_back(time);
+        values.push_back(v);
       }  // else nothing to do.
     }
 
     lastCycle = time;
   }
 
+  /**
+   * Append a datapoint known to differ from the last one, as when rebuilding
+   * a trace from its change points. time must be after every datapoint.
+   */
+  void appendChange(uint32_t time, const T& v) {
+    assert(times.empty() || time > lastCycle);
+    times.push_back(time);
+    values.push_back(v);
+    lastCycle = time;
+  }
+
   /** Extends the trace to the specified number of cycles. */
   void extendToCycle(uint32_t cycle) {
     assert(cycle >= lastCycle);
     lastCycle = cycle;
   }
 
+  /** Release capacity reserved for further changes. */
+  void shrink() {
+    times.shrink_to_fit();
+    values.shrink_to_fit();
+  }
+
+  /**
+   * Read n datapoints in place from the arrays t and v, which must outlive
+   * the trace; see PagedVector::borrow(). The trace is then read-only.
+   */
+  void borrow(const uint32_t* t, const T* v, size_t n, uint32_t last) {
+    times.borrow(t, n);
+    values.borrow(v, n);
+    lastCycle = last;
+  }
+
+  /**
+   * Allow the storage of cycles before cycle to be reclaimed, see
+   * PropTrace::discardBefore().
+   */
+  void discardBefore(uint32_t cycle) {
+    if (times.empty() || cycle <= times[0]) return;
+    size_t pages = seek(0, cycle) / times.PAGE_SIZE;
+    times.dropPages(pages);
+    values.dropPages(pages);
+  }
+
   /// Return the element at a particular index.
-  const T operator[](uint32_t cycle) {
-    assert(datapoints.size() > 0);
+  const T operator[](uint32_t cycle) const { return values[find(cycle)]; }
 
-    auto lowerCmp = [](const std::pair<unsigned int, T>& cv, const unsigned int v) {
-      return cv.first < v;
-    };
-    auto upperCmp = [](const unsigned int v, const std::pair<unsigned int, T>& cv) {
-      return v < cv.first;
+  /// Return the index of the datapoint in effect at cycle.
+  size_t find(uint32_t cycle) const {
+    assert(times.size() > 0);
+    return searchChange(times, cycle);
+  }
+
+  /**
+   * Return the index of the datapoint in effect at cycle, starting the search
+   * at index hint. See seekChange().
+   */
+  size_t seek(size_t hint, uint32_t cycle) const {
+    assert(times.size() > 0);
+    return seekChange(times, hint, cycle);
+  }
+
+  /// Return the value stored in datapoint idx.
+  ValueRef value(size_t idx) const { return values[idx]; }
+
+  /// Return the cycle at which datapoint idx takes effect.
+  uint32_t changeTime(size_t idx) const { return times[idx]; }
+
+  /**
+   * Cursor remembers the datapoint it last visited, so that reading the
+   * trace cycle by cycle (in either direction) costs amortized O(1).
+   */
+  class Cursor {
+    const VarTrace<T>* trace;
+    size_t index;
+
+   public:
+    Cursor(const VarTrace<T>* tr) : trace(tr), index(0) {}
+
+    ValueRef operator[](uint32_t cycle) {
+      index = trace->seek(index, cycle);
+      return trace->value(index);
+    }
+  };
+
+  Cursor cursor() const { return Cursor(this); }
+
+  uint32_t size() const { return times.size(); }
+
+  /// Return the number of words of each value, see ArrayTrace::dimension().
+  uint32_t dimension() const { return 1; }
+
+  /// Return the number of heap bytes held by the trace.
+  size_t memoryUsage() const { return times.memoryUsage() + values.memoryUsage(); }
+
+  bool operator!=(VarTrace<T> const& other) const { return !(*this == other); }
+  bool operator==(VarTrace<T> const& other) const {
+    return times == other.times && values == other.values;
+  }
+};
+
+/**
+ * PropTrace stores the trace of a proposition. A boolean signal only ever
+ * flips, so a sparse proposition is kept as the list of cycles at which it
+ * toggles. Once toggles are frequent enough that one bit per cycle is
+ * smaller, the column switches to a packed bitset. Either way the signal can
+ * be read 64 cycles at a time with word().
+ */
+class PropTrace {
+  /// sparse form: changes[0] is the first cycle held (0 unless history was
+  /// discarded) and changes[i] is the cycle of the i-th toggle after it, so
+  /// the value of datapoint i is initial ^ (i & 1).
+  PagedVector<uint32_t> changes;
+
+  /// dense form: bit (c & 63) of bits[(c >> 6) - baseWord] is the value at
+  /// cycle c. Bits past lastCycle hold the current value, so gaps fill in
+  /// for free. A page holds 4096 cycles.
+  PagedVector<uint64_t, 6> bits;
+  uint32_t baseWord;
+
+  bool initial;
+  bool current;
+  bool dense;
+
+  /// number of datapoints, i.e. toggles + 1 (0 while the trace is empty).
+  uint32_t count;
+
+  /// time when the last addition was performed.
+  uint32_t lastCycle;
+
+  /// A change list costs 32 bits per toggle and a bitset 1 bit per cycle.
+  static constexpr uint32_t BITS_PER_CHANGE = 32;
+  /// Traces shorter than this always stay sparse.
+  static constexpr uint32_t MIN_DENSE_CYCLES = 1024;
+
+  static uint64_t fill(bool v) { return v ? ~uint64_t(0) : 0; }
+
+  /// Return true if a bitset is smaller than a change list.
+  bool preferDense() const {
+    uint32_t span = lastCycle - firstCycle();
+    return span >= MIN_DENSE_CYCLES &&
+           uint64_t(count) * BITS_PER_CHANGE > uint64_t(span) + 1;
+  }
+
+  void makeDense() {
+    const uint32_t base = changes[0] >> 6;
+    PagedVector<uint64_t, 6> packed;
+    size_t hint = 0;
+    for (uint32_t w = base; w <= (lastCycle >> 6); ++w) packed.push_back(word(w, hint));
+    bits.swap(packed);
+    changes.clear();
+    baseWord = base;
+    dense = true;
+  }
+
+  void makeSparse() {
+    PagedVector<uint32_t> list;
+    forEachChange([&](uint32_t time) { list.push_back(time); });
+    initial = bits[0] & 1;
+    changes.swap(list);
+    bits.clear();
+    baseWord = 0;
+    dense = false;
+  }
+
+ public:
+  PropTrace()
+      : baseWord(0), initial(false), current(false), dense(false), count(0),
+        lastCycle(0) {}
+
+  /**
+   * updateValue(t, value) records that the proposition holds value from
+   * cycle t on, see VarTrace::updateValue(). A proposition first updated
+   * after cycle 0 is false until then.
+   */
+  void updateValue(uint32_t time, bool v) {
+    if (count == 0) {
+      changes.push_back(0);
+      initial = current = (time == 0) ? v : false;
+      count = 1;
+      lastCycle = 0;
+      if (time == 0) return;
+    }
+
+    // must update a time index only once.
+    assert(time > lastCycle);
+
+    if (v != current) {
+      count += 1;
+      current = v;
+      if (dense) {
+        size_t k = (time >> 6) - baseWord;
+        if (bits.size() <= k) bits.resize(k + 1, fill(!v));
+        // bits from time onwards take the new value.
+        uint64_t mask = ~uint64_t(0) << (time & 63);
+        bits[k] = v ? (bits[k] | mask) : (bits[k] & ~mask);
+      } else {
+        changes.push_back(time);
+      }
+    }
+
+    lastCycle = time;
+
+    if (!dense && preferDense()) makeDense();
+  }
+
+  /** Extends the trace to the specified number of cycles. */
+  void extendToCycle(uint32_t cycle) {
+    assert(cycle >= lastCycle);
+    lastCycle = cycle;
+  }
+
+  /**
+   * Read the sparse form in place: n datapoints starting at the cycles in c,
+   * the first with value init. See VarTrace::borrow().
+   */
+  void borrowChanges(bool init, const uint32_t* c, size_t n, uint32_t last) {
+    assert(n > 0 && c[0] == 0);
+    changes.borrow(c, n);
+    bits.clear();
+    baseWord = 0;
+    initial = init;
+    current = init ^ ((n - 1) & 1);
+    dense = false;
+    count = n;
+    lastCycle = last;
+  }
+
+  /**
+   * Read the dense form in place: nwords words of bits from cycle 0, which
+   * hold n datapoints. See VarTrace::borrow().
+   */
+  void borrowBits(const uint64_t* b, size_t nwords, uint32_t n, uint32_t last) {
+    assert(nwords == (last >> 6) + 1);
+    bits.borrow(b, nwords);
+    changes.clear();
+    baseWord = 0;
+    initial = b[0] & 1;
+    current = (b[nwords - 1] >> (last & 63)) & 1;
+    dense = true;
+    count = n;
+    lastCycle = last;
+  }
+
+  /** Switch to whichever of the two forms is smaller for the data so far. */
+  void compact() {
+    if (count == 0) return;
+    bool wantDense = preferDense();
+    if (wantDense && !dense) makeDense();
+    if (!wantDense && dense) makeSparse();
+    changes.shrink_to_fit();
+    bits.shrink_to_fit();
+  }
+
+  /**
+   * Allow the storage of cycles before cycle to be reclaimed. Values at
+   * cycle and later stay readable; earlier cycles may no longer be read.
+   * Storage is released a page at a time, without moving the datapoints
+   * that are kept.
+   */
+  void discardBefore(uint32_t cycle) {
+    if (count == 0 || cycle <= firstCycle()) return;
+
+    if (dense) {
+      size_t last = std::min<size_t>((cycle >> 6) - baseWord, bits.size() - 1);
+      size_t pages = last / bits.PAGE_SIZE;
+      if (pages == 0) return;
+      size_t k = pages * bits.PAGE_SIZE;
+
+      // the toggles that are dropped, including one onto the new first bit.
+      uint32_t dropped = 0;
+      bool v = bits[0] & 1;
+      for (size_t j = 0; j <= k; ++j) {
+        uint64_t flips = bits[j] ^ ((bits[j] << 1) | (v ? 1 : 0));
+        if (j == k) flips &= 1;
+        dropped += __builtin_popcountll(flips);
+        v = bits[j] >> 63;
+      }
+      bits.dropPages(pages);
+      baseWord += k;
+      count -= dropped;
+    } else {
+      size_t pages = seekChange(changes, 0, cycle) / changes.PAGE_SIZE;
+      size_t k = pages * changes.PAGE_SIZE;
+
+      // an even number of toggles is dropped, so initial is unchanged.
+      static_assert(changes.PAGE_SIZE % 2 == 0);
+      changes.dropPages(pages);
+      count -= k;
+    }
+  }
+
+  /**
+   * Call f(t) with the cycle t at which each datapoint starts, in order: the
+   * first cycle held, then every toggle.
+   */
+  template <class Func>
+  void forEachChange(Func f) const {
+    if (count == 0) return;
+    if (!dense) {
+      for (size_t idx = 0; idx < changes.size(); ++idx) f(changes[idx]);
+      return;
+    }
+    f(baseWord << 6);
+    bool v = bits[0] & 1;
+    for (uint32_t k = 0; k < bits.size(); ++k) {
+      // bit i of flips is set if the value at cycle 64w+i differs from the
+      // value at the cycle before it.
+      uint64_t prev = (bits[k] << 1) | (v ? 1 : 0);
+      uint64_t flips = bits[k] ^ prev;
+      while (flips) {
+        f(((baseWord + k) << 6) + __builtin_ctzll(flips));
+        flips &= flips - 1;
+      }
+      v = bits[k] >> 63;
+    }
+  }
+
+  /**
+   * Call f(t) with the cycle t of every toggle with from < t <= to, in order.
+   * The cost depends on the toggles, or words of the bitset, in the range
+   * only.
+   */
+  template <class Func>
+  void forEachChange(uint32_t from, uint32_t to, Func f) const {
+    if (count == 0) return;
+    if (!dense) {
+      size_t idx = seekChange(changes, 0, from);
+      for (++idx; idx < changes.size() && changes[idx] <= to; ++idx) f(changes[idx]);
+      return;
+    }
+    size_t k = (from >> 6) > baseWord ? (from >> 6) - baseWord : 0;
+    for (; k < bits.size() && ((baseWord + k) << 6) <= to; ++k) {
+      const bool v = k == 0 ? bits[0] & 1 : bits[k - 1] >> 63;
+      uint64_t flips = bits[k] ^ ((bits[k] << 1) | (v ? 1 : 0));
+      while (flips) {
+        const uint32_t t = ((baseWord + k) << 6) + __builtin_ctzll(flips);
+        if (t > to) return;
+        if (t > from) f(t);
+        flips &= flips - 1;
+      }
+    }
+  }
+
+  /// Return the first cycle whose value is still held.
+  uint32_t firstCycle() const {
+    if (count == 0) return 0;
+    return dense ? baseWord << 6 : changes[0];
+  }
+
+  /// Return true if the trace is kept as a bitset.
+  bool isDense() const { return dense; }
+
+  /// Return the value at a particular cycle.
+  bool operator[](uint32_t cycle) const {
+    size_t hint = 0;
+    return valueAt(cycle, hint);
+  }
+
+  /**
+   * Return the value at cycle. In sparse form hint is the index of a
+   * datapoint to start searching from and receives the one found, see
+   * seekChange(). The bitset form needs no search and ignores it.
+   */
+  bool valueAt(uint32_t cycle, size_t& hint) const {
+    assert(count > 0);
+    if (dense) {
+      assert((cycle >> 6) >= baseWord);
+      size_t k = (cycle >> 6) - baseWord;
+      if (k >= bits.size()) return current;
+      return (bits[k] >> (cycle & 63)) & 1;
+    }
+    hint = seekChange(changes, hint, cycle);
+    return initial ^ (hint & 1);
+  }
+
+  /**
+   * Return the values of cycles 64w to 64w+63 packed into one word, where bit
+   * i holds the value at cycle 64w+i. Cycles past the end of the trace hold
+   * the last value, and cycles before firstCycle() the first one. hint is
+   * used as in valueAt().
+   */
+  uint64_t word(uint32_t w, size_t& hint) const {
+    assert(count > 0);
+    if (dense) {
+      assert(w >= baseWord);
+      return w - baseWord < bits.size() ? bits[w - baseWord] : fill(current);
+    }
+
+    const uint32_t first = w << 6;
+    hint = seekChange(changes, hint, std::max(first, changes[0]));
+    uint64_t result = fill(initial ^ (hint & 1));
+
+    // every toggle inside the word flips all the bits above it.
+    for (size_t idx = hint + 1; idx < changes.size() && changes[idx] - first < 64;
+         ++idx) {
+      result ^= ~uint64_t(0) << (changes[idx] - first);
+    }
+    return result;
+  }
+
+  /**
+   * Cursor reads like VarTrace::Cursor. A sparse column remembers the toggle
+   * it last visited; a dense one reads the bit of the cycle from its word and
+   * keeps no position.
+   */
+  class Cursor {
+    const PropTrace* trace;
+    size_t index;
+
+   public:
+    Cursor(const PropTrace* tr) : trace(tr), index(0) {}
+
+    bool operator[](uint32_t cycle) { return trace->valueAt(cycle, index); }
+  };
+
+  Cursor cursor() const { return Cursor(this); }
+
+  /// Return the number of datapoints (toggles + 1).
+  uint32_t size() const { return count; }
+
+  /// Return the number of heap bytes held by the trace.
+  size_t memoryUsage() const { return changes.memoryUsage() + bits.memoryUsage(); }
+
+  bool operator!=(PropTrace const& other) const { return !(*this == other); }
+  bool operator==(PropTrace const& other) const {
+    if (count != other.count) return false;
+    if (count == 0) return true;
+    if (firstCycle() != other.firstCycle()) return false;
+    if (!dense && !other.dense) {
+      return initial == other.initial && changes == other.changes;
+    }
+
+    // compare the two forms word by word up to the last cycle either holds.
+    uint32_t fromWord = firstCycle() >> 6;
+    uint32_t toWord = std::max(lastCycle, other.lastCycle) >> 6;
+    size_t hint = 0, otherHint = 0;
+    for (uint32_t w = fromWord; w <= toWord; ++w) {
+      if (word(w, hint) != other.word(w, otherHint)) return false;
+    }
+    return true;
+  }
+};
+
+/**
+ * ArrayView is a non-owning view of one value of an array signal. It stays
+ * valid until the trace it points into is updated again.
+ */
+struct ArrayView {
+  const uint32_t* data;
+  uint32_t dim;
+
+  ArrayView() : data(nullptr), dim(0) {}
+  ArrayView(const uint32_t* d, uint32_t n) : data(d), dim(n) {}
+  ArrayView(const std::vector<uint32_t>& vec) : data(vec.data()), dim(vec.size()) {}
+
+  uint32_t size() const { return dim; }
+  uint32_t operator[](uint32_t i) const { return data[i]; }
+  const uint32_t* begin() const { return data; }
+  const uint32_t* end() const { return data + dim; }
+
+  std::vector<uint32_t> toVector() const { return std::vector<uint32_t>(begin(), end()); }
+
+  bool operator==(ArrayView const& other) const {
+    if (dim != other.dim) return false;
+    return dim == 0 || memcmp(data, other.data, dim * sizeof(uint32_t)) == 0;
+  }
+  bool operator!=(ArrayView const& other) const { return !(*this == other); }
+};
+
+/**
+ * ArrayTrace stores an array signal. The values of all change points live
+ * back to back in an arena, so recording a change never allocates per value.
+ * When the dimension is declared up front, the arena is paged like the
+ * timestamps, one row of dim words per change point; otherwise values may
+ * differ in length, and they are kept in a single vector with an extra column
+ * recording where each one starts.
+ */
+class ArrayTrace {
+  /// declared number of words per value; 0 if values may vary in length.
+  uint32_t dim;
+
+  /// times[i] is the cycle at which the signal takes on value i.
+  PagedVector<uint32_t> times;
+
+  /// value i is row i, when the dimension is declared.
+  PagedVector<uint32_t> rows;
+
+  /// value i is words[offsets[i]..offsets[i+1]), when it is not.
+  std::vector<uint32_t> words;
+  std::vector<size_t> offsets;
+
+  /// time when the last addition was performed.
+  uint32_t lastCycle;
+
+  /// Return true if v points into the values that appending may move: the
+  /// arena, or the last page of rows, which grows until it is full.
+  bool holds(ArrayView v) const {
+    const std::less<const uint32_t*> before;
+    auto inside = [&](const uint32_t* first, size_t n) {
+      return !before(v.data, first) && before(v.data, first + n);
     };
+    if (dim == 0) return inside(words.data(), words.size());
+    if (rows.numPages() == 0) return false;
+    const size_t last = rows.numPages() - 1;
+    return inside(rows.page(last), rows.pageSize(last) * dim);
+  }
 
-    auto lower = std::lower_bound(datapoints.begin(), datapoints.end(), cycle, lowerCmp);
-    assert((lower - datapoints.begin()) >= 0);
-    auto upper = std::upper_bound(datapoints.begin(), datapoints.end(), cycle, upperCmp);
+ public:
+  ArrayTrace(uint32_t d = 0) : dim(d), lastCycle(0) {
+    if (dim != 0) rows.setWidth(dim);
+  }
 
-    if (lower == upper)
-      return (lower - 1)->second;
-    else
-      return lower->second;
+  /// Return the number of words of each value (of the first value, if the
+  /// dimension was not declared).
+  uint32_t dimension() const {
+    if (dim != 0 || times.empty()) return dim;
+    return offsets[1] - offsets[0];
   }
 
-  uint32_t size() const { return datapoints.size(); }
+  /// Return true if every value has the same declared dimension.
+  bool isFixed() const { return dim != 0; }
 
-  bool operator!=(VarTrace<T> const& other) const {
-    return !(datapoints == other.datapoints);
+  /** Fix the dimension of the signal before any value is recorded; declaring
+      the same dimension again is allowed at any time. */
+  void setDimension(uint32_t d) {
+    if (dim == d) return;
+    assert(times.empty() && dim == 0);
+    dim = d;
+    rows.setWidth(d);
   }
-  bool operator==(VarTrace<T> const& other) const {
-    return datapoints == other.datapoints;
+
+  /**
+   * updateValue(t, value) records that the signal holds value from cycle t
+   * on, see VarTrace::updateValue(). A signal first updated after cycle 0
+   * holds zeros until then.
+   */
+  void updateValue(uint32_t time, ArrayView v) {
+    if (times.size() == 0 && time > 0) {
+      std::vector<uint32_t> zeros(dim != 0 ? dim : v.dim, 0);
+      updateValue(0, zeros);
+    }
+
+    if (times.size() != 0) {
+      // must update a time index only once.
+      assert(time > lastCycle);
+      if (value(times.size() - 1) == v) {
+        lastCycle = time;
+        return;
+      }
+    }
+
+    appendChange(time, v);
+  }
+
+  /** Append a datapoint without comparing it, see VarTrace::appendChange(). */
+  void appendChange(uint32_t time, ArrayView v) {
+    if (v.dim != 0 && holds(v)) {
+      // a view of this signal, copied before the storage grows.
+      const std::vector<uint32_t> copy = v.toVector();
+      appendChange(time, copy);
+      return;
+    }
+    assert(times.empty() || time > lastCycle);
+    if (times.empty() && dim == 0) offsets.push_back(0);
+    assert(dim == 0 || v.dim == dim);
+    times.push_back(time);
+    if (dim != 0) {
+      rows.appendRow(v.data);
+    } else {
+      words.insert(words.end(), v.begin(), v.end());
+      offsets.push_back(words.size());
+    }
+    lastCycle = time;
+  }
+
+  /** Extends the trace to the specified number of cycles. */
+  void extendToCycle(uint32_t cycle) {
+    assert(cycle >= lastCycle);
+    lastCycle = cycle;
+  }
+
+  /**
+   * Read n datapoints of a declared dimension in place, the values from r
+   * row by row. See VarTrace::borrow().
+   */
+  void borrow(const uint32_t* t, const uint32_t* r, size_t n, uint32_t last) {
+    assert(dim != 0);
+    times.borrow(t, n);
+    rows.borrow(r, n);
+    lastCycle = last;
+  }
+
+  /** Release capacity reserved for further changes. */
+  void shrink() {
+    times.shrink_to_fit();
+    rows.shrink_to_fit();
+    words.shrink_to_fit();
+    offsets.shrink_to_fit();
+  }
+
+  /**
+   * Allow the storage of cycles before cycle to be reclaimed, see
+   * PropTrace::discardBefore().
+   */
+  void discardBefore(uint32_t cycle) {
+    if (times.empty() || cycle <= times[0]) return;
+    size_t pages = seek(0, cycle) / times.PAGE_SIZE;
+    if (pages == 0) return;
+    times.dropPages(pages);
+    if (dim != 0) {
+      rows.dropPages(pages);
+      return;
+    }
+    // values of varying length are moved to the front of their vector.
+    size_t idx = pages * times.PAGE_SIZE;
+    size_t base = offsets[idx];
+    words.erase(words.begin(), words.begin() + base);
+    offsets.erase(offsets.begin(), offsets.begin() + idx);
+    for (auto& off : offsets) off -= base;
+  }
+
+  /// Return the element at a particular index.
+  ArrayView operator[](uint32_t cycle) const { return value(find(cycle)); }
+
+  /// Return the index of the datapoint in effect at cycle.
+  size_t find(uint32_t cycle) const {
+    assert(times.size() > 0);
+    return searchChange(times, cycle);
+  }
+
+  /// Return the index of the datapoint in effect at cycle, see seekChange().
+  size_t seek(size_t hint, uint32_t cycle) const {
+    assert(times.size() > 0);
+    return seekChange(times, hint, cycle);
+  }
+
+  /// Return the value stored in datapoint idx.
+  ArrayView value(size_t idx) const {
+    if (dim != 0) return ArrayView(rows.row(idx), dim);
+    return ArrayView(words.data() + offsets[idx], offsets[idx + 1] - offsets[idx]);
+  }
+
+  /// Return the cycle at which datapoint idx takes effect.
+  uint32_t changeTime(size_t idx) const { return times[idx]; }
+
+  /**
+   * Cursor reads like VarTrace::Cursor. Its views point at the row of a
+   * fixed-size array, or at the words between two offsets of a ragged one,
+   * and are valid until the trace is updated.
+   */
+  class Cursor {
+    const ArrayTrace* trace;
+    size_t index;
+
+   public:
+    Cursor(const ArrayTrace* tr) : trace(tr), index(0) {}
+
+    ArrayView operator[](uint32_t cycle) {
+      index = trace->seek(index, cycle);
+      return trace->value(index);
+    }
+  };
+
+  Cursor cursor() const { return Cursor(this); }
+
+  uint32_t size() const { return times.size(); }
+
+  /// Return the number of heap bytes held by the trace, values included.
+  size_t memoryUsage() const {
+    return times.memoryUsage() + rows.memoryUsage() +
+           words.capacity() * sizeof(uint32_t) + offsets.capacity() * sizeof(size_t);
+  }
+
+  bool operator!=(ArrayTrace const& other) const { return !(*this == other); }
+  bool operator==(ArrayTrace const& other) const {
+    if (times != other.times) return false;
+    if (dim != 0 && dim == other.dim) return rows == other.rows;
+    if (dim == 0 && other.dim == 0) {
+      return words == other.words && offsets == other.offsets;
+    }
+    // a declared and an undeclared trace may still hold the same values.
+    for (size_t idx = 0; idx < times.size(); ++idx) {
+      if (value(idx) != other.value(idx)) return false;
+    }
+    return true;
   }
 };
 
 using ValueType = std::variant<uint32_t, std::vector<uint32_t>>;
-using TraceType = std::variant<VarTrace<uint32_t>, VarTrace<std::vector<uint32_t>>>;
+
+/** Kind of storage backing a term variable of a Trace. */
+enum class TermKind : uint32_t { NONE, INT, ARRAY };
+
+/**
+ * Handle of an integer variable of a particular Trace, see Trace::intSignal().
+ * Reads and writes through a handle go straight to the integer column.
+ */
+struct IntSignal {
+  uint32_t column;
+};
+
+/** Handle of an array variable of a particular Trace, see Trace::arraySignal(). */
+struct ArraySignal {
+  uint32_t column;
+};
+
+/**
+ * Storage statistics of a single signal of a Trace, see Trace::propStats()
+ * and Trace::termStats().
+ */
+struct SignalStats {
+  /// number of datapoints stored, i.e. the initial value and every change.
+  uint32_t changes;
+  /// number of cycles covered by the stored datapoints.
+  uint32_t cycles;
+  /// heap bytes held by the signal.
+  size_t bytes;
+  /// bytes the signal takes when every cycle is stored, as counted by
+  /// TraceSerialize::getByteSize().
+  size_t expandedBytes;
+
+  /// Return the fraction of cycles at which the signal changes.
+  double density() const { return cycles == 0 ? 0 : double(changes) / cycles; }
+
+  /// Return how many times smaller the signal is than its expanded form.
+  double compressionRatio() const {
+    return bytes == 0 ? 0 : double(expandedBytes) / bytes;
+  }
+};
 
 class Trace {
+  /** Storage slot of a term variable. */
+  struct TermSlot {
+    TermKind kind;
+    uint32_t column;
+    /// declared number of significant bits of each value.
+    uint32_t width;
+  };
+
+  /**
+   * Simulator variables bound to signals of this trace. Each group keeps the
+   * addresses to read, the columns to write, and the values captured in the
+   * previous frame, which the next frame is compared against in bulk.
+   */
+  struct FrameBinding {
+    std::vector<const bool*> propAddrs;
+    std::vector<uint32_t> propIds;
+    std::vector<uint8_t> propFrame, propScratch;
+
+    std::vector<const uint32_t*> intAddrs;
+    std::vector<uint32_t> intColumns;
+    std::vector<uint32_t> intFrame, intScratch;
+
+    std::vector<const uint32_t*> arrayAddrs;
+    std::vector<uint32_t> arrayColumns;
+
+    /// false until the first frame has been captured.
+    bool primed = false;
+  };
+
   /** A vector of traces for each propositional variable. */
-  std::vector<VarTrace<bool>> propositions;
+  std::vector<PropTrace> propositions;
 
-  /** A vector of traces for each term variable. */
-  std::vector<TraceType> variables;
+  /** Integer and array variables are kept in separate homogeneous columns;
+      slots maps each term variable to its column. */
+  std::vector<VarTrace<uint32_t>> intVars;
+  std::vector<ArrayTrace> arrayVars;
+  std::vector<TermSlot> slots;
+
+  /** Mask of the declared width of each integer and array column. */
+  std::vector<uint32_t> intMasks;
+  std::vector<uint32_t> arrayMasks;
 
   /** The last valid time cycle in this trace. */
   uint32_t lastCycle;
 
+  /** Set by seal(), after which the trace is read-only. */
+  bool sealed;
+
+  FrameBinding frame;
+
+  /** Number of recent cycles to retain, 0 to keep the whole history. */
+  uint32_t historyLimit;
+
+  /** The oldest cycle that can still be read, and the cycle at which the
+      history is trimmed next. */
+  uint32_t historyStart;
+  uint32_t nextTrim;
+
+  /** Cycles between two attempts to trim the history. */
+  static constexpr uint32_t MIN_TRIM_INTERVAL = 1024;
+
+  void touch(uint32_t cycle) {
+    assert(!sealed);
+    if (lastCycle < cycle) {
+      lastCycle = cycle;
+    }
+    if (historyLimit != 0 && lastCycle >= nextTrim) trimHistory();
+  }
+
+  /** Release the datapoints older than the retained window. */
+  void trimHistory();
+
+  static uint32_t widthMask(uint32_t width) {
+    return width == MAX_WIDTH ? ~uint32_t(0) : (uint32_t(1) << width) - 1;
+  }
+
+  /** Declare the bit width of term variable i; 0 keeps the current one. */
+  void setWidth(unsigned i, uint32_t width) {
+    assert(width <= MAX_WIDTH);
+    if (width == 0 || width == slots[i].width) return;
+    assert(slots[i].width == MAX_WIDTH);
+    TermSlot& slot = slots[i];
+    const bool empty = slot.kind == TermKind::INT ? intVars[slot.column].size() == 0
+                                                  : arrayVars[slot.column].size() == 0;
+    if (!empty) {
+      std::cerr << "Error : bit width of variable " << i
+                << " declared after its values\n";
+      exit(1);
+    }
+    slot.width = width;
+    (slot.kind == TermKind::INT ? intMasks : arrayMasks)[slot.column] = widthMask(width);
+  }
+
+  /** Record value in array column at cycle, masked to its declared width. */
+  void updateArray(uint32_t column, uint32_t cycle, ArrayView value) {
+    const uint32_t mask = arrayMasks[column];
+    if (std::all_of(value.begin(), value.end(), [mask](uint32_t w) {
+          return (w & ~mask) == 0;
+        })) {
+      arrayVars[column].updateValue(cycle, value);
+      return;
+    }
+    std::vector<uint32_t> masked = value.toVector();
+    for (auto& w : masked) w &= mask;
+    arrayVars[column].updateValue(cycle, masked);
+  }
+
+  /** Call f with the column backing term variable i. */
+  template <class Func>
+  auto visitTerm(unsigned i, Func&& f) const {
+    assert(i < slots.size() && slots[i].kind != TermKind::NONE);
+    if (slots[i].kind == TermKind::ARRAY) return f(arrayVars[slots[i].column]);
+    return f(intVars[slots[i].column]);
+  }
+
  public:
+  /** Bit width of a term value unless declared narrower. */
+  static constexpr uint32_t MAX_WIDTH = 32;
+
   /** Create a trace capable of storing numVars variables and
       numProps propositions. */
   Trace(unsigned numProps, unsigned numVars)
-      : propositions(numProps), variables(numVars), lastCycle(0) {}
+      : propositions(numProps), slots(numVars, TermSlot{TermKind::NONE, 0, MAX_WIDTH}),
+        lastCycle(0), sealed(false), historyLimit(0), historyStart(0), nextTrim(0) {}
+
+  Trace(const Trace&) = default;
+  Trace(Trace&&) = default;
+  Trace& operator=(const Trace&) = default;
+  Trace& operator=(Trace&&) = default;
+
+  /** A TraceView is also owned, and destroyed, through a PTrace. */
+  virtual ~Trace() = default;
 
   /** Return the number of propositional variables in the trace. */
   unsigned numProps() const { return propositions.size(); }
 
   /** Return the number of term (numeric) variables in the trace. */
-  unsigned numVars() const { return variables.size(); }
+  unsigned numVars() const { return slots.size(); }
+
+  /** Return the kind of storage of variable i (NONE until declared or
+      first written). */
+  TermKind termKind(unsigned i) const {
+    assert(i < slots.size());
+    return slots[i].kind;
+  }
+
+  /** Return true if variable i is stored as kind in every trace of traces,
+      so that it can be read through the signal handles of that kind. */
+  static bool allTermKind(const TraceList& traces, unsigned i, TermKind kind) {
+    for (auto& trace : traces) {
+      if (trace->termKind(i) != kind) return false;
+    }
+    return true;
+  }
+
+  /** Return the declared bit width of the values of variable i. */
+  uint32_t termWidth(unsigned i) const {
+    assert(i < slots.size());
+    return slots[i].width;
+  }
+
+  /** Declare variable i as an integer variable. A non-zero width declares
+      that its values fit in that many bits, see termWidth(); it must be
+      declared before any value is recorded. */
+  IntSignal declareIntVar(unsigned i, uint32_t width = 0) {
+    assert(i < slots.size());
+    if (slots[i].kind == TermKind::NONE) {
+      slots[i] = TermSlot{TermKind::INT, uint32_t(intVars.size()), MAX_WIDTH};
+      intVars.emplace_back();
+      intMasks.push_back(widthMask(MAX_WIDTH));
+    }
+    assert(slots[i].kind == TermKind::INT);
+    setWidth(i, width);
+    return IntSignal{slots[i].column};
+  }
+
+  /** Declare variable i as an array variable. A non-zero dim fixes the
+      dimension before any value is recorded; a non-zero width declares
+      the bit width of every element. */
+  ArraySignal declareArrayVar(unsigned i, uint32_t dim = 0, uint32_t width = 0) {
+    assert(i < slots.size());
+    if (slots[i].kind == TermKind::NONE) {
+      slots[i] = TermSlot{TermKind::ARRAY, uint32_t(arrayVars.size()), MAX_WIDTH};
+      arrayVars.emplace_back();
+      arrayMasks.push_back(widthMask(MAX_WIDTH));
+    }
+    assert(slots[i].kind == TermKind::ARRAY);
+    if (dim != 0) arrayVars[slots[i].column].setDimension(dim);
+    setWidth(i, width);
+    return ArraySignal{slots[i].column};
+  }
+
+  /** Return the handle of integer variable i. */
+  IntSignal intSignal(unsigned i) const {
+    assert(i < slots.size() && slots[i].kind == TermKind::INT);
+    return IntSignal{slots[i].column};
+  }
+
+  /** Return the handle of array variable i. */
+  ArraySignal arraySignal(unsigned i) const {
+    assert(i < slots.size() && slots[i].kind == TermKind::ARRAY);
+    return ArraySignal{slots[i].column};
+  }
+
+  /** Update the value of an integer signal at time cycle. Only the low bits
+      of its declared width are kept, as a signal of that width would. */
+  void updateValue(IntSignal s, uint32_t cycle, uint32_t value) {
+    touch(cycle);
+    intVars[s.column].updateValue(cycle, value & intMasks[s.column]);
+  }
+
+  /** Update the value of an array signal at time cycle, keeping the low bits
+      of the declared width of each element. */
+  void updateValue(ArraySignal s, uint32_t cycle, ArrayView value) {
+    touch(cycle);
+    updateArray(s.column, cycle, value);
+  }
+
+  /** Return the value of an integer signal at time cycle, which must not be
+      before firstCycle(), as for every read of the trace. */
+  uint32_t valueAt(IntSignal s, uint32_t cycle) const {
+    assert(cycle >= firstCycle());
+    return intVars[s.column][cycle];
+  }
+
+  /** Return a view of the value of an array signal at time cycle. */
+  ArrayView valueAt(ArraySignal s, uint32_t cycle) const {
+    assert(cycle >= firstCycle());
+    return arrayVars[s.column][cycle];
+  }
+
+  /** Same as valueAt(s, cycle), searching from the datapoint index in hint
+      and leaving the index found there. */
+  uint32_t valueAt(IntSignal s, uint32_t cycle, size_t& hint) const {
+    assert(cycle >= firstCycle());
+    const VarTrace<uint32_t>& tr = intVars[s.column];
+    hint = tr.seek(hint, cycle);
+    return tr.value(hint);
+  }
+
+  ArrayView valueAt(ArraySignal s, uint32_t cycle, size_t& hint) const {
+    assert(cycle >= firstCycle());
+    const ArrayTrace& tr = arrayVars[s.column];
+    hint = tr.seek(hint, cycle);
+    return tr.value(hint);
+  }
+
+  /** Update the value of integer variable i at time cycle. */
+  void updateTermValue(unsigned i, uint32_t cycle, uint32_t value) {
+    updateValue(declareIntVar(i), cycle, value);
+  }
 
   /** Update the value of variable i at time cycle. */
-  void updateTermValue(unsigned i, uint32_t cycle, ValueType value) {
-    assert(i < variables.size());
-    if (lastCycle < cycle) {
-      lastCycle = cycle;
+  void updateTermValue(unsigned i, uint32_t cycle, const ValueType& value) {
+    if (const uint32_t* v = std::get_if<uint32_t>(&value)) {
+      updateValue(declareIntVar(i), cycle, *v);
+    } else {
+      updateValue(declareArrayVar(i), cycle, std::get<std::vector<uint32_t>>(value));
     }
+  }
 
-    std::visit(VariantTraceWriteVisitor{cycle, variables[i]}, value);
+  /** Update the value of array variable i at time cycle. */
+  void updateArrayValue(unsigned i, uint32_t cycle, ArrayView value) {
+    updateValue(declareArrayVar(i), cycle, value);
   }
 
   /** Update the value of proposition i at time cycle. */
   void updatePropValue(unsigned i, uint32_t cycle, bool value) {
     assert(i < propositions.size());
-    if (lastCycle < cycle) {
-      lastCycle = cycle;
-    }
+    touch(cycle);
     propositions[i].updateValue(cycle, value);
   }
 
+  /**
+   * Bind proposition i to a simulator variable. Every captureCycle() reads
+   * the variable at addr, which must stay valid while the binding is in use.
+   * Bound signals must only be recorded through captureCycle().
+   */
+  void bindProp(unsigned i, const bool* addr) {
+    assert(i < propositions.size());
+    frame.propAddrs.push_back(addr);
+    frame.propIds.push_back(i);
+    frame.primed = false;
+  }
+
+  /** Bind an integer signal to a simulator variable, see bindProp(). */
+  void bindTerm(IntSignal s, const uint32_t* addr) {
+    frame.intAddrs.push_back(addr);
+    frame.intColumns.push_back(s.column);
+    frame.primed = false;
+  }
+
+  /** Bind an array signal of declared dimension to dim consecutive words
+      of simulator state, see bindProp(). */
+  void bindArray(ArraySignal s, const uint32_t* addr) {
+    assert(arrayVars[s.column].isFixed());
+    frame.arrayAddrs.push_back(addr);
+    frame.arrayColumns.push_back(s.column);
+    frame.primed = false;
+  }
+
+  /**
+   * Snapshot every bound simulator variable at time cycle. The new frame is
+   * compared against the previous one a block at a time, and only signals
+   * whose value changed are appended to their columns.
+   */
+  void captureCycle(uint32_t cycle);
+
   /** Return the value of variable i at time cycle. */
-  ValueType termValueAt(unsigned i, uint32_t cycle) {
-    assert(i < variables.size());
-    return std::visit(VariantTraceReadVisitor{cycle}, variables[i]);
+  ValueType termValueAt(unsigned i, uint32_t cycle) const {
+    size_t hint = 0;
+    return termValueAt(i, cycle, hint);
+  }
+
+  /** Return a view of the value of array variable i at time cycle. */
+  ArrayView arrayValueAt(unsigned i, uint32_t cycle) const {
+    return valueAt(arraySignal(i), cycle);
+  }
+
+  /** Same as arrayValueAt(i, cycle), searching from the datapoint index in
+      hint and leaving the index found there. */
+  ArrayView arrayValueAt(unsigned i, uint32_t cycle, size_t& hint) const {
+    return valueAt(arraySignal(i), cycle, hint);
   }
 
   /** Return the value of a proposition i at time cycle. */
-  bool propValueAt(unsigned i, uint32_t cycle) {
+  bool propValueAt(unsigned i, uint32_t cycle) const {
     assert(i < propositions.size());
+    assert(cycle >= firstCycle());
     return propositions[i][cycle];
   }
 
+  /** Return the value of variable i at time cycle, searching from the
+      datapoint index in hint and leaving the index found there. */
+  ValueType termValueAt(unsigned i, uint32_t cycle, size_t& hint) const {
+    assert(i < slots.size());
+    if (slots[i].kind == TermKind::ARRAY) {
+      return valueAt(ArraySignal{slots[i].column}, cycle, hint).toVector();
+    }
+    return valueAt(intSignal(i), cycle, hint);
+  }
+
+  /** Return the value of proposition i at time cycle, searching from the
+      datapoint index in hint and leaving the index found there. */
+  bool propValueAt(unsigned i, uint32_t cycle, size_t& hint) const {
+    assert(i < propositions.size());
+    assert(cycle >= firstCycle());
+    return propositions[i].valueAt(cycle, hint);
+  }
+
+  /** Return the cycle at which term variable i next changes after the
+      datapoint hint left by valueAt(), or UINT32_MAX if it never does. */
+  uint32_t nextTermChange(unsigned i, size_t hint) const {
+    return visitTerm(i, [&](const auto& col) {
+      return hint + 1 < col.size() ? col.changeTime(hint + 1) : UINT32_MAX;
+    });
+  }
+
+  /** Return the values of proposition i over cycles 64w to 64w+63, with the
+      value at cycle 64w+b in bit b. hint is used as in propValueAt(). */
+  uint64_t propWordAt(unsigned i, uint32_t w, size_t& hint) const {
+    assert(i < propositions.size());
+    return propositions[i].word(w, hint);
+  }
+
+  /**
+   * Cursor keeps one datapoint index per signal of a trace. Reads through a
+   * cursor are amortized O(1) as long as each signal is scanned monotonically.
+   */
+  class Cursor {
+    const Trace* trace;
+    std::vector<size_t> propHints;
+    std::vector<size_t> varHints;
+
+   public:
+    Cursor(const Trace* tr)
+        : trace(tr), propHints(tr->numProps(), 0), varHints(tr->numVars(), 0) {}
+
+    bool propValueAt(unsigned i, uint32_t cycle) {
+      return trace->propValueAt(i, cycle, propHints[i]);
+    }
+
+    ValueType termValueAt(unsigned i, uint32_t cycle) {
+      return trace->termValueAt(i, cycle, varHints[i]);
+    }
+  };
+
+  Cursor cursor() const { return Cursor(this); }
+
+  /** Hold the last value of every signal up to cycle; the trace must not be
+      sealed. */
   void extendToCycle(uint32_t cycle) {
+    assert(!sealed);
     assert(cycle >= lastCycle);
     lastCycle = cycle;
-    for (auto p : propositions) {
+    for (auto& p : propositions) {
       p.extendToCycle(cycle);
     }
-    for (auto v : variables) {
-      std::visit(VariantExtendCycle{cycle}, v);
+    for (auto& v : intVars) {
+      v.extendToCycle(cycle);
     }
+    for (auto& v : arrayVars) {
+      v.extendToCycle(cycle);
+    }
+  }
+
+  /**
+   * Fix the length of the trace once all changes have been recorded. This
+   * completes change-only ingest, where updates are only made at the cycles
+   * a signal changes: every signal holds its last value up to lastCycle,
+   * declared signals that were never recorded hold their default value, and
+   * spare capacity is released. A term variable that was never declared
+   * stays TermKind::NONE, and is stored without values. The trace can not
+   * be updated afterwards.
+   */
+  void seal(uint32_t lastCycle);
+
+  /**
+   * Record the values src holds over cycles from to to at cycles at to
+   * at + to - from of this trace, which must have the same number of
+   * variables. Term variables are declared as in src; signals src never
+   * recorded are skipped. Only the change points of src are visited.
+   */
+  void copyCycles(const Trace& src, uint32_t from, uint32_t to, uint32_t at);
+
+  /**
+   * Bound the history kept by the trace to the last cycles cycles, for
+   * monitors that run for an unbounded number of cycles but only look a few
+   * cycles back (see historyHorizon() in formula_util.h). Older datapoints
+   * are released as the trace grows and the space is reused, so memory
+   * depends on the rate of change rather than the length of the run. Cycles
+   * before firstCycle() can no longer be read. 0 keeps the whole history.
+   */
+  void setHistoryLimit(uint32_t cycles) {
+    historyLimit = cycles;
+    nextTrim = lastCycle;
+    if (historyLimit != 0) trimHistory();
   }
 
+  /// Return the number of retained cycles, 0 if the history is unbounded.
+  uint32_t getHistoryLimit() const { return historyLimit; }
+
+  /// Return the oldest cycle that can be read.
+  uint32_t firstCycle() const { return historyStart; }
+
+  /// Return true once seal() has been called.
+  bool isSealed() const { return sealed; }
+
   /// get trace length (un-compressed)
   size_t length(void) const { return 1 + lastCycle; }
 
+  /// Return storage statistics of proposition i.
+  SignalStats propStats(unsigned i) const;
+
+  /// Return storage statistics of term variable i.
+  SignalStats termStats(unsigned i) const;
+
+  /**
+   * Return the number of bytes used by the trace: the object itself and
+   * every heap allocation it owns, including array values and the buffers
+   * of bound frames.
+   */
+  size_t memoryUsage() const;
+
   // utility function to store a trace object in binary format for
   bool operator==(Trace const& other) const {
 
@@ -171,7 +1368,13 @@ class Trace {
     }
 
     for (size_t vi = 0; vi < numVars(); ++vi) {
-      if (variables[vi] != other.variables[vi]) return false;
+      const TermSlot& s = slots[vi];
+      const TermSlot& os = other.slots[vi];
+      if (s.kind != os.kind) return false;
+      if (s.kind == TermKind::INT && intVars[s.column] != other.intVars[os.column])
+        return false;
+      if (s.kind == TermKind::ARRAY && arrayVars[s.column] != other.arrayVars[os.column])
+        return false;
     }
 
     return true;
@@ -179,81 +1382,57 @@ class Trace {
 
   bool operator!=(Trace const& other) const { return !(*this == other); }
 
- public:
-  // TODO : separate out visitotr structs in visitors.h file
-  // visitors for std::variant, executes appropriate logic based on the active type
-  struct VariantTraceWriteVisitor {
-    uint32_t time;
-    TraceType& tr;
-
-    void operator()(uint32_t& val) {
-      if (time == 0) {
-        tr = VarTrace<uint32_t>();
-      }
-
-      VarTrace<uint32_t>& varref = std::get<VarTrace<uint32_t>>(tr);
-      varref.updateValue(time, val);
-    }
-
-    void operator()(std::vector<uint32_t>& val) {
-      if (time == 0) {
-        tr = VarTrace<std::vector<uint32_t>>();
-      }
-
-      VarTrace<std::vector<uint32_t>>& varref =
-          std::get<VarTrace<std::vector<uint32_t>>>(tr);
-
-      varref.updateValue(time, val);
-    }
-  };
-
-  struct VariantTraceReadVisitor {
-    uint32_t time;
+ private:
+  friend class TraceSerialize;
+  friend class TraceView;
+  friend class TraceExporter;
+};
 
-    ValueType operator()(VarTrace<uint32_t>& vt) const { return vt[time]; }
-    ValueType operator()(VarTrace<std::vector<uint32_t>>& vt) const { return vt[time]; }
-  };
+/**
+ * The signals of a trace that TraceSerialize::load() decodes, by index. The
+ * signals a formula reads are found with traceProjection().
+ */
+struct TraceProjection {
+  std::vector<unsigned> props;
+  std::vector<unsigned> vars;
 
-  struct VariantExtendCycle {
-    uint32_t cycle;
+  void addProp(unsigned i) { insert(props, i); }
+  void addVar(unsigned i) { insert(vars, i); }
 
-    void operator()(VarTrace<uint32_t>& vt) const { vt.extendToCycle(cycle); }
-    void operator()(VarTrace<std::vector<uint32_t>>& vt) const {
-      vt.extendToCycle(cycle);
-    }
-  };
+  bool hasProp(unsigned i) const {
+    return std::binary_search(props.begin(), props.end(), i);
+  }
+  bool hasVar(unsigned i) const {
+    return std::binary_search(vars.begin(), vars.end(), i);
+  }
 
  private:
-  friend class TraceSerialize;
+  static void insert(std::vector<unsigned>& v, unsigned i) {
+    auto pos = std::lower_bound(v.begin(), v.end(), i);
+    if (pos == v.end() || *pos != i) v.insert(pos, i);
+  }
+};
+
+/** Binary layouts written by TraceSerialize::store(). */
+enum class TraceFormat : uint32_t {
+  /// not a buffer written by store(), or of a later version.
+  UNKNOWN = 0,
+  /// version 1: every signal expanded to one value per cycle.
+  EXPANDED = 1,
+  /// version 2: the change points of each signal, with times and values
+  /// delta-encoded and bit-packed at the width they need, behind a tagged
+  /// header and the offset of each signal.
+  CHANGES = 2,
+  /// version 3: the change points of each signal as aligned arrays, which a
+  /// TraceView reads in place.
+  MAPPED = 3,
 };
 
 class TraceSerialize {
 
   struct DimensionVisitor {
-    uint32_t operator()([[maybe_unused]] VarTrace<uint32_t>& tv) { return 1; }
-    uint32_t operator()(VarTrace<std::vector<uint32_t>>& tv) { return tv[0].size(); }
-  };
-
-  struct ElemCountVisitor {
-    uint32_t operator()(VarTrace<uint32_t>& tv) { return tv.size(); }
-    uint32_t operator()(VarTrace<std::vector<uint32_t>>& tv) { return tv.size(); }
-  };
-
-  struct ValuePrinter {
-
-    std::ostream& out;
-    uint32_t time;
-
-    void operator()(VarTrace<uint32_t>& tv) { out << tv[time]; }
-    void operator()(VarTrace<std::vector<uint32_t>>& tv) {
-      std::vector<uint32_t> vec = tv[time];
-      uint32_t dim = vec.size();
-      out << "<";
-      for (size_t did = 0; did < dim; ++did) {
-        out << vec[did] << ",";
-      }
-      out << ">";
-    }
+    uint32_t operator()([[maybe_unused]] const VarTrace<uint32_t>& tv) { return 1; }
+    uint32_t operator()(const ArrayTrace& tv) { return tv.dimension(); }
   };
 
   struct TraceStoreVisitor {
@@ -261,7 +1440,7 @@ class TraceSerialize {
     uint8_t* dest;
     uint32_t ncycles;
 
-    uint32_t operator()(VarTrace<uint32_t>& tv) {
+    uint32_t operator()(const VarTrace<uint32_t>& tv) {
       const uint32_t u32size = sizeof(uint32_t);
       uint8_t* currloc = dest;
 
@@ -270,8 +1449,9 @@ class TraceSerialize {
       memcpy(currloc, &tempdata, u32size);
       currloc += u32size;
 
+      auto cursor = tv.cursor();
       for (uint32_t tstep = 0; tstep < ncycles; tstep++) {
-        tempdata = tv[tstep];
+        tempdata = cursor[tstep];
         memcpy(currloc, &tempdata, u32size);
         currloc += u32size;
       }
@@ -279,30 +1459,92 @@ class TraceSerialize {
       return currloc - dest;
     }
 
-    uint32_t operator()(VarTrace<std::vector<uint32_t>>& tv) {
+    uint32_t operator()(const ArrayTrace& tv) {
       const uint32_t u32size = sizeof(uint32_t);
       uint8_t* currloc = dest;
-      const uint32_t dim = tv[0].size();
+      const uint32_t dim = tv.dimension();
 
       memcpy(currloc, &dim, sizeof(dim));
       currloc += u32size;
 
+      auto cursor = tv.cursor();
       for (uint32_t tstep = 0; tstep < ncycles; tstep++) {
-        std::vector<uint32_t> tvec = tv[tstep];
-        for (uint32_t did = 0; did < dim; ++did) {
-          memcpy(currloc, &tvec[did], u32size);
-          currloc += u32size;
-        }
+        ArrayView tvec = cursor[tstep];
+        assert(tvec.dim == dim);
+        memcpy(currloc, tvec.data, dim * u32size);
+        currloc += dim * u32size;
       }
 
       return currloc - dest;
     }
   };
 
+  template <class Sink>
+  static void storeChanges(Sink& out, const Trace& trace);
+  static PTrace decode(uint8_t* source, const TraceProjection* projection,
+                       ThreadPool* pool);
+  static TraceList decodeAll(const std::vector<uint8_t*>& sources,
+                             const TraceProjection* projection, ThreadPool& pool);
+  static PTrace loadChanges(const uint8_t* source, const TraceProjection* projection,
+                            ThreadPool* pool);
+  static PTrace loadMapped(const uint8_t* source, const TraceProjection* projection,
+                           ThreadPool* pool);
+  static PTrace loadExpanded(const uint8_t* source, const TraceProjection* projection);
+  static bool isExpanded(const uint8_t* source);
+
  public:
-  static size_t getByteSize(PTrace trace);
+  /// first word of a version 2 (or later) buffer: "LPTR".
+  static constexpr uint32_t MAGIC = 0x5254504c;
+
+  /// size of the version 2 header: magic, version, size (8 bytes), and the
+  /// number of cycles, propositions and term variables, padded to 32 bytes.
+  static constexpr size_t HEADER_SIZE = 32;
+
+  /** Return the number of bytes store() writes for trace in format. */
+  static size_t getByteSize(PTrace trace, TraceFormat format = TraceFormat::EXPANDED);
+
+  /**
+   * Rebuild a trace stored in any format; the format is read from source. A
+   * trace in TraceFormat::MAPPED is copied, see TraceView to read it in place.
+   * Return nullptr if the format is TraceFormat::UNKNOWN.
+   */
   static PTrace load(uint8_t* source);
-  static size_t store(uint8_t* dest, PTrace trace);
+
+  /**
+   * Rebuild only the signals in projection; the others are left unrecorded.
+   * The change and mapped formats find each signal through their directory,
+   * so the cost of loading depends on the signals in projection only.
+   */
+  static PTrace load(uint8_t* source, const TraceProjection& projection);
+
+  /** Rebuild a trace, decoding its signals in parallel on pool. */
+  static PTrace load(uint8_t* source, ThreadPool& pool);
+
+  /**
+   * Rebuild the trace stored at each of sources, decoding them in parallel on
+   * pool, into a list ready for evaluation. When there are fewer traces than
+   * threads, the signals of each trace are decoded in parallel as well.
+   */
+  static TraceList load(const std::vector<uint8_t*>& sources, ThreadPool& pool);
+  static TraceList load(const std::vector<uint8_t*>& sources,
+                        const TraceProjection& projection, ThreadPool& pool);
+
+  /**
+   * Write trace to dest, which must hold getByteSize(trace, format) bytes, and
+   * return the number of bytes written. The expanded format costs a value
+   * per cycle; the change format is linear in the number of changes.
+   */
+  static size_t store(uint8_t* dest, PTrace trace,
+                      TraceFormat format = TraceFormat::EXPANDED);
+
+  /**
+   * Return the format of a buffer written by store(). A buffer without the
+   * tag of the later formats is in TraceFormat::EXPANDED only if the sizes
+   * in its header add up; the bytes it claims to hold must be readable.
+   */
+  static TraceFormat getFormat(const uint8_t* source);
+
+  /** Write trace to out as a change list, see TraceExport. */
   static void stringify(std::ostream& out, PTrace trace);
 };
 
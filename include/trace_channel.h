@@ -0,0 +1,106 @@
+#ifndef __TRACE_CHANNEL_H_DEFINED__
+#define __TRACE_CHANNEL_H_DEFINED__
+
+#include <atomic>
+#include <string>
+
+#include "trace_view.h"
+
+/*
+ * A trace channel is a POSIX shared memory segment through which one process
+ * publishes traces and others read them in place:
+ *
+ *   header | slot header 0 ... n-1 | padding | slot 0 | ... | slot n-1
+ *
+ * The k-th trace published, its sequence number, is stored in TraceFormat::
+ * MAPPED in one of the n slots. Every slot header has a state, which is the
+ * sequence number of the trace held or a mark that the slot is being
+ * written, and a table of leases, each the pid of a reading process and the
+ * number of views it holds of the slot. Both are atomics in the segment, so
+ * neither side ever waits on a lock held by the other: the writer never
+ * overwrites a slot that is leased, and a reader backs off from a slot
+ * being rewritten.
+ *
+ * The writer fills the slot holding the oldest trace that no reader leases,
+ * so a slow reader delays nothing but the slots it holds. A lease of a
+ * process that has exited, and been reaped, is reclaimed by the writer, so
+ * a checker that crashes while holding views does not stall the channel.
+ * Readers map the headers read-write and the slots, which start on a new
+ * page, read-only.
+ */
+
+/**
+ * TraceChannel is one end of a trace channel. The process that creates the
+ * channel publishes traces; processes that attach to it by name acquire
+ * views of them, which are read without copying. A single process may
+ * publish to a channel.
+ */
+class TraceChannel {
+  struct Header;
+  struct Slot;
+
+  std::string name;
+  /// the mapped segment, held by every view until it is released.
+  std::shared_ptr<uint8_t> segment;
+  Header* header;
+  Slot* slots;
+  bool creator;
+
+  bool map(int fd, size_t size, int prot);
+  /// Return the offset of the first slot, which starts a page.
+  static size_t slotsOffset(uint32_t numSlots);
+  uint8_t* slotData(uint32_t k) const;
+  bool isLeased(Slot& slot);
+
+ public:
+  /**
+   * Create the channel name, such as "/checker", with numSlots slots of
+   * slotBytes bytes each, replacing any channel of that name.
+   */
+  TraceChannel(const std::string& name, uint32_t numSlots, size_t slotBytes);
+
+  /** Attach to the channel name created by another process. */
+  explicit TraceChannel(const std::string& name);
+
+  /** Unmap the segment; the creator also removes its name. */
+  ~TraceChannel();
+
+  TraceChannel(const TraceChannel&) = delete;
+  TraceChannel& operator=(const TraceChannel&) = delete;
+
+  /// Return false if the segment could not be created or attached.
+  bool good() const { return header != nullptr; }
+
+  uint32_t numSlots() const;
+
+  /// Return the largest trace, in TraceFormat::MAPPED bytes, a slot holds.
+  size_t slotBytes() const;
+
+  /**
+   * Store trace as the next sequence number and make it visible to readers.
+   * Return false, publishing nothing, if the trace does not fit in a slot or
+   * readers still hold views of the traces in every slot.
+   */
+  bool publish(const Trace& trace);
+
+  /// Return the number of traces published so far.
+  uint64_t published() const;
+
+  /// Return the oldest sequence number from which every published trace is
+  /// still held by a slot.
+  uint64_t oldest() const;
+
+  /**
+   * Return a view of the trace of sequence number seq, or nullptr if it is
+   * not published yet, has been replaced, or every lease of its slot is
+   * taken by other processes. The slot is not reused while the view, or any
+   * copy of it, is alive, or until the process exits.
+   */
+  PTraceView acquire(uint64_t seq) const;
+
+  /// Tell readers that no more traces will be published.
+  void close();
+  bool isClosed() const;
+};
+
+#endif
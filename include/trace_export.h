@@ -0,0 +1,100 @@
+#ifndef __TRACE_EXPORT_H_DEFINED__
+#define __TRACE_EXPORT_H_DEFINED__
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "trace.h"
+
+namespace HyperPLTL {
+class VarMap;
+}
+
+/** Text layouts written by TraceExport. */
+enum class TextFormat {
+  /// a header row of signal names, then a row with the value of every signal
+  /// at each cycle where one of them changes, and at the last cycle.
+  CSV,
+  /// the rows of CSV as JSON objects, one per line.
+  JSONL,
+  /// the length of the trace, then one line per change of a signal with its
+  /// cycle, name and value, in order of cycles.
+  CHANGE_LIST,
+};
+
+/**
+ * TextWriter collects text in a buffer and hands it to a file descriptor or
+ * a stream a block at a time, so that writing a value costs no more than
+ * formatting it. Once a write fails, the writer keeps the error and drops
+ * the text that follows.
+ */
+class TextWriter {
+  std::vector<char> buffer;
+  size_t used;
+  int fd;
+  std::ostream* out;
+  /// errno of the first write that failed, or 0.
+  int error;
+
+ public:
+  /** Write to the open file descriptor fd, which is not closed. */
+  explicit TextWriter(int fd, size_t bufferSize = 1 << 16);
+
+  /** Write to out. */
+  explicit TextWriter(std::ostream& out, size_t bufferSize = 1 << 16);
+
+  /** Flush the buffer. */
+  ~TextWriter() { flush(); }
+
+  TextWriter(const TextWriter&) = delete;
+  TextWriter& operator=(const TextWriter&) = delete;
+
+  void put(char c) {
+    if (used == buffer.size()) flush();
+    buffer[used++] = c;
+  }
+
+  void put(const char* s, size_t n);
+  void put(const std::string& s) { put(s.data(), s.size()); }
+
+  /** Write the decimal digits of v. */
+  void putUint(uint64_t v);
+
+  /** Hand the buffered text to the file descriptor or stream. */
+  void flush();
+
+  /// Return false once a write has failed.
+  bool good() const { return error == 0; }
+
+  /// Return the errno of the first write that failed, or 0.
+  int lastError() const { return error; }
+};
+
+/**
+ * TraceExport writes a trace as text for inspection or for other tools. It
+ * walks the change points of every signal in order, so the cost is linear in
+ * the number of changes times the signals written per row. Signals are named
+ * after varmap if given, otherwise p<i> and v<i>; unrecorded ones are left
+ * out. Array values are their words separated by spaces, in brackets in
+ * JSONL and in the change list.
+ */
+class TraceExport {
+ public:
+  /**
+   * Write trace to out and flush it; return false if out failed, now or
+   * before, see TextWriter::good().
+   */
+  static bool write(TextWriter& out, const Trace& trace, TextFormat format,
+                    const HyperPLTL::VarMap* varmap = nullptr);
+
+  /** Write to the open file descriptor fd, see write(TextWriter&, ...). */
+  static bool write(int fd, const Trace& trace, TextFormat format,
+                    const HyperPLTL::VarMap* varmap = nullptr);
+
+  /** Write to out, see write(TextWriter&, ...). */
+  static bool write(std::ostream& out, const Trace& trace, TextFormat format,
+                    const HyperPLTL::VarMap* varmap = nullptr);
+};
+
+#endif
@@ -0,0 +1,163 @@
+#ifndef __TRACE_STREAM_H_DEFINED__
+#define __TRACE_STREAM_H_DEFINED__
+
+#include <fstream>
+#include <string>
+
+#include "trace.h"
+
+/*
+ * A trace stream file holds a trace too long to keep in memory as a sequence
+ * of chunks, each covering a fixed number of cycles:
+ *
+ *   header | chunk 0 | chunk 1 | ... | index | footer
+ *
+ * Every chunk is a self-contained trace in TraceFormat::CHANGES whose cycle 0
+ * is the first cycle of the chunk, and which starts with the values held at
+ * the end of the previous chunk. The index lists the cycle range, offset and
+ * size of each chunk; the footer at the very end of the file points to it.
+ * Chunks are written as soon as they are complete, so a file whose writer is
+ * still running can be read up to its last complete chunk.
+ */
+
+/** Cycle range of a chunk of a trace stream file and where it is stored. */
+struct TraceChunk {
+  uint32_t firstCycle;
+  uint32_t lastCycle;
+  uint64_t offset;
+  uint64_t size;
+};
+
+/**
+ * TraceWriter records a trace into a stream file while it is produced. It has
+ * the update interface of Trace; the chunk being recorded is the only part of
+ * the trace held in memory. Updates may arrive in any order within a chunk,
+ * but once a cycle past the end of the current chunk is updated, the chunk is
+ * written and its cycles can no longer be changed.
+ */
+class TraceWriter {
+  std::ofstream out;
+  unsigned numProps;
+  unsigned numVars;
+  uint32_t chunkCycles;
+
+  /// the chunk being recorded, and its first cycle.
+  PTrace chunk;
+  uint32_t chunkStart;
+
+  /// the previous chunk, whose last values the current chunk starts with.
+  PTrace previous;
+  uint32_t previousLast;
+
+  /// signals that hold their value at the start of the current chunk.
+  std::vector<bool> propStarted;
+  std::vector<bool> termStarted;
+
+  /// an empty trace holding the declarations every chunk starts from.
+  Trace schema;
+
+  /// the last cycle updated so far, if any.
+  uint32_t lastCycle;
+  bool empty;
+
+  std::vector<TraceChunk> index;
+  bool closed;
+
+  /// Return the local cycle of cycle, writing the chunks before it.
+  uint32_t advance(uint32_t cycle);
+
+  /// Give a signal the value it held at the end of the previous chunk, unless
+  /// the caller is about to record the first cycle of the chunk itself.
+  void startProp(unsigned i, bool writesFirst);
+  void startTerm(unsigned i, bool writesFirst);
+
+  /// Write the current chunk, whose last cycle is last, and start the next.
+  void writeChunk(uint32_t last);
+
+ public:
+  static constexpr uint32_t DEFAULT_CHUNK_CYCLES = 1 << 16;
+
+  /** Create the file at path for a trace of numProps propositions and
+      numVars term variables. */
+  TraceWriter(const std::string& path, unsigned numProps, unsigned numVars,
+              uint32_t chunkCycles = DEFAULT_CHUNK_CYCLES);
+
+  /** Close the file, if close() has not been called. */
+  ~TraceWriter();
+
+  /// Return false if the file could not be written.
+  bool good() const { return out.good(); }
+
+  /** Declare term variable i in every chunk, see Trace::declareIntVar(). */
+  void declareIntVar(unsigned i, uint32_t width = 0);
+  void declareArrayVar(unsigned i, uint32_t dim, uint32_t width = 0);
+
+  void updatePropValue(unsigned i, uint32_t cycle, bool value);
+  void updateTermValue(unsigned i, uint32_t cycle, uint32_t value);
+  void updateArrayValue(unsigned i, uint32_t cycle, ArrayView value);
+
+  /**
+   * Append the cycles of block after the last cycle recorded so far. block
+   * must have the variables of the stream, declared as with declareIntVar()
+   * and declareArrayVar().
+   */
+  void append(const Trace& block);
+
+  /**
+   * Write the last chunk, covering up to lastCycle, and the index. Like
+   * Trace::seal(), signals hold their last value up to lastCycle.
+   */
+  void close(uint32_t lastCycle);
+};
+
+/**
+ * TraceReader reads any range of cycles of a stream file, decoding only the
+ * chunks that overlap it. The chunks are found from the index of a complete
+ * file, or by walking the chunk headers of a file that is still being written.
+ */
+class TraceReader {
+  mutable std::ifstream in;
+  unsigned numProps;
+  unsigned numVars;
+  std::vector<TraceChunk> chunks;
+  bool valid;
+  bool complete;
+
+  /// Find the chunks written after the last one known.
+  void scanChunks();
+
+  /// Return true if the chunks read from the index follow each other from
+  /// cycle 0 and lie between the file header and end.
+  bool indexValid(uint64_t end) const;
+
+  /// Read and decode chunk k, or return nullptr if it cannot be read or its
+  /// header does not match the chunk.
+  PTrace readChunk(size_t k) const;
+
+ public:
+  explicit TraceReader(const std::string& path);
+
+  /// Return false if the file could not be opened or is not a stream file.
+  bool good() const { return valid; }
+
+  /// Return true if the file was closed by its writer.
+  bool isComplete() const { return complete; }
+
+  /** Pick up the chunks written since the file was opened or refreshed. */
+  void refresh();
+
+  size_t numChunks() const { return chunks.size(); }
+  const TraceChunk& getChunk(size_t k) const { return chunks[k]; }
+
+  /// Return the number of cycles in the chunks read so far.
+  size_t length() const { return chunks.empty() ? 0 : chunks.back().lastCycle + 1; }
+
+  /**
+   * Return the values of cycles first to last as a trace whose cycle 0 is
+   * first, or nullptr if a chunk of the range is damaged. The range must lie
+   * within length().
+   */
+  PTrace read(uint32_t first, uint32_t last) const;
+};
+
+#endif
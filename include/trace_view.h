@@ -0,0 +1,52 @@
+#ifndef __TRACE_VIEW_H_DEFINED__
+#define __TRACE_VIEW_H_DEFINED__
+
+#include <string>
+
+#include "trace.h"
+
+/**
+ * TraceView is a read-only Trace whose columns are read in place from a
+ * buffer in TraceFormat::MAPPED, such as a memory-mapped file or a shared
+ * memory segment. Opening a view only sets up the page index of each column;
+ * no datapoint is decoded or copied, so its cost does not depend on the
+ * length of the trace, and the operating system can share the pages between
+ * processes. A view is sealed and can be used wherever a PTrace is expected.
+ *
+ * Arrays whose values vary in length are the exception: they are copied
+ * when the view is opened.
+ */
+class TraceView : public Trace {
+  /// keeps the buffer alive for as long as the view.
+  std::shared_ptr<const void> owner;
+
+ public:
+  /**
+   * Create a view of the buffer at source, which must be 8-byte aligned,
+   * hold a trace that isValid() accepts, and stay unchanged while the view
+   * is in use. owner, if given, is held by the view to keep the buffer
+   * alive.
+   */
+  TraceView(const uint8_t* source, std::shared_ptr<const void> owner = nullptr);
+
+  /**
+   * Return true if the size bytes at source hold a trace in
+   * TraceFormat::MAPPED whose columns all lie inside them, so that a view
+   * of it never reads past the buffer.
+   */
+  static bool isValid(const uint8_t* source, size_t size);
+
+  /** Map the file at path and view it; return nullptr if it can not be mapped
+      or does not hold a valid trace, see isValid(). */
+  static std::shared_ptr<TraceView> open(const std::string& path);
+
+  /** Return the number of bytes store() writes for trace. */
+  static size_t getByteSize(const Trace& trace);
+
+  /** Write trace to dest in TraceFormat::MAPPED, see TraceSerialize::store(). */
+  static size_t store(uint8_t* dest, const Trace& trace);
+};
+
+typedef std::shared_ptr<TraceView> PTraceView;
+
+#endif
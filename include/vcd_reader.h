@@ -0,0 +1,127 @@
+#ifndef __VCD_READER_H_DEFINED__
+#define __VCD_READER_H_DEFINED__
+
+#include <istream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "formula.h"
+
+class TraceWriter;
+
+/** How VcdReader turns a value change dump into a trace. */
+struct VcdOptions {
+  /// full name of the clock; cycle n holds the values sampled just before
+  /// its n-th rising edge. If empty, every timestamp of the dump is a cycle,
+  /// holding the values after the changes at that timestamp.
+  std::string clock;
+  /// sample on falling edges of the clock instead.
+  bool negedge = false;
+  /// placed between the names of nested scopes and of the signal.
+  std::string separator = "_";
+};
+
+/**
+ * VcdReader reads a value change dump (IEEE 1364 VCD) from a stream, in one
+ * pass and in memory that depends on the number of signals only, so that
+ * dumps of any length can be converted. Every signal of the dump is declared
+ * in a VarMap when the header is read:
+ *
+ *   - 1-bit signals are propositions;
+ *   - buses up to 32 bits are integer variables of their width;
+ *   - wider buses are arrays of 32-bit words, least significant first;
+ *   - memory words, signals named name[k] with or without a bit range such
+ *     as name[k] [7:0], are element k of array name.
+ *
+ * Only the signals that change in a cycle are written to the trace; x and z
+ * bits read as 0, and real-valued signals are ignored.
+ */
+class VcdReader {
+  /** A variable of the dump and the signal of the VarMap it is written to. */
+  struct Wire {
+    HyperPLTL::VarType type;
+    unsigned var;
+    uint32_t width;
+    /// first word of the value in an array variable.
+    uint32_t offset;
+  };
+
+  /** Splits the stream into whitespace-separated tokens. */
+  struct Tokenizer {
+    std::istream& in;
+    std::vector<char> buffer;
+    size_t pos = 0, len = 0;
+
+    explicit Tokenizer(std::istream& in) : in(in), buffer(1 << 16) {}
+    bool next(std::string& token);
+  };
+
+  Tokenizer tokens;
+  HyperPLTL::PVarMap varmap;
+  VcdOptions options;
+  bool valid;
+
+  /// wires by identifier code; a code may stand for several variables.
+  std::unordered_map<std::string, std::vector<Wire>> wires;
+  /// the identifier code of the clock, if any.
+  std::string clockCode;
+
+  /// current value of each signal of the VarMap, and whether it changed
+  /// since the last cycle written.
+  std::vector<uint8_t> propValues;
+  std::vector<uint32_t> intValues;
+  std::vector<std::vector<uint32_t>> arrayValues;
+  std::vector<bool> propDirty, varDirty;
+  std::vector<unsigned> dirtyProps, dirtyVars;
+
+  /// the value changes of the timestamp being read, as code and value; only
+  /// the first groupSize are in use.
+  std::vector<std::pair<std::string, std::string>> group;
+  size_t groupSize;
+  /// true if the timestamp that starts the next group has been read.
+  bool atTimestamp;
+  /// last value of the clock: '0', '1', or 'x' if unknown.
+  char clockValue;
+
+  void readHeader();
+
+  /// Read the changes of the next timestamp into group; false at the end.
+  bool readGroup();
+
+  /// Return true if the clock changing to value is a sampling edge.
+  bool isEdge(const std::string& value) const;
+
+  /// Record that the signals of code hold value.
+  void apply(const std::string& code, const std::string& value);
+  void markProp(unsigned i);
+  void markVar(unsigned i);
+
+  template <class Sink>
+  void writeCycle(Sink& sink, uint32_t cycle);
+
+  template <class Sink>
+  uint32_t readInto(Sink& sink);
+
+ public:
+  /** Read the header of the dump in, declaring its signals in varmap. */
+  VcdReader(std::istream& in, HyperPLTL::PVarMap varmap, const VcdOptions& options = {});
+
+  /// Return false if the header could not be read, the clock is missing, or a
+  /// signal name is declared with another type than in the dump or VarMap.
+  bool good() const { return valid; }
+
+  /**
+   * Read the value changes into trace, which must have been created from
+   * the VarMap, and return the number of cycles read.
+   */
+  uint32_t read(Trace& trace);
+
+  /** Read the value changes into a stream file, see read(Trace&). */
+  uint32_t read(TraceWriter& writer);
+
+  /** Read the value changes into a new sealed trace. */
+  PTrace read();
+};
+
+#endif
@@ -0,0 +1,226 @@
+#include "block_eval.h"
+
+namespace HyperPLTL {
+
+namespace {
+
+using Bits = std::vector<uint64_t>;
+
+size_t numWords(uint32_t top) { return top / 64 + 1; }
+
+/// bits of the last word that hold cycles up to top.
+uint64_t lastMask(uint32_t top) {
+  const unsigned b = top % 64;
+  return b == 63 ? ~uint64_t(0) : (uint64_t(1) << (b + 1)) - 1;
+}
+
+Bits ones(uint32_t top) {
+  Bits v(numWords(top), ~uint64_t(0));
+  v.back() = lastMask(top);
+  return v;
+}
+
+/// Set the bits of cycles from to to - 1.
+void fill(Bits& v, uint64_t from, uint64_t to) {
+  while (from < to) {
+    const unsigned b = from % 64;
+    const uint64_t n = std::min<uint64_t>(64 - b, to - from);
+    v[from / 64] |= (n == 64 ? ~uint64_t(0) : (uint64_t(1) << n) - 1) << b;
+    from += n;
+  }
+}
+
+/*
+ * Temporal operators are evaluated from the last cycle down, so their scans
+ * run from the top word to word 0 and from bit 63 to bit 0 within a word.
+ */
+
+/// v[c] = v[c] && v[c + 1] && ... && v[top].
+void allScan(Bits& v, uint32_t top) {
+  bool carry = true;
+  for (size_t w = v.size(); w-- > 0;) {
+    const uint64_t valid = w + 1 == v.size() ? lastMask(top) : ~uint64_t(0);
+    const uint64_t zeros = ~v[w] & valid;
+    if (zeros == 0) {
+      v[w] = carry ? valid : 0;
+      continue;
+    }
+    // only the cycles above the highest zero hold.
+    const unsigned h = 63 - __builtin_clzll(zeros);
+    v[w] = carry && h < 63 ? valid & (~uint64_t(0) << (h + 1)) : 0;
+    carry = false;
+  }
+}
+
+/// v[c] = v[c] || v[c + 1] || ... || v[top].
+void anyScan(Bits& v, uint32_t top) {
+  bool carry = false;
+  for (size_t w = v.size(); w-- > 0;) {
+    const uint64_t valid = w + 1 == v.size() ? lastMask(top) : ~uint64_t(0);
+    if (carry) {
+      v[w] = valid;
+      continue;
+    }
+    const uint64_t set = v[w] & valid;
+    if (set == 0) {
+      v[w] = 0;
+      continue;
+    }
+    // every cycle up to the highest one set holds.
+    const unsigned h = 63 - __builtin_clzll(set);
+    v[w] = h == 63 ? ~uint64_t(0) : (uint64_t(1) << (h + 1)) - 1;
+    carry = true;
+  }
+}
+
+/// v[c] = v[c + 1], and v[top] = init.
+void nextShift(Bits& v, uint32_t top, bool init) {
+  for (size_t w = 0; w < v.size(); ++w) {
+    const uint64_t above = w + 1 < v.size() ? v[w + 1] << 63 : 0;
+    v[w] = (v[w] >> 1) | above;
+  }
+  const uint64_t bit = uint64_t(1) << (top % 64);
+  v.back() = init ? v.back() | bit : v.back() & ~bit;
+}
+
+}  // namespace
+
+BlockEvaluator::BlockEvaluator(TraceList traces) : traces(std::move(traces)) {
+  assert(!this->traces.empty());
+}
+
+Bits BlockEvaluator::equal(unsigned var, bool array, uint32_t top) {
+  if (traces.size() == 1) return ones(top);
+  Bits out(numWords(top), 0);
+  std::vector<size_t> hints(traces.size(), 0);
+
+  // the comparison holds between two consecutive changes of any trace; every
+  // trace is read at each change so that its hint points at the next one.
+  const Trace& first = *traces[0];
+  const bool typed =
+      Trace::allTermKind(traces, var, array ? TermKind::ARRAY : TermKind::INT);
+  for (uint64_t cycle = 0; cycle <= top;) {
+    bool same = true;
+    if (!typed) {
+      // stored in another kind of column than declared: compare values.
+      const ValueType v0 = first.termValueAt(var, cycle, hints[0]);
+      for (size_t t = 1; t < traces.size(); ++t) {
+        same &= traces[t]->termValueAt(var, cycle, hints[t]) == v0;
+      }
+    } else if (array) {
+      const ArrayView v0 = first.valueAt(first.arraySignal(var), cycle, hints[0]);
+      for (size_t t = 1; t < traces.size(); ++t) {
+        const Trace& tr = *traces[t];
+        same &= tr.valueAt(tr.arraySignal(var), cycle, hints[t]) == v0;
+      }
+    } else {
+      const uint32_t v0 = first.valueAt(first.intSignal(var), cycle, hints[0]);
+      for (size_t t = 1; t < traces.size(); ++t) {
+        const Trace& tr = *traces[t];
+        same &= tr.valueAt(tr.intSignal(var), cycle, hints[t]) == v0;
+      }
+    }
+    uint64_t next = uint64_t(top) + 1;
+    for (size_t t = 0; t < traces.size(); ++t) {
+      next = std::min<uint64_t>(next, traces[t]->nextTermChange(var, hints[t]));
+    }
+    if (same) fill(out, cycle, next);
+    cycle = next;
+  }
+  return out;
+}
+
+Bits BlockEvaluator::eval(const HyperProp* f, uint32_t top) {
+  auto arg = [&](size_t k) {
+    return eval(static_cast<const HyperProp*>(f->getArgs()[k].get()), top);
+  };
+
+  if (auto sel = dynamic_cast<const TraceSelect*>(f)) {
+    const Formula* p = sel->getArgs()[0].get();
+    if (auto var = dynamic_cast<const PropVar*>(p)) {
+      assert(sel->getTrace() < traces.size());
+      const Trace& tr = *traces[sel->getTrace()];
+      Bits out(numWords(top));
+      size_t hint = 0;
+      for (size_t w = 0; w < out.size(); ++w) {
+        out[w] = tr.propWordAt(var->getIndex(), w, hint);
+      }
+      out.back() &= lastMask(top);
+      return out;
+    }
+    if (dynamic_cast<const True*>(p)) return ones(top);
+  } else if (auto eq = dynamic_cast<const Equal*>(f)) {
+    const Formula* term = eq->getArgs()[0].get();
+    if (auto var = dynamic_cast<const TermVar*>(term)) {
+      return equal(var->getIndex(), false, top);
+    }
+    if (auto var = dynamic_cast<const TermArrayVar*>(term)) {
+      return equal(var->getIndex(), true, top);
+    }
+  } else if (dynamic_cast<const Not*>(f)) {
+    Bits v = arg(0);
+    for (auto& word : v) word = ~word;
+    v.back() &= lastMask(top);
+    return v;
+  } else if (dynamic_cast<const And*>(f)) {
+    Bits v = ones(top);
+    for (size_t k = 0; k < f->getArgs().size(); ++k) {
+      const Bits a = arg(k);
+      for (size_t w = 0; w < v.size(); ++w) v[w] &= a[w];
+    }
+    return v;
+  } else if (dynamic_cast<const Or*>(f)) {
+    Bits v(numWords(top), 0);
+    for (size_t k = 0; k < f->getArgs().size(); ++k) {
+      const Bits a = arg(k);
+      for (size_t w = 0; w < v.size(); ++w) v[w] |= a[w];
+    }
+    return v;
+  } else if (dynamic_cast<const Implies*>(f)) {
+    Bits v = arg(0);
+    const Bits b = arg(1);
+    for (size_t w = 0; w < v.size(); ++w) v[w] = ~v[w] | b[w];
+    v.back() &= lastMask(top);
+    return v;
+  } else if (dynamic_cast<const AlwaysPlus*>(f)) {
+    Bits v = arg(0);
+    allScan(v, top);
+    return v;
+  } else if (dynamic_cast<const FutureMinus*>(f)) {
+    Bits v = arg(0);
+    anyScan(v, top);
+    return v;
+  } else if (dynamic_cast<const NextPlus*>(f) || dynamic_cast<const NextMinus*>(f)) {
+    Bits v = arg(0);
+    nextShift(v, top, dynamic_cast<const NextPlus*>(f) != nullptr);
+    return v;
+  } else if (dynamic_cast<const AlwaysMinus*>(f)) {
+    return Bits(numWords(top), 0);
+  } else if (dynamic_cast<const FuturePlus*>(f)) {
+    return ones(top);
+  } else if (dynamic_cast<const Since*>(f)) {
+    // f2 is evaluated down to the first cycle it holds, where the result is
+    // still false; below it, f1 is evaluated from its initial state, and the
+    // result holds as long as f1 has held since.
+    const Bits f2 = arg(1);
+    Bits v(numWords(top), 0);
+    size_t w = f2.size();
+    while (w > 0 && f2[w - 1] == 0) --w;
+    if (w == 0) return v;
+    const uint32_t start = (w - 1) * 64 + 63 - __builtin_clzll(f2[w - 1]);
+    if (start == 0) return v;
+    Bits f1 = eval(static_cast<const HyperProp*>(f->getArgs()[0].get()), start - 1);
+    allScan(f1, start - 1);
+    std::copy(f1.begin(), f1.end(), v.begin());
+    return v;
+  }
+
+  std::cerr << "Error : formula can not be evaluated in blocks\n";
+  exit(1);
+}
+
+Bits BlockEvaluator::evaluate(PHyperProp formula) {
+  return eval(formula.get(), traces[0]->length() - 1);
+}
+
+}  // namespace HyperPLTL
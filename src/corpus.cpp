@@ -0,0 +1,299 @@
+#include "corpus.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstddef>
+#include <cstring>
+
+#include "trace_view.h"
+
+using namespace HyperPLTL;
+
+namespace {
+
+/*
+ * The header is CORPUS_MAGIC, the version, the format of the traces, the
+ * size of the schema that follows it, and the offset of the newest table of
+ * contents. A table is the offset of the table before it, or 0 for the
+ * first, the number of traces it lists, and their entries.
+ */
+
+const uint32_t CORPUS_MAGIC = 0x4f43504c;  // "LPCO"
+const uint32_t CORPUS_VERSION = 2;
+
+struct CorpusHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t format;
+  uint32_t schemaSize;
+  uint64_t toc;
+  uint64_t reserved[5];
+};
+
+static_assert(sizeof(CorpusHeader) == 64 && sizeof(CorpusEntry) == 32);
+
+/// traces start on 8-byte boundaries, as TraceView requires.
+const size_t ALIGN = 8;
+
+uint64_t fingerprint(const uint8_t* data, size_t size) {
+  uint64_t hash = 0xcbf29ce484222325ull;
+  for (size_t i = 0; i < size; ++i) hash = (hash ^ data[i]) * 0x100000001b3ull;
+  return hash;
+}
+
+void putU32(std::string& out, uint32_t v) {
+  out.append(reinterpret_cast<const char*>(&v), sizeof(v));
+}
+
+void putString(std::string& out, const std::string& s) {
+  putU32(out, s.size());
+  out += s;
+}
+
+/// Reads the schema, failing on any field past its end.
+struct SchemaReader {
+  const uint8_t* data;
+  size_t size;
+  size_t pos = 0;
+  bool ok = true;
+
+  uint32_t u32() {
+    uint32_t v = 0;
+    if (pos + sizeof(v) > size) {
+      ok = false;
+      return 0;
+    }
+    memcpy(&v, data + pos, sizeof(v));
+    pos += sizeof(v);
+    return v;
+  }
+
+  std::string string() {
+    const uint32_t len = u32();
+    if (!ok || pos + len > size) {
+      ok = false;
+      return "";
+    }
+    pos += len;
+    return std::string(reinterpret_cast<const char*>(data + pos - len), len);
+  }
+};
+
+std::string storeSchema(const VarMap& varmap) {
+  std::string out;
+  putU32(out, varmap.numProps());
+  for (unsigned i = 0; i < varmap.numProps(); ++i) putString(out, varmap.getPropName(i));
+  putU32(out, varmap.numVars());
+  for (unsigned i = 0; i < varmap.numVars(); ++i) {
+    putU32(out, uint32_t(varmap.getVarType(varmap.getVarName(i))));
+    putU32(out, varmap.getArrayDim(i));
+    putU32(out, varmap.getVarWidth(i));
+    putString(out, varmap.getVarName(i));
+  }
+  return out;
+}
+
+PVarMap loadSchema(const uint8_t* data, size_t size) {
+  PVarMap varmap = std::make_shared<VarMap>();
+  SchemaReader in{data, size};
+  const uint32_t numProps = in.u32();
+  for (uint32_t i = 0; in.ok && i < numProps; ++i) varmap->addPropVar(in.string());
+  const uint32_t numVars = in.u32();
+  for (uint32_t i = 0; in.ok && i < numVars; ++i) {
+    const VarType type = VarType(in.u32());
+    const uint32_t dim = in.u32();
+    const uint32_t width = in.u32();
+    const std::string name = in.string();
+    if (!in.ok || width == 0 || width > Trace::MAX_WIDTH) return nullptr;
+    if (type == VarType::ARRAY_VAR) {
+      varmap->addArrayVar(name, dim, width);
+    } else {
+      varmap->addIntVar(name, width);
+    }
+  }
+  return in.ok ? varmap : nullptr;
+}
+
+uint64_t align(uint64_t offset) { return (offset + ALIGN - 1) / ALIGN * ALIGN; }
+
+/// Write size bytes of data at offset of fd; return false on any error.
+bool writeAt(int fd, const void* data, size_t size, uint64_t offset) {
+  const char* p = static_cast<const char*>(data);
+  while (size > 0) {
+    const ssize_t n = pwrite(fd, p, size, offset);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) return false;
+    p += n;
+    size -= n;
+    offset += n;
+  }
+  return true;
+}
+
+}  // namespace
+
+std::shared_ptr<Corpus> Corpus::create(const std::string& path, PVarMap varmap,
+                                       TraceFormat format) {
+  const std::string schema = storeSchema(*varmap);
+  CorpusHeader header = {};
+  header.magic = CORPUS_MAGIC;
+  header.version = CORPUS_VERSION;
+  header.format = uint32_t(format);
+  header.schemaSize = schema.size();
+
+  // an empty table, the first and last of the chain.
+  header.toc = align(sizeof(header) + schema.size());
+  const uint64_t table[2] = {0, 0};
+  int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) return nullptr;
+  const bool written = writeAt(fd, &header, sizeof(header), 0) &&
+                       writeAt(fd, schema.data(), schema.size(), sizeof(header)) &&
+                       writeAt(fd, table, sizeof(table), header.toc) &&
+                       fdatasync(fd) == 0;
+  close(fd);
+  if (!written) return nullptr;
+  return open(path);
+}
+
+std::shared_ptr<Corpus> Corpus::open(const std::string& path) {
+  std::shared_ptr<Corpus> corpus(new Corpus());
+  corpus->path = path;
+  if (!corpus->map()) return nullptr;
+  return corpus;
+}
+
+bool Corpus::map() {
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) return false;
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size < off_t(sizeof(CorpusHeader))) {
+    close(fd);
+    return false;
+  }
+  const size_t size = st.st_size;
+  void* addr = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (addr == MAP_FAILED) return false;
+  std::shared_ptr<const uint8_t> file(static_cast<const uint8_t*>(addr),
+                                      [size](const uint8_t* p) {
+                                        munmap(const_cast<uint8_t*>(p), size);
+                                      });
+
+  CorpusHeader header;
+  memcpy(&header, file.get(), sizeof(header));
+  const uint64_t start = sizeof(header) + header.schemaSize;
+  if (header.magic != CORPUS_MAGIC || header.version != CORPUS_VERSION ||
+      start > size) {
+    return false;
+  }
+
+  // follow the chain of tables back to the first; each is before the last.
+  std::vector<uint64_t> tables;
+  for (uint64_t t = header.toc; tables.empty() || t != 0;) {
+    uint64_t link[2];
+    if (t % ALIGN != 0 || t < start || t > size - sizeof(link) ||
+        (!tables.empty() && t >= tables.back())) {
+      return false;
+    }
+    tables.push_back(t);
+    memcpy(link, file.get() + t, sizeof(link));
+    t = link[0];
+  }
+
+  PVarMap schema = loadSchema(file.get() + sizeof(header), header.schemaSize);
+  if (!schema) return false;
+  std::vector<CorpusEntry> table;
+  for (auto t = tables.rbegin(); t != tables.rend(); ++t) {
+    uint64_t count;
+    memcpy(&count, file.get() + *t + sizeof(uint64_t), sizeof(count));
+    const uint64_t first = *t + 2 * sizeof(uint64_t);
+    if (count > (size - first) / sizeof(CorpusEntry)) return false;
+    const size_t n = table.size();
+    table.resize(n + count);
+    memcpy(table.data() + n, file.get() + first, count * sizeof(CorpusEntry));
+    for (size_t k = n; k < table.size(); ++k) {
+      const CorpusEntry& e = table[k];
+      if (e.offset % ALIGN != 0 || e.offset < start || e.offset > *t ||
+          e.size > *t - e.offset) {
+        return false;
+      }
+    }
+  }
+
+  varmap = schema;
+  format = TraceFormat(header.format);
+  entries.swap(table);
+  mapping = file;
+  mappedSize = size;
+  toc = header.toc;
+  return true;
+}
+
+PTrace Corpus::trace(size_t i) const {
+  const CorpusEntry& e = entry(i);
+  const uint8_t* source = mapping.get() + e.offset;
+
+  // ask for the next trace to be read ahead while this one is decoded.
+  if (i + 1 < entries.size()) {
+    const uintptr_t page = sysconf(_SC_PAGESIZE);
+    const uintptr_t next = uintptr_t(mapping.get() + entries[i + 1].offset);
+    const uintptr_t start = next / page * page;
+    madvise(reinterpret_cast<void*>(start), next + entries[i + 1].size - start,
+            MADV_WILLNEED);
+  }
+
+  if (format == TraceFormat::MAPPED) return std::make_shared<TraceView>(source, mapping);
+  return TraceSerialize::load(const_cast<uint8_t*>(source));
+}
+
+TraceList Corpus::traces(size_t first, size_t last) const {
+  assert(first <= last && last <= entries.size());
+  TraceList list;
+  list.reserve(last - first);
+  for (size_t i = first; i < last; ++i) list.push_back(trace(i));
+  return list;
+}
+
+bool Corpus::verify(size_t i) const {
+  const CorpusEntry& e = entry(i);
+  return fingerprint(mapping.get() + e.offset, e.size) == e.fingerprint;
+}
+
+bool Corpus::append(const TraceList& traces) {
+  // the new traces and their table go after the end of the file, where the
+  // header does not point until they are synced.
+  int fd = ::open(path.c_str(), O_RDWR);
+  if (fd < 0) return false;
+  uint64_t offset = mappedSize;
+  std::vector<CorpusEntry> added;
+  std::vector<uint64_t> buffer;
+  bool written = true;
+  for (const PTrace& trace : traces) {
+    assert(trace->numProps() == varmap->numProps() &&
+           trace->numVars() == varmap->numVars());
+    offset = align(offset);
+    const size_t size = TraceSerialize::getByteSize(trace, format);
+    buffer.resize((size + 7) / 8);
+    uint8_t* data = reinterpret_cast<uint8_t*>(buffer.data());
+    TraceSerialize::store(data, trace, format);
+    written = written && writeAt(fd, data, size, offset);
+    added.push_back(CorpusEntry{offset, size, fingerprint(data, size),
+                                uint32_t(trace->length()), 0});
+    offset += size;
+  }
+
+  const uint64_t table = align(offset);
+  const uint64_t link[2] = {toc, added.size()};
+  written = written && writeAt(fd, link, sizeof(link), table) &&
+            writeAt(fd, added.data(), added.size() * sizeof(CorpusEntry),
+                    table + sizeof(link)) &&
+            fdatasync(fd) == 0 &&
+            writeAt(fd, &table, sizeof(table), offsetof(CorpusHeader, toc)) &&
+            fdatasync(fd) == 0;
+  close(fd);
+  return written && map();
+}
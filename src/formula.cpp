@@ -24,6 +24,33 @@ const std::string& VarMap::getVarName(unsigned i) const {
   return varNames[i];
 }
 
+const std::string& VarMap::getPropName(unsigned i) const {
+  assert(i < propNames.size());
+  return propNames[i];
+}
+
+uint32_t VarMap::getArrayDim(unsigned i) const {
+  assert(i < varDims.size());
+  return varDims[i];
+}
+
+uint32_t VarMap::getVarWidth(unsigned i) const {
+  assert(i < varWidths.size());
+  return varWidths[i];
+}
+
+PTrace VarMap::createTrace() const {
+  PTrace trace(new Trace(numProps(), numVars()));
+  for (unsigned i = 0; i < varNames.size(); ++i) {
+    if (getVarType(varNames[i]) == VarType::ARRAY_VAR) {
+      trace->declareArrayVar(i, varDims[i], varWidths[i]);
+    } else {
+      trace->declareIntVar(i, varWidths[i]);
+    }
+  }
+  return trace;
+}
+
 unsigned VarMap::getVarIndex(const std::string& name) const {
   auto it = std::find(varNames.begin(), varNames.end(), name);
   assert(it != varNames.end());
@@ -53,17 +80,31 @@ unsigned VarMap::addVar(const std::string& name, VarType type) {
 
   varInfo[name] = type;
   varNames.push_back(name);
+  varDims.push_back(0);
+  varWidths.push_back(Trace::MAX_WIDTH);
   return varNames.size() - 1;
 }
 
-unsigned VarMap::addIntVar(const std::string& name) {
-  return addVar(name, VarType::INT_VAR);
+unsigned VarMap::addIntVar(const std::string& name, uint32_t width) {
+  assert(width > 0 && width <= Trace::MAX_WIDTH);
+  unsigned index = addVar(name, VarType::INT_VAR);
+  varWidths[index] = width;
+  return index;
 }
 
 unsigned VarMap::addArrayVar(const std::string& name) {
   return addVar(name, VarType::ARRAY_VAR);
 }
 
+unsigned VarMap::addArrayVar(const std::string& name, uint32_t dim, uint32_t width) {
+  assert(width > 0 && width <= Trace::MAX_WIDTH);
+  unsigned index = addVar(name, VarType::ARRAY_VAR);
+  assert(varDims[index] == 0 || varDims[index] == dim);
+  varDims[index] = dim;
+  varWidths[index] = width;
+  return index;
+}
+
 unsigned VarMap::addPropVar(const std::string& name) {
   std::vector<std::string>::const_iterator it =
       std::find(propNames.begin(), propNames.end(), name);
@@ -100,24 +141,89 @@ bool VarMap::hasPropVar(const std::string& name) {
   return it->second == VarType::PROP_VAR;
 }
 
+// ---------------------------------------------------------------------- //
+//                            class EvalState                             //
+// ---------------------------------------------------------------------- //
+
+EvalState::EvalState(const Formula& formula)
+    : flags(formula.getStateSize()), numLeaves(formula.getNumLeaves()), numTraces(0) {
+  formula.initState(flags.data());
+  initial = flags;
+}
+
+void EvalState::reset() {
+  flags = initial;
+  std::fill(hints.begin(), hints.end(), 0);
+}
+
+// ---------------------------------------------------------------------- //
+//                            class Formula                               //
+// ---------------------------------------------------------------------- //
+
+void Formula::addArg(PFormula f) {
+  argFlags.push_back(stateSize);
+  argLeaves.push_back(numLeaves);
+  stateSize += f->getStateSize();
+  numLeaves += f->getNumLeaves();
+  args.push_back(f);
+}
+
+void Formula::initState(uint8_t* state) const {
+  for (size_t k = 0; k < args.size(); ++k) args[k]->initState(state + argFlags[k]);
+}
+
+EvalState::Ref HyperProp::ownState(const TraceList& traces) {
+  if (!own) own = std::make_unique<EvalState>(*this);
+  return own->bind(traces);
+}
+
+unsigned Formula::historyDepth() const {
+  unsigned depth = 0;
+  for (auto& arg : args) depth = std::max(depth, arg->historyDepth());
+  return depth;
+}
+
+void Formula::collectSignals(TraceProjection& projection) const {
+  for (auto& arg : args) arg->collectSignals(projection);
+}
+
 // ---------------------------------------------------------------------- //
 //                               class True                               //
 // ---------------------------------------------------------------------- //
 void True::display(std::ostream& out) const { out << "true"; }
 
 bool True::propValue([[maybe_unused]] uint32_t cycle, [[maybe_unused]] unsigned trace,
-                     [[maybe_unused]] const TraceList& traces) {
+                     [[maybe_unused]] const TraceList& traces,
+                     [[maybe_unused]] size_t* hints) const {
   return true;
 }
 
+uint64_t True::propWord([[maybe_unused]] uint32_t w, [[maybe_unused]] unsigned trace,
+                        [[maybe_unused]] const TraceList& traces,
+                        [[maybe_unused]] size_t* hints) const {
+  return ~uint64_t(0);
+}
+
 // ---------------------------------------------------------------------- //
 //                            class TermVar                               //
 // ---------------------------------------------------------------------- //
 void TermVar::display(std::ostream& out) const { out << var_map->getVarName(index); }
 
-ValueType TermVar::termValue(uint32_t cycle, unsigned trace, const TraceList& traces) {
+ValueType TermVar::termValue(uint32_t cycle, unsigned trace, const TraceList& traces,
+                             size_t* hints) const {
+  assert(traces.size() > trace);
+  return traces[trace]->termValueAt(index, cycle, hints[trace]);
+}
+
+uint32_t TermVar::intValue(uint32_t cycle, unsigned trace, const TraceList& traces,
+                           size_t* hints) const {
   assert(traces.size() > trace);
-  return traces[trace]->termValueAt(index, cycle);
+  const Trace& tr = *traces[trace];
+  return tr.valueAt(tr.intSignal(index), cycle, hints[trace]);
+}
+
+void TermVar::collectSignals(TraceProjection& projection) const {
+  projection.addVar(index);
 }
 
 // ---------------------------------------------------------------------- //
@@ -127,9 +233,20 @@ ValueType TermVar::termValue(uint32_t cycle, unsigned trace, const TraceList& tr
 void TermArrayVar::display(std::ostream& out) const { out << var_map->getVarName(index); }
 
 ValueType TermArrayVar::termValue(uint32_t cycle, unsigned trace,
-                                  const TraceList& traces) {
+                                  const TraceList& traces, size_t* hints) const {
   assert(traces.size() > trace);
-  return traces[trace]->termValueAt(index, cycle);
+  return traces[trace]->termValueAt(index, cycle, hints[trace]);
+}
+
+ArrayView TermArrayVar::arrayValue(uint32_t cycle, unsigned trace,
+                                   const TraceList& traces, size_t* hints) const {
+  assert(traces.size() > trace);
+  const Trace& tr = *traces[trace];
+  return tr.valueAt(tr.arraySignal(index), cycle, hints[trace]);
+}
+
+void TermArrayVar::collectSignals(TraceProjection& projection) const {
+  projection.addVar(index);
 }
 
 // ---------------------------------------------------------------------- //
@@ -137,10 +254,21 @@ ValueType TermArrayVar::termValue(uint32_t cycle, unsigned trace,
 // ---------------------------------------------------------------------- //
 void PropVar::display(std::ostream& out) const { out << var_map->getVarName(index); }
 
-bool PropVar::propValue(uint32_t cycle, unsigned trace, const TraceList& traces) {
+bool PropVar::propValue(uint32_t cycle, unsigned trace, const TraceList& traces,
+                        size_t* hints) const {
   // eval not well-defined when multiple traces are available.
   assert(trace < traces.size());
-  return traces[trace]->propValueAt(index, cycle);
+  return traces[trace]->propValueAt(index, cycle, hints[trace]);
+}
+
+uint64_t PropVar::propWord(uint32_t w, unsigned trace, const TraceList& traces,
+                           size_t* hints) const {
+  assert(trace < traces.size());
+  return traces[trace]->propWordAt(index, w, hints[trace]);
+}
+
+void PropVar::collectSignals(TraceProjection& projection) const {
+  projection.addProp(index);
 }
 
 // ---------------------------------------------------------------------- //
@@ -155,23 +283,34 @@ void Equal::display(std::ostream& out) const {
   out << ")";
 }
 
-bool Equal::eval(uint32_t cycle, const TraceList& traces) {
+bool Equal::evaluate(uint32_t cycle, const TraceList& traces,
+                     EvalState::Ref state) const {
   // eval not well-defined when multiple traces are available.
   assert(traces.size() > 0);
+  size_t* hints = argState(state, 0).hints;
+
+  // a variable stored in a column of another kind than the one declared, in
+  // any trace, is compared by value below.
+  if (arrayArg && Trace::allTermKind(traces, arrayArg->getIndex(), TermKind::ARRAY)) {
+    ArrayView vec0 = arrayArg->arrayValue(cycle, 0, traces, hints);
+    for (unsigned i = 1; i != traces.size(); i++) {
+      if (arrayArg->arrayValue(cycle, i, traces, hints) != vec0) return false;
+    }
+    return true;
+  }
 
-  if (PTermArray arg = std::dynamic_pointer_cast<TermArrayVar>(args[0]); arg) {
-    ValueType vec0 = arg->termValue(cycle, 0, traces);
-    //    assert(vec0.size() == arg->getSize());
+  if (intArg && Trace::allTermKind(traces, intArg->getIndex(), TermKind::INT)) {
+    uint32_t v0 = intArg->intValue(cycle, 0, traces, hints);
     for (unsigned i = 1; i != traces.size(); i++) {
-      if (arg->termValue(cycle, i, traces) != vec0) return false;
+      if (intArg->intValue(cycle, i, traces, hints) != v0) return false;
     }
     return true;
   }
 
   if (PTerm arg = std::dynamic_pointer_cast<Term>(args[0]); arg) {
-    ValueType v0 = arg->termValue(cycle, 0, traces);
+    ValueType v0 = arg->termValue(cycle, 0, traces, hints);
     for (unsigned i = 1; i != traces.size(); i++) {
-      if (arg->termValue(cycle, i, traces) != v0) return false;
+      if (arg->termValue(cycle, i, traces, hints) != v0) return false;
     }
     return true;
   }
@@ -189,9 +328,20 @@ void TraceSelect::display(std::ostream& out) const {
   out << ")";
 }
 
-bool TraceSelect::eval(uint32_t cycle, const TraceList& traces) {
-  auto p = std::dynamic_pointer_cast<TraceProp>(args[0]);
-  return p->propValue(cycle, trace, traces);
+bool TraceSelect::evaluate(uint32_t cycle, const TraceList& traces,
+                           EvalState::Ref state) const {
+  auto p = static_cast<const TraceProp*>(args[0].get());
+  return p->propValue(cycle, trace, traces, argState(state, 0).hints);
+}
+
+uint64_t TraceSelect::evalWord(uint32_t w, const TraceList& traces) {
+  return evalWord(w, traces, ownState(traces));
+}
+
+uint64_t TraceSelect::evalWord(uint32_t w, const TraceList& traces,
+                               EvalState::Ref state) const {
+  auto p = static_cast<const TraceProp*>(args[0].get());
+  return p->propWord(w, trace, traces, argState(state, 0).hints);
 }
 
 // ---------------------------------------------------------------------- //
@@ -203,10 +353,9 @@ void Not::display(std::ostream& out) const {
   out << ")";
 }
 
-bool Not::eval(uint32_t cycle, const TraceList& traces) {
-  using namespace std;
-  auto p = dynamic_pointer_cast<HyperProp>(args[0]);
-  return !p->eval(cycle, traces);
+bool Not::evaluate(uint32_t cycle, const TraceList& traces, EvalState::Ref state) const {
+  auto p = static_cast<const HyperProp*>(args[0].get());
+  return !p->evaluate(cycle, traces, argState(state, 0));
 }
 
 // ---------------------------------------------------------------------- //
@@ -221,12 +370,11 @@ void And::display(std::ostream& out) const {
   out << ")";
 }
 
-bool And::eval(uint32_t cycle, const TraceList& traces) {
-  using namespace std;
+bool And::evaluate(uint32_t cycle, const TraceList& traces, EvalState::Ref state) const {
   bool r = true;
-  for (auto arg : args) {
-    auto p = dynamic_pointer_cast<HyperProp>(arg);
-    bool currval = p->eval(cycle, traces);
+  for (size_t k = 0; k < args.size(); ++k) {
+    auto p = static_cast<const HyperProp*>(args[k].get());
+    bool currval = p->evaluate(cycle, traces, argState(state, k));
     r = r && currval;
   }
   return r;
@@ -244,11 +392,11 @@ void Or ::display(std::ostream& out) const {
   out << ")";
 }
 
-bool Or::eval(uint32_t cycle, const TraceList& traces) {
+bool Or::evaluate(uint32_t cycle, const TraceList& traces, EvalState::Ref state) const {
   bool r = false;
-  for (auto arg : args) {
-    auto p = std::dynamic_pointer_cast<HyperProp>(arg);
-    bool currval = p->eval(cycle, traces);
+  for (size_t k = 0; k < args.size(); ++k) {
+    auto p = static_cast<const HyperProp*>(args[k].get());
+    bool currval = p->evaluate(cycle, traces, argState(state, k));
     r = r || currval;
   }
   return r;
@@ -266,12 +414,13 @@ void Implies ::display(std::ostream& out) const {
   out << ")";
 }
 
-bool Implies ::eval(uint32_t cycle, const TraceList& traces) {
-  auto p1 = std::dynamic_pointer_cast<HyperProp>(args[0]);
-  auto p2 = std::dynamic_pointer_cast<HyperProp>(args[1]);
+bool Implies ::evaluate(uint32_t cycle, const TraceList& traces,
+                        EvalState::Ref state) const {
+  auto p1 = static_cast<const HyperProp*>(args[0].get());
+  auto p2 = static_cast<const HyperProp*>(args[1].get());
 
-  bool p1value = p1->eval(cycle, traces);
-  bool p2value = p2->eval(cycle, traces);
+  bool p1value = p1->evaluate(cycle, traces, argState(state, 0));
+  bool p2value = p2->evaluate(cycle, traces, argState(state, 1));
   return (!p1value) || p2value;
 }
 
@@ -285,21 +434,29 @@ void AlwaysPlus::display(std::ostream& out) const {
   out << ")";
 }
 
-bool AlwaysPlus::eval(uint32_t cycle, const TraceList& traces) {
-  auto f = std::dynamic_pointer_cast<HyperProp>(args[0]);
-  bool currval = f->eval(cycle, traces);
+bool AlwaysPlus::evaluate(uint32_t cycle, const TraceList& traces,
+                          EvalState::Ref state) const {
+  auto f = static_cast<const HyperProp*>(args[0].get());
+  bool currval = f->evaluate(cycle, traces, argState(state, 0));
+  uint8_t& past = state.flags[0];
   past = past && currval;
   return past;
 }
 
+void AlwaysPlus::initState(uint8_t* state) const {
+  state[0] = true;
+  HyperProp::initState(state);
+}
+
 void AlwaysMinus::display(std::ostream& out) const {
   out << "(G- ";
   args[0]->display(out);
   out << ")";
 }
 
-bool AlwaysMinus::eval([[maybe_unused]] uint32_t cycle,
-                       [[maybe_unused]] const TraceList& traces) {
+bool AlwaysMinus::evaluate([[maybe_unused]] uint32_t cycle,
+                           [[maybe_unused]] const TraceList& traces,
+                           [[maybe_unused]] EvalState::Ref state) const {
   return false;
 }
 
@@ -313,32 +470,50 @@ void NextMinus::display(std::ostream& out) const {
   out << ")";
 }
 
-bool NextMinus::eval(uint32_t cycle, const TraceList& traces) {
+bool NextMinus::evaluate(uint32_t cycle, const TraceList& traces,
+                         EvalState::Ref state) const {
   // FIXME : need to fix yesterday computation logic or trace compression
   // mechanism, the evaluation seems to be returning past values
 
-  auto f = std::dynamic_pointer_cast<HyperProp>(args[0]);
+  auto f = static_cast<const HyperProp*>(args[0].get());
+  uint8_t& present = state.flags[0];
   bool past = present;
-  present = f->eval(cycle, traces);
+  present = f->evaluate(cycle, traces, argState(state, 0));
   return past;
 }
 
+void NextMinus::initState(uint8_t* state) const {
+  state[0] = false;
+  HyperProp::initState(state);
+}
+
+unsigned NextMinus::historyDepth() const { return 1 + Formula::historyDepth(); }
+
 void NextPlus::display(std::ostream& out) const {
   out << "(X+ ";
   args[0]->display(out);
   out << ")";
 }
 
-bool NextPlus::eval(uint32_t cycle, const TraceList& traces) {
+bool NextPlus::evaluate(uint32_t cycle, const TraceList& traces,
+                        EvalState::Ref state) const {
   // FIXME : need to fix yesterday computation logic or trace compression
   // mechanism, the evaluation seems to be returning past values
 
-  auto f = std::dynamic_pointer_cast<HyperProp>(args[0]);
+  auto f = static_cast<const HyperProp*>(args[0].get());
+  uint8_t& present = state.flags[0];
   bool past = present;
-  present = f->eval(cycle, traces);
+  present = f->evaluate(cycle, traces, argState(state, 0));
   return past;
 }
 
+void NextPlus::initState(uint8_t* state) const {
+  state[0] = true;
+  HyperProp::initState(state);
+}
+
+unsigned NextPlus::historyDepth() const { return 1 + Formula::historyDepth(); }
+
 // ---------------------------------------------------------------------- //
 //                        class once                                      //
 // ---------------------------------------------------------------------- //
@@ -349,21 +524,29 @@ void FutureMinus::display(std::ostream& out) const {
   out << ")";
 }
 
-bool FutureMinus::eval(uint32_t cycle, const TraceList& traces) {
-  auto f = std::dynamic_pointer_cast<HyperProp>(args[0]);
-  bool currval = f->eval(cycle, traces);
+bool FutureMinus::evaluate(uint32_t cycle, const TraceList& traces,
+                           EvalState::Ref state) const {
+  auto f = static_cast<const HyperProp*>(args[0].get());
+  bool currval = f->evaluate(cycle, traces, argState(state, 0));
+  uint8_t& valid = state.flags[0];
   valid = valid || currval;
   return valid;
 }
 
+void FutureMinus::initState(uint8_t* state) const {
+  state[0] = false;
+  HyperProp::initState(state);
+}
+
 void FuturePlus::display(std::ostream& out) const {
   out << "(F+ ";
   args[0]->display(out);
   out << ")";
 }
 
-bool FuturePlus::eval([[maybe_unused]] uint32_t cycle,
-                      [[maybe_unused]] const TraceList& traces) {
+bool FuturePlus::evaluate([[maybe_unused]] uint32_t cycle,
+                          [[maybe_unused]] const TraceList& traces,
+                          [[maybe_unused]] EvalState::Ref state) const {
   return true;
 }
 
@@ -378,19 +561,28 @@ void Since::display(std::ostream& out) const {
   out << ")";
 }
 
-bool Since::eval(uint32_t cycle, const TraceList& traces) {
+bool Since::evaluate(uint32_t cycle, const TraceList& traces,
+                     EvalState::Ref state) const {
   // S(f1, f2) : f2 is true at some point in past and f1 is true since then
-  auto f1 = std::dynamic_pointer_cast<HyperProp>(args[0]);
-  auto f2 = std::dynamic_pointer_cast<HyperProp>(args[1]);
+  auto f1 = static_cast<const HyperProp*>(args[0].get());
+  auto f2 = static_cast<const HyperProp*>(args[1].get());
+  uint8_t& validF1 = state.flags[0];
+  uint8_t& validF2 = state.flags[1];
 
   if (validF2 == false) {
-    validF2 = f2->eval(cycle, traces);
+    validF2 = f2->evaluate(cycle, traces, argState(state, 1));
     return false;
   } else {
-    bool currval = f1->eval(cycle, traces);
+    bool currval = f1->evaluate(cycle, traces, argState(state, 0));
     validF1 = validF1 && currval;
     return validF1;
   }
 }
 
+void Since::initState(uint8_t* state) const {
+  state[0] = true;
+  state[1] = false;
+  HyperProp::initState(state);
+}
+
 }  // namespace HyperPLTL
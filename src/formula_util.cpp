@@ -1,4 +1,9 @@
+#include <algorithm>
+#include <mutex>
+
 #include "formula.h"
+#include "formula_util.h"
+#include "thread_pool.h"
 #include "trace.h"
 
 bool evaluateTraces(HyperPLTL::PHyperProp formula, TraceList const& traces) {
@@ -11,3 +16,114 @@ bool evaluateTraces(HyperPLTL::PHyperProp formula, TraceList const& traces) {
 
   return result;
 }
+
+bool evaluateTraces(HyperPLTL::PHyperProp formula, TraceList const& traces,
+                    HyperPLTL::EvalState& state) {
+  state.reset();
+  bool result = false;
+  for (long id = long(traces[0]->length()) - 1; id >= 0; --id) {
+    result = formula->eval(id, traces, state);
+  }
+  return result;
+}
+
+bool evaluateTraces(const HyperPLTL::Program& program, TraceList const& traces) {
+  HyperPLTL::ProgramState state(program);
+  return evaluateTraces(program, traces, state);
+}
+
+bool evaluateTraces(const HyperPLTL::Program& program, TraceList const& traces,
+                    HyperPLTL::ProgramState& state) {
+  state.reset();
+  bool result = false;
+  for (long id = long(traces[0]->length()) - 1; id >= 0; --id) {
+    result = program.eval(id, traces, state);
+  }
+  return result;
+}
+
+namespace {
+
+/// Return tuple i of k distinct traces out of n, in lexicographic order.
+TraceTuple decodeTuple(size_t i, size_t n, unsigned k) {
+  TraceTuple digits(k);
+  for (unsigned p = k; p-- > 0;) {
+    digits[p] = i % (n - p);
+    i /= n - p;
+  }
+  // digit p picks among the traces the first p positions left.
+  TraceTuple tuple, taken;
+  for (size_t d : digits) {
+    for (size_t t : taken) d += t <= d;
+    tuple.push_back(d);
+    taken.insert(std::upper_bound(taken.begin(), taken.end(), d), d);
+  }
+  return tuple;
+}
+
+}  // namespace
+
+std::vector<TraceTuple> checkAllTuples(HyperPLTL::PHyperProp formula,
+                                       const Corpus& corpus, unsigned k, ThreadPool& pool,
+                                       bool stopAtFirst) {
+  assert(k > 0);
+  const size_t n = corpus.size();
+  if (k > n) return {};
+  // n! / (n - k)! tuples, which must be countable.
+  size_t count = 1;
+  for (unsigned p = 0; p < k; ++p) {
+    if (count > SIZE_MAX / (n - p)) {
+      std::cerr << "Error : too many tuples of " << k << " out of " << n
+                << " traces to check\n";
+      exit(1);
+    }
+    count *= n - p;
+  }
+
+  // every trace is loaded once; each thread evaluates with its own state.
+  const TraceList all = corpus.traces(0, n);
+  std::vector<HyperPLTL::EvalState> states;
+  std::vector<TraceList> lists(pool.size() + 1, TraceList(k));
+  for (unsigned slot = 0; slot <= pool.size(); ++slot) states.emplace_back(*formula);
+
+  std::atomic<bool> stop(false);
+  std::mutex mutex;
+  std::vector<size_t> failed;
+  pool.parallelFor(
+      count,
+      [&](size_t i, unsigned slot) {
+        const TraceTuple tuple = decodeTuple(i, n, k);
+        TraceList& traces = lists[slot];
+        for (unsigned p = 0; p < k; ++p) traces[p] = all[tuple[p]];
+        if (evaluateTraces(formula, traces, states[slot])) return;
+        if (stopAtFirst) stop = true;
+        std::lock_guard<std::mutex> lock(mutex);
+        failed.push_back(i);
+      },
+      &stop);
+
+  std::sort(failed.begin(), failed.end());
+  std::vector<TraceTuple> tuples;
+  for (size_t i : failed) tuples.push_back(decodeTuple(i, n, k));
+  return tuples;
+}
+
+std::vector<TraceTuple> checkAllPairs(HyperPLTL::PHyperProp formula, const Corpus& corpus,
+                                      unsigned threads, bool stopAtFirst) {
+  ThreadPool pool(threads);
+  return checkAllTuples(formula, corpus, 2, pool, stopAtFirst);
+}
+
+bool evaluateBlocks(HyperPLTL::PHyperProp formula, TraceList const& traces) {
+  return HyperPLTL::BlockEvaluator(traces).evaluate(formula)[0] & 1;
+}
+
+uint32_t historyHorizon(HyperPLTL::PHyperProp formula) {
+  return 1 + formula->historyDepth();
+}
+
+TraceProjection traceProjection(HyperPLTL::PHyperProp formula) {
+  TraceProjection projection;
+  formula->collectSignals(projection);
+  return projection;
+}
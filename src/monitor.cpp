@@ -0,0 +1,173 @@
+#include "monitor.h"
+
+#include <algorithm>
+
+#include "formula_util.h"
+
+namespace HyperPLTL {
+
+namespace {
+
+/// Return true if f has no operator that keeps state other than X.
+bool isLocal(const Formula* f) {
+  if (dynamic_cast<const TraceSelect*>(f) || dynamic_cast<const Equal*>(f) ||
+      dynamic_cast<const AlwaysMinus*>(f) || dynamic_cast<const FuturePlus*>(f)) {
+    return true;
+  }
+  if (!dynamic_cast<const Not*>(f) && !dynamic_cast<const And*>(f) &&
+      !dynamic_cast<const Or*>(f) && !dynamic_cast<const Implies*>(f) &&
+      !dynamic_cast<const NextPlus*>(f) && !dynamic_cast<const NextMinus*>(f)) {
+    return false;
+  }
+  for (auto& arg : f->getArgs()) {
+    if (!isLocal(arg.get())) return false;
+  }
+  return true;
+}
+
+using Verdict = Monitor::Verdict;
+
+Verdict verdictOf(bool value) { return value ? Verdict::SATISFIED : Verdict::VIOLATED; }
+
+}  // namespace
+
+Monitor::Monitor(PHyperProp formula, const TraceList& traces)
+    : traces(traces), consumed(0), finished(false), current(Verdict::UNKNOWN) {
+  assert(!traces.empty());
+  addNode(formula);
+  consume(UINT32_MAX);
+}
+
+uint32_t Monitor::addNode(PHyperProp f) {
+  Node node{Node::OPAQUE, {}, nullptr, nullptr, 0, Verdict::UNKNOWN};
+  auto arg = [&](size_t k) {
+    return std::static_pointer_cast<HyperProp>(f->getArgs()[k]);
+  };
+
+  if (isLocal(f.get())) {
+    node.kind = Node::LOCAL;
+    node.program = std::make_unique<Program>(f);
+  } else if (dynamic_cast<const Not*>(f.get()) || dynamic_cast<const And*>(f.get()) ||
+             dynamic_cast<const Or*>(f.get()) || dynamic_cast<const Implies*>(f.get())) {
+    node.kind = dynamic_cast<const Not*>(f.get())   ? Node::NOT
+                : dynamic_cast<const And*>(f.get()) ? Node::AND
+                : dynamic_cast<const Or*>(f.get())  ? Node::OR
+                                                    : Node::IMPLIES;
+    for (size_t k = 0; k < f->getArgs().size(); ++k) node.args.push_back(addNode(arg(k)));
+  } else if ((dynamic_cast<const AlwaysPlus*>(f.get()) ||
+              dynamic_cast<const FutureMinus*>(f.get())) &&
+             isLocal(f->getArgs()[0].get())) {
+    node.kind = dynamic_cast<const AlwaysPlus*>(f.get()) ? Node::ALWAYS : Node::ONCE;
+    node.program = std::make_unique<Program>(arg(0));
+  } else {
+    node.program = std::make_unique<Program>(f);
+  }
+
+  if (node.program) node.state = std::make_unique<ProgramState>(*node.program);
+  nodes.push_back(std::move(node));
+  return nodes.size() - 1;
+}
+
+void Monitor::fold(Node& node, uint32_t upto, uint32_t last) {
+  // G+ holds at cycle 0 if its argument holds at every cycle, F- if at any.
+  const bool stop = node.kind == Node::ONCE;
+  for (; node.next <= upto; ++node.next) {
+    if (node.program->evalAt(node.next, last, traces, *node.state) == stop) {
+      node.value = verdictOf(stop);
+      return;
+    }
+  }
+}
+
+void Monitor::consume(uint32_t last) {
+  // the cycles every argument of a node has arrived for, or all at the end.
+  const uint32_t avail = consumed;
+  for (auto& node : nodes) {
+    if (node.value != Verdict::UNKNOWN) continue;
+    switch (node.kind) {
+      case Node::ALWAYS:
+      case Node::ONCE:
+        if (last != UINT32_MAX) {
+          fold(node, last, last);
+          if (node.value == Verdict::UNKNOWN) {
+            node.value = verdictOf(node.kind == Node::ALWAYS);
+          }
+        } else if (avail >= node.program->lookahead() + 1) {
+          fold(node, avail - 1 - node.program->lookahead(), last);
+        }
+        break;
+      case Node::LOCAL:
+        if (last != UINT32_MAX || avail >= node.program->lookahead() + 1) {
+          node.value = verdictOf(node.program->evalAt(0, last, traces, *node.state));
+        }
+        break;
+      case Node::OPAQUE:
+        if (last != UINT32_MAX) {
+          for (auto& trace : traces) {
+            if (trace->firstCycle() != 0) {
+              std::cerr << "Error : formula needs the whole run, but the trace history "
+                           "starts at cycle "
+                        << trace->firstCycle() << "\n";
+              exit(1);
+            }
+          }
+          node.value = verdictOf(evaluateTraces(*node.program, traces, *node.state));
+        }
+        break;
+      default: {
+        // connectives over three-valued arguments.
+        auto arg = [&](size_t k) { return nodes[node.args[k]].value; };
+        if (node.kind == Node::NOT) {
+          if (arg(0) != Verdict::UNKNOWN) {
+            node.value = verdictOf(arg(0) == Verdict::VIOLATED);
+          }
+        } else if (node.kind == Node::IMPLIES) {
+          if (arg(0) == Verdict::VIOLATED || arg(1) == Verdict::SATISFIED) {
+            node.value = Verdict::SATISFIED;
+          } else if (arg(0) == Verdict::SATISFIED && arg(1) == Verdict::VIOLATED) {
+            node.value = Verdict::VIOLATED;
+          }
+        } else {
+          // AND is decided by a false argument or all true ones, OR dually.
+          const Verdict decisive = verdictOf(node.kind == Node::OR);
+          bool all = true;
+          for (size_t k = 0; k < node.args.size(); ++k) {
+            if (arg(k) == decisive) node.value = decisive;
+            all = all && arg(k) != Verdict::UNKNOWN;
+          }
+          if (node.value == Verdict::UNKNOWN && all) {
+            node.value = verdictOf(node.kind == Node::AND);
+          }
+        }
+      }
+    }
+  }
+  current = nodes.back().value;
+}
+
+Verdict Monitor::step() {
+  if (isFinal()) {
+    ++consumed;
+    return current;
+  }
+  assert(traces[0]->length() > consumed);
+  ++consumed;
+  consume(UINT32_MAX);
+  return current;
+}
+
+Verdict Monitor::update() {
+  while (!isFinal() && consumed < traces[0]->length()) step();
+  consumed = std::max<uint32_t>(consumed, traces[0]->length());
+  return current;
+}
+
+Verdict Monitor::finish() {
+  if (finished) return current;
+  update();
+  finished = true;
+  if (!isFinal()) consume(traces[0]->length() - 1);
+  return current;
+}
+
+}  // namespace HyperPLTL
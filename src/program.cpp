@@ -0,0 +1,218 @@
+#include "program.h"
+
+#include <algorithm>
+
+namespace HyperPLTL {
+
+ProgramState::ProgramState(const Program& program)
+    : slots(program.instructions().size()),
+      state(program.initial()),
+      initial(program.initial()),
+      numHints(program.getNumHints()),
+      numTraces(0) {}
+
+void ProgramState::reset() {
+  state = initial;
+  std::fill(hints.begin(), hints.end(), 0);
+}
+
+Program::Program(PHyperProp formula)
+    : result(0), numHints(0), depth(0), reach(0), local(true) {
+  result = compile(formula.get());
+}
+
+uint32_t Program::emit(Op op, uint32_t a, uint32_t b, uint32_t c) {
+  const uint32_t dst = code.size();
+  code.push_back(Instr{op, dst, a, b, c, depth});
+  reach = std::max(reach, depth + (op == Op::NEXT));
+  local = local && (op < Op::ALWAYS || op == Op::NEXT);
+  return dst;
+}
+
+uint32_t Program::allocState(std::initializer_list<bool> init) {
+  const uint32_t s = initialState.size();
+  initialState.insert(initialState.end(), init.begin(), init.end());
+  return s;
+}
+
+uint32_t Program::compile(const HyperProp* f) {
+  auto arg = [&](size_t k) {
+    return compile(static_cast<const HyperProp*>(f->getArgs()[k].get()));
+  };
+
+  if (auto sel = dynamic_cast<const TraceSelect*>(f)) {
+    const Formula* p = sel->getArgs()[0].get();
+    if (auto var = dynamic_cast<const PropVar*>(p)) {
+      return emit(Op::PROP, var->getIndex(), sel->getTrace(), numHints++);
+    }
+    if (dynamic_cast<const True*>(p)) return emit(Op::CONST, 1);
+  } else if (auto eq = dynamic_cast<const Equal*>(f)) {
+    const Formula* term = eq->getArgs()[0].get();
+    if (auto var = dynamic_cast<const TermVar*>(term)) {
+      return emit(Op::EQ_INT, var->getIndex(), 0, numHints++);
+    }
+    if (auto var = dynamic_cast<const TermArrayVar*>(term)) {
+      return emit(Op::EQ_ARRAY, var->getIndex(), 0, numHints++);
+    }
+  } else if (dynamic_cast<const Not*>(f)) {
+    return emit(Op::NOT, arg(0));
+  } else if (dynamic_cast<const And*>(f) || dynamic_cast<const Or*>(f)) {
+    // every argument is evaluated, in order, and folded into the result.
+    const bool isAnd = dynamic_cast<const And*>(f);
+    const size_t n = f->getArgs().size();
+    if (n == 0) return emit(Op::CONST, isAnd);
+    uint32_t r = arg(0);
+    for (size_t k = 1; k < n; ++k) r = emit(isAnd ? Op::AND : Op::OR, r, arg(k));
+    return r;
+  } else if (dynamic_cast<const Implies*>(f)) {
+    const uint32_t a = arg(0);
+    return emit(Op::IMPLIES, a, arg(1));
+  } else if (dynamic_cast<const AlwaysPlus*>(f)) {
+    const uint32_t s = allocState({true});
+    return emit(Op::ALWAYS, arg(0), 0, s);
+  } else if (dynamic_cast<const AlwaysMinus*>(f)) {
+    return emit(Op::CONST, 0);
+  } else if (dynamic_cast<const FuturePlus*>(f)) {
+    return emit(Op::CONST, 1);
+  } else if (dynamic_cast<const FutureMinus*>(f)) {
+    const uint32_t s = allocState({false});
+    return emit(Op::ONCE, arg(0), 0, s);
+  } else if (dynamic_cast<const NextPlus*>(f) || dynamic_cast<const NextMinus*>(f)) {
+    const uint32_t s = allocState({bool(dynamic_cast<const NextPlus*>(f))});
+    ++depth;
+    const uint32_t a = arg(0);
+    --depth;
+    return emit(Op::NEXT, a, 0, s);
+  } else if (dynamic_cast<const Since*>(f)) {
+    // only f2 is evaluated until it has held once, then only f1; state s is
+    // validF1 and s + 1 validF2.
+    const uint32_t s = allocState({true, false});
+    const size_t test = code.size();
+    emit(Op::SINCE_TEST, 0, 0, s);
+    const uint32_t right = arg(1);
+    const size_t jump = code.size();
+    const uint32_t dst = emit(Op::SINCE_RIGHT, right, 0, s);
+    code[test].a = code.size();
+    const uint32_t left = arg(0);
+    emit(Op::SINCE_LEFT, left, 0, s);
+    code.back().dst = dst;
+    code[jump].b = code.size();
+    return dst;
+  }
+
+  std::cerr << "Error : formula can not be compiled\n";
+  exit(1);
+}
+
+template <bool window>
+bool Program::run(uint32_t cycle, uint32_t last, const TraceList& traces,
+                  ProgramState& state) const {
+  assert(!traces.empty());
+  assert(state.slots.size() == code.size());
+  const size_t numTraces = traces.size();
+  if (numTraces != state.numTraces) {
+    state.numTraces = numTraces;
+    state.hints.assign(size_t(numHints) * numTraces, 0);
+  }
+
+  uint8_t* r = state.slots.data();
+  uint8_t* s = state.state.data();
+  size_t* hints = state.hints.data();
+  const Instr* instr = code.data();
+  const size_t n = code.size();
+  for (size_t pc = 0; pc < n;) {
+    const Instr& in = instr[pc++];
+    // a window reads leaves ahead, and none past the end of the run.
+    const uint32_t at = window ? cycle + in.offset : cycle;
+    switch (in.op) {
+      case Op::CONST:
+        r[in.dst] = in.a;
+        break;
+      case Op::PROP:
+        assert(in.b < numTraces);
+        r[in.dst] = (!window || at <= last) &&
+                    traces[in.b]->propValueAt(in.a, at, hints[in.c * numTraces + in.b]);
+        break;
+      case Op::EQ_INT:
+      case Op::EQ_ARRAY: {
+        if (window && at > last) {
+          r[in.dst] = false;
+          break;
+        }
+        size_t* hint = &hints[in.c * numTraces];
+        const Trace& first = *traces[0];
+        bool equal = true;
+        const TermKind kind = in.op == Op::EQ_INT ? TermKind::INT : TermKind::ARRAY;
+        if (!Trace::allTermKind(traces, in.a, kind)) {
+          // stored in another kind of column than declared: compare values.
+          const ValueType v0 = first.termValueAt(in.a, at, hint[0]);
+          for (size_t t = 1; equal && t < numTraces; ++t) {
+            equal = traces[t]->termValueAt(in.a, at, hint[t]) == v0;
+          }
+        } else if (in.op == Op::EQ_INT) {
+          const uint32_t v0 = first.valueAt(first.intSignal(in.a), at, hint[0]);
+          for (size_t t = 1; equal && t < numTraces; ++t) {
+            const Trace& tr = *traces[t];
+            equal = tr.valueAt(tr.intSignal(in.a), at, hint[t]) == v0;
+          }
+        } else {
+          const ArrayView v0 = first.valueAt(first.arraySignal(in.a), at, hint[0]);
+          for (size_t t = 1; equal && t < numTraces; ++t) {
+            const Trace& tr = *traces[t];
+            equal = tr.valueAt(tr.arraySignal(in.a), at, hint[t]) == v0;
+          }
+        }
+        r[in.dst] = equal;
+        break;
+      }
+      case Op::NOT:
+        r[in.dst] = !r[in.a];
+        break;
+      case Op::AND:
+        r[in.dst] = r[in.a] && r[in.b];
+        break;
+      case Op::OR:
+        r[in.dst] = r[in.a] || r[in.b];
+        break;
+      case Op::IMPLIES:
+        r[in.dst] = !r[in.a] || r[in.b];
+        break;
+      case Op::ALWAYS:
+      case Op::SINCE_LEFT:
+        r[in.dst] = s[in.c] = s[in.c] && r[in.a];
+        break;
+      case Op::NEXT:
+        if (window) {
+          r[in.dst] = at >= last ? initialState[in.c] : r[in.a];
+          break;
+        }
+        r[in.dst] = s[in.c];
+        s[in.c] = r[in.a];
+        break;
+      case Op::ONCE:
+        r[in.dst] = s[in.c] = s[in.c] || r[in.a];
+        break;
+      case Op::SINCE_TEST:
+        if (s[in.c + 1]) pc = in.a;
+        break;
+      case Op::SINCE_RIGHT:
+        s[in.c + 1] = r[in.a];
+        r[in.dst] = false;
+        pc = in.b;
+        break;
+    }
+  }
+  return r[result];
+}
+
+bool Program::eval(uint32_t cycle, const TraceList& traces, ProgramState& state) const {
+  return run<false>(cycle, UINT32_MAX, traces, state);
+}
+
+bool Program::evalAt(uint32_t cycle, uint32_t last, const TraceList& traces,
+                     ProgramState& state) const {
+  assert(local);
+  return run<true>(cycle, last, traces, state);
+}
+
+}  // namespace HyperPLTL
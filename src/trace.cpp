@@ -1,28 +1,554 @@
 
 #include "trace.h"
+#include "thread_pool.h"
+#include "trace_export.h"
+#include "trace_view.h"
+
+namespace {
+
+/// number of frame entries compared with a single memcmp.
+constexpr size_t FRAME_BLOCK = 16;
+
+/**
+ * Call onChange(k) for every k at which cur and prev differ. Runs of
+ * unchanged entries are skipped FRAME_BLOCK elements at a time.
+ */
+template <class T, class Func>
+void forEachChanged(const std::vector<T>& cur, const std::vector<T>& prev,
+                    Func onChange) {
+  const size_t n = cur.size();
+  size_t k = 0;
+  for (; k + FRAME_BLOCK <= n; k += FRAME_BLOCK) {
+    if (memcmp(&cur[k], &prev[k], FRAME_BLOCK * sizeof(T)) == 0) continue;
+    for (size_t j = k; j < k + FRAME_BLOCK; ++j) {
+      if (cur[j] != prev[j]) onChange(j);
+    }
+  }
+  for (; k < n; ++k) {
+    if (cur[k] != prev[k]) onChange(k);
+  }
+}
+
+/// Sink for TraceSerialize::storeChanges() that only counts bytes.
+struct ByteCounter {
+  size_t size = 0;
+  void put([[maybe_unused]] const void* src, size_t n) { size += n; }
+  void patch([[maybe_unused]] size_t at, [[maybe_unused]] uint64_t v) {}
+};
+
+/// Sink for TraceSerialize::storeChanges() that writes to memory.
+struct ByteWriter {
+  uint8_t* dest;
+  size_t size = 0;
+  void put(const void* src, size_t n) {
+    memcpy(dest + size, src, n);
+    size += n;
+  }
+  void patch(size_t at, uint64_t v) { memcpy(dest + at, &v, sizeof(v)); }
+};
+
+template <class Sink, class T>
+void putRaw(Sink& out, T v) {
+  out.put(&v, sizeof(T));
+}
+
+/// Write v in 7-bit groups, low group first, setting the top bit of every
+/// byte but the last.
+template <class Sink>
+void putVarint(Sink& out, uint64_t v) {
+  uint8_t buf[10];
+  size_t n = 0;
+  while (v >= 0x80) {
+    buf[n++] = uint8_t(v) | 0x80;
+    v >>= 7;
+  }
+  buf[n++] = uint8_t(v);
+  out.put(buf, n);
+}
+
+uint64_t getVarint(const uint8_t*& src) {
+  uint64_t v = 0;
+  for (unsigned shift = 0;; shift += 7) {
+    uint8_t b = *src++;
+    v |= uint64_t(b & 0x7f) << shift;
+    if (!(b & 0x80)) return v;
+  }
+}
+
+/// Map a signed delta to an unsigned one, small magnitudes to small values.
+uint64_t zigzag(int64_t v) { return (uint64_t(v) << 1) ^ uint64_t(v >> 63); }
+int64_t unzigzag(uint64_t v) { return int64_t(v >> 1) ^ -int64_t(v & 1); }
+
+template <class T>
+T getRaw(const uint8_t*& src) {
+  T v;
+  memcpy(&v, src, sizeof(T));
+  src += sizeof(T);
+  return v;
+}
+
+/// Sequences of small numbers are packed in blocks of PACK_BLOCK values: a byte
+/// with the bit width of the largest value of the block, then the values at
+/// that width, low bits first. If the top bit of that byte is set, the block
+/// is sparse: a bitmap of its non-zero values comes first, and only those are
+/// packed. A block in which nothing changes is one byte.
+const size_t PACK_BLOCK = 64;
+const uint8_t PACK_SPARSE = 0x80;
+
+/// Appends values of a few bits each to a byte buffer, low bits first.
+struct BitWriter {
+  uint8_t* buf;
+  size_t len = 0;
+  uint64_t acc = 0;
+  unsigned fill = 0;
+
+  void put(uint32_t v, unsigned bits) {
+    acc |= uint64_t(v) << fill;
+    for (fill += bits; fill >= 8; fill -= 8, acc >>= 8) buf[len++] = uint8_t(acc);
+  }
+
+  size_t finish() {
+    if (fill > 0) buf[len++] = uint8_t(acc);
+    acc = fill = 0;
+    return len;
+  }
+};
+
+/// Reads values written by a BitWriter.
+struct BitReader {
+  const uint8_t*& src;
+  uint64_t acc = 0;
+  unsigned fill = 0;
+
+  uint32_t get(unsigned bits) {
+    for (; fill < bits; fill += 8) acc |= uint64_t(*src++) << fill;
+    const uint32_t v = uint32_t(acc & ((uint64_t(1) << bits) - 1));
+    acc >>= bits;
+    fill -= bits;
+    return v;
+  }
+
+  void finish() { acc = fill = 0; }
+};
+
+template <class Sink>
+void putPacked(Sink& out, const std::vector<uint32_t>& values) {
+  uint8_t buf[PACK_BLOCK / 8 + PACK_BLOCK * sizeof(uint32_t)];
+  for (size_t k = 0; k < values.size(); k += PACK_BLOCK) {
+    const size_t n = std::min(PACK_BLOCK, values.size() - k);
+    uint32_t any = 0;
+    size_t nonzero = 0;
+    for (size_t j = k; j < k + n; ++j) {
+      any |= values[j];
+      nonzero += values[j] != 0;
+    }
+    const unsigned bits = any == 0 ? 0 : 32 - __builtin_clz(any);
+    const bool sparse = n + nonzero * bits < n * bits;
+    putRaw(out, uint8_t(bits | (sparse ? PACK_SPARSE : 0)));
+
+    BitWriter w{buf};
+    if (sparse) {
+      for (size_t j = k; j < k + n; ++j) w.put(values[j] != 0, 1);
+      w.finish();
+    }
+    for (size_t j = k; j < k + n; ++j) {
+      if (!sparse || values[j] != 0) w.put(values[j], bits);
+    }
+    out.put(buf, w.finish());
+  }
+}
+
+void getPacked(const uint8_t*& src, size_t count, uint32_t* dest) {
+  BitReader r{src};
+  for (size_t k = 0; k < count; k += PACK_BLOCK) {
+    const size_t n = std::min(PACK_BLOCK, count - k);
+    const uint8_t tag = *src++;
+    const unsigned bits = tag & ~PACK_SPARSE;
+    if (tag & PACK_SPARSE) {
+      for (size_t j = 0; j < n; ++j) dest[k + j] = r.get(1);
+      r.finish();
+      for (size_t j = 0; j < n; ++j) {
+        if (dest[k + j]) dest[k + j] = r.get(bits);
+      }
+    } else {
+      for (size_t j = 0; j < n; ++j) dest[k + j] = r.get(bits);
+    }
+    r.finish();
+  }
+}
+
+std::vector<uint32_t> getPacked(const uint8_t*& src, size_t count) {
+  std::vector<uint32_t> values(count);
+  getPacked(src, count, values.data());
+  return values;
+}
+
+/// Return v - prev as a zigzag value that fits in width bits, for values of
+/// width bits: the difference wraps around like the signal itself.
+uint32_t wrapDelta(uint32_t v, uint32_t prev, uint32_t width) {
+  // Trace keeps every value to its declared width.
+  assert(width == 32 || (v >> width) == 0);
+  const unsigned shift = 64 - width;
+  return uint32_t(zigzag(int64_t(uint64_t(v - prev) << shift) >> shift));
+}
+
+uint32_t unwrapDelta(uint32_t delta, uint32_t prev, uint32_t width) {
+  const uint32_t v = prev + uint32_t(unzigzag(delta));
+  return width == 32 ? v : v & ((uint32_t(1) << width) - 1);
+}
+
+/// A term column is written as its number of datapoints, the distances
+/// between change times, then the differences between successive values at
+/// the declared width of the variable.
+template <class Sink>
+void storeColumn(Sink& out, const VarTrace<uint32_t>& col, uint32_t width) {
+  putVarint(out, col.size());
+  std::vector<uint32_t> times(col.size()), deltas(col.size());
+  uint32_t time = 0, value = 0;
+  for (size_t idx = 0; idx < col.size(); ++idx) {
+    times[idx] = col.changeTime(idx) - time;
+    deltas[idx] = wrapDelta(col.value(idx), value, width);
+    time = col.changeTime(idx);
+    value = col.value(idx);
+  }
+  putPacked(out, times);
+  putPacked(out, deltas);
+}
+
+/// Arrays are written like integers, word by word against the previous value;
+/// values of an undeclared dimension are preceded by their lengths.
+template <class Sink>
+void storeColumn(Sink& out, const ArrayTrace& col, uint32_t width) {
+  const uint32_t dim = col.isFixed() ? col.dimension() : 0;
+  putVarint(out, dim);
+  putVarint(out, col.size());
+  std::vector<uint32_t> times(col.size()), lengths, deltas;
+  uint32_t time = 0;
+  ArrayView prev;
+  for (size_t idx = 0; idx < col.size(); ++idx) {
+    ArrayView v = col.value(idx);
+    times[idx] = col.changeTime(idx) - time;
+    if (dim == 0) lengths.push_back(v.size());
+    for (uint32_t k = 0; k < v.size(); ++k) {
+      deltas.push_back(wrapDelta(v[k], k < prev.size() ? prev[k] : 0, width));
+    }
+    time = col.changeTime(idx);
+    prev = v;
+  }
+  putPacked(out, times);
+  putPacked(out, lengths);
+  putPacked(out, deltas);
+}
+
+}  // namespace
+
+void Trace::captureCycle(uint32_t cycle) {
+  FrameBinding& f = frame;
+
+  // gather the current frame.
+  f.propScratch.resize(f.propAddrs.size());
+  for (size_t k = 0; k < f.propAddrs.size(); ++k) f.propScratch[k] = *f.propAddrs[k];
+  f.intScratch.resize(f.intAddrs.size());
+  for (size_t k = 0; k < f.intAddrs.size(); ++k) {
+    f.intScratch[k] = *f.intAddrs[k] & intMasks[f.intColumns[k]];
+  }
+
+  if (!f.primed) {
+    // first frame after (re)binding: record everything.
+    for (size_t k = 0; k < f.propAddrs.size(); ++k) {
+      propositions[f.propIds[k]].updateValue(cycle, f.propScratch[k]);
+    }
+    for (size_t k = 0; k < f.intAddrs.size(); ++k) {
+      intVars[f.intColumns[k]].updateValue(cycle, f.intScratch[k]);
+    }
+    f.primed = true;
+  } else {
+    forEachChanged(f.propScratch, f.propFrame, [&](size_t k) {
+      propositions[f.propIds[k]].updateValue(cycle, f.propScratch[k]);
+    });
+    forEachChanged(f.intScratch, f.intFrame, [&](size_t k) {
+      intVars[f.intColumns[k]].updateValue(cycle, f.intScratch[k]);
+    });
+  }
+
+  f.propFrame.swap(f.propScratch);
+  f.intFrame.swap(f.intScratch);
+
+  // arrays are compared against the last value in their own arena.
+  for (size_t k = 0; k < f.arrayAddrs.size(); ++k) {
+    const uint32_t column = f.arrayColumns[k];
+    updateArray(column, cycle,
+                ArrayView(f.arrayAddrs[k], arrayVars[column].dimension()));
+  }
+
+  touch(cycle);
+}
+
+void Trace::seal(uint32_t cycle) {
+  assert(!sealed);
+
+  // signals that were never recorded hold their default value.
+  for (auto& p : propositions) {
+    if (p.size() == 0) p.updateValue(0, false);
+  }
+  for (auto& v : intVars) {
+    if (v.size() == 0) v.updateValue(0, 0);
+  }
+  for (auto& v : arrayVars) {
+    if (v.size() == 0) v.updateValue(0, std::vector<uint32_t>(v.dimension(), 0));
+  }
+
+  extendToCycle(cycle);
+
+  for (auto& p : propositions) p.compact();
+  for (auto& v : intVars) v.shrink();
+  for (auto& v : arrayVars) v.shrink();
+
+  sealed = true;
+}
+
+void Trace::copyCycles(const Trace& src, uint32_t from, uint32_t to, uint32_t at) {
+  assert(numProps() == src.numProps() && numVars() == src.numVars() && from <= to);
+
+  for (unsigned pid = 0; pid < numProps(); ++pid) {
+    const PropTrace& prop = src.propositions[pid];
+    if (prop.size() == 0) continue;
+    size_t hint = 0;
+    bool value = prop.valueAt(from, hint);
+    updatePropValue(pid, at, value);
+    prop.forEachChange(from, to, [&](uint32_t t) {
+      updatePropValue(pid, at + (t - from), value = !value);
+    });
+  }
+
+  for (unsigned vid = 0; vid < numVars(); ++vid) {
+    const TermSlot& slot = src.slots[vid];
+    if (slot.kind == TermKind::INT) {
+      const VarTrace<uint32_t>& col = src.intVars[slot.column];
+      IntSignal sig = declareIntVar(vid, slot.width);
+      for (size_t idx = col.find(from); idx < col.size() && col.changeTime(idx) <= to;
+           ++idx) {
+        updateValue(sig, at + (std::max(col.changeTime(idx), from) - from),
+                    col.value(idx));
+      }
+    } else if (slot.kind == TermKind::ARRAY) {
+      const ArrayTrace& col = src.arrayVars[slot.column];
+      ArraySignal sig =
+          declareArrayVar(vid, col.isFixed() ? col.dimension() : 0, slot.width);
+      for (size_t idx = col.find(from); idx < col.size() && col.changeTime(idx) <= to;
+           ++idx) {
+        updateValue(sig, at + (std::max(col.changeTime(idx), from) - from),
+                    col.value(idx));
+      }
+    }
+  }
+
+  touch(at + (to - from));
+}
+
+void Trace::trimHistory() {
+  const uint32_t start = lastCycle + 1 > historyLimit ? lastCycle + 1 - historyLimit : 0;
+
+  for (auto& p : propositions) p.discardBefore(start);
+  for (auto& v : intVars) v.discardBefore(start);
+  for (auto& v : arrayVars) v.discardBefore(start);
+
+  historyStart = std::max(historyStart, start);
+  nextTrim = lastCycle + std::max(historyLimit, MIN_TRIM_INTERVAL);
+}
+
+SignalStats Trace::propStats(unsigned i) const {
+  assert(i < propositions.size());
+  const PropTrace& p = propositions[i];
+  const uint32_t cycles = length() - firstCycle();
+  return SignalStats{p.size(), cycles, p.memoryUsage(), sizeof(bool) * cycles};
+}
+
+SignalStats Trace::termStats(unsigned i) const {
+  const uint32_t cycles = length() - firstCycle();
+  if (termKind(i) == TermKind::NONE) return SignalStats{0, cycles, 0, sizeof(uint32_t)};
+  // every cycle stores dimension() words, plus one for the dimension itself.
+  return visitTerm(i, [&](const auto& col) {
+    return SignalStats{col.size(), cycles, col.memoryUsage(),
+                       sizeof(uint32_t) * (1 + size_t(col.dimension()) * cycles)};
+  });
+}
+
+template <class T>
+static size_t vectorBytes(const std::vector<T>& v) {
+  return v.capacity() * sizeof(T);
+}
 
-size_t TraceSerialize::getByteSize(PTrace trace) {
+size_t Trace::memoryUsage() const {
+  size_t bytes = sizeof(Trace);
+
+  bytes += vectorBytes(propositions) + vectorBytes(intVars) + vectorBytes(arrayVars) +
+           vectorBytes(slots);
+  for (auto& p : propositions) bytes += p.memoryUsage();
+  for (auto& v : intVars) bytes += v.memoryUsage();
+  for (auto& v : arrayVars) bytes += v.memoryUsage();
+
+  bytes += vectorBytes(frame.propAddrs) + vectorBytes(frame.propIds) +
+           vectorBytes(frame.propFrame) + vectorBytes(frame.propScratch) +
+           vectorBytes(frame.intAddrs) + vectorBytes(frame.intColumns) +
+           vectorBytes(frame.intFrame) + vectorBytes(frame.intScratch) +
+           vectorBytes(frame.arrayAddrs) + vectorBytes(frame.arrayColumns);
+  return bytes;
+}
+
+size_t TraceSerialize::getByteSize(PTrace trace, TraceFormat format) {
+  if (format == TraceFormat::MAPPED) return TraceView::getByteSize(*trace);
+  if (format == TraceFormat::CHANGES) {
+    ByteCounter counter;
+    storeChanges(counter, *trace);
+    return counter.size;
+  }
 
   size_t numBytes = 0;
   // headesize = size of totalsize + numprops + numvars + numcycles
   const size_t headerSize = 4 * sizeof(uint32_t);
 
-  numBytes += sizeof(bool) * trace->numProps();
+  numBytes += sizeof(bool) * trace->numProps() * trace->length();
 
   // calculate the number of uint32_t elements in the termIntVar and termArrayVar
   // count 1 for intvar and array size for array var
 
   size_t nTermElems = 0;
-  for (auto& tvar : trace->variables) {
-    nTermElems += std::visit(DimensionVisitor{}, tvar);
+  for (unsigned vid = 0; vid < trace->numVars(); ++vid) {
+    if (trace->termKind(vid) != TermKind::NONE) {
+      nTermElems += trace->visitTerm(vid, DimensionVisitor{});
+    }
   }
 
   numBytes += sizeof(uint32_t) * (trace->numVars() + (nTermElems * trace->length()));
   return numBytes + headerSize;
 }
 
-PTrace TraceSerialize::load(uint8_t* source) {
+bool TraceSerialize::isExpanded(const uint8_t* source) {
+  // the header is the total size, the number of cycles, propositions and
+  // variables; each variable is its dimension and a value per cycle.
+  uint32_t header[4];
+  memcpy(header, source, sizeof(header));
+  const uint64_t numBytes = header[0], ncycles = header[1];
+  uint64_t size = sizeof(header) + uint64_t(header[2]) * ncycles * sizeof(bool);
+  uint32_t vid = 0;
+  for (; vid < header[3] && size + sizeof(uint32_t) <= numBytes; ++vid) {
+    uint32_t dim;
+    memcpy(&dim, source + size, sizeof(dim));
+    size += sizeof(uint32_t) + uint64_t(dim) * ncycles * sizeof(uint32_t);
+  }
+  return vid == header[3] && size == numBytes;
+}
+
+TraceFormat TraceSerialize::getFormat(const uint8_t* source) {
+  uint32_t magic, version;
+  memcpy(&magic, source, sizeof(magic));
+  if (magic != MAGIC) {
+    return isExpanded(source) ? TraceFormat::EXPANDED : TraceFormat::UNKNOWN;
+  }
+  memcpy(&version, source + sizeof(magic), sizeof(version));
+  if (version != uint32_t(TraceFormat::CHANGES) &&
+      version != uint32_t(TraceFormat::MAPPED)) {
+    return TraceFormat::UNKNOWN;
+  }
+  return TraceFormat(version);
+}
+
+PTrace TraceSerialize::load(uint8_t* source) { return decode(source, nullptr, nullptr); }
+
+PTrace TraceSerialize::load(uint8_t* source, const TraceProjection& projection) {
+  return decode(source, &projection, nullptr);
+}
 
+PTrace TraceSerialize::load(uint8_t* source, ThreadPool& pool) {
+  return decode(source, nullptr, &pool);
+}
+
+TraceList TraceSerialize::load(const std::vector<uint8_t*>& sources, ThreadPool& pool) {
+  return decodeAll(sources, nullptr, pool);
+}
+
+TraceList TraceSerialize::load(const std::vector<uint8_t*>& sources,
+                               const TraceProjection& projection, ThreadPool& pool) {
+  return decodeAll(sources, &projection, pool);
+}
+
+PTrace TraceSerialize::decode(uint8_t* source, const TraceProjection* projection,
+                              ThreadPool* pool) {
+  switch (getFormat(source)) {
+    case TraceFormat::CHANGES:
+      return loadChanges(source, projection, pool);
+    case TraceFormat::MAPPED:
+      return loadMapped(source, projection, pool);
+    case TraceFormat::EXPANDED:
+      return loadExpanded(source, projection);
+    default:
+      return nullptr;
+  }
+}
+
+TraceList TraceSerialize::decodeAll(const std::vector<uint8_t*>& sources,
+                                    const TraceProjection* projection, ThreadPool& pool) {
+  TraceList traces(sources.size());
+  // with fewer traces than threads, the signals of each trace are decoded in
+  // parallel too.
+  ThreadPool* inner = sources.size() < pool.size() ? &pool : nullptr;
+  pool.parallelFor(sources.size(),
+                   [&](size_t k) { traces[k] = decode(sources[k], projection, inner); });
+  return traces;
+}
+
+PTrace TraceSerialize::loadMapped(const uint8_t* source,
+                                  const TraceProjection* projection, ThreadPool* pool) {
+  // copy the columns out of the buffer into a trace that can be extended.
+  const TraceView view(source);
+  if (!projection && !pool) {
+    PTrace trace = std::make_shared<Trace>(static_cast<const Trace&>(view));
+    trace->sealed = false;
+    return trace;
+  }
+
+  PTrace trace(new Trace(view.numProps(), view.numVars()));
+  std::vector<size_t> columns;
+  for (unsigned pid = 0; pid < view.numProps(); ++pid) {
+    if (!projection || projection->hasProp(pid)) columns.push_back(pid);
+  }
+  for (unsigned vid = 0; vid < view.numVars(); ++vid) {
+    if (projection && !projection->hasVar(vid)) continue;
+    if (view.termKind(vid) == TermKind::INT) {
+      trace->declareIntVar(vid, view.termWidth(vid));
+    } else if (view.termKind(vid) == TermKind::ARRAY) {
+      trace->declareArrayVar(vid, 0, view.termWidth(vid));
+    }
+    if (view.termKind(vid) != TermKind::NONE) columns.push_back(view.numProps() + vid);
+  }
+
+  auto copyColumn = [&](size_t n) {
+    const size_t k = columns[n];
+    if (k < view.numProps()) {
+      trace->propositions[k] = view.propositions[k];
+      return;
+    }
+    const unsigned vid = k - view.numProps();
+    const uint32_t column = trace->slots[vid].column;
+    if (view.termKind(vid) == TermKind::INT) {
+      trace->intVars[column] = view.intVars[view.slots[vid].column];
+    } else {
+      trace->arrayVars[column] = view.arrayVars[view.slots[vid].column];
+    }
+  };
+
+  if (pool) {
+    pool->parallelFor(columns.size(), copyColumn);
+  } else {
+    for (size_t n = 0; n < columns.size(); ++n) copyColumn(n);
+  }
+  trace->lastCycle = view.lastCycle;
+  return trace;
+}
+
+PTrace TraceSerialize::loadExpanded(const uint8_t* source,
+                                    const TraceProjection* projection) {
   const size_t u32size = sizeof(uint32_t);
   const size_t boolsize = sizeof(bool);
 
@@ -31,7 +557,7 @@ PTrace TraceSerialize::load(uint8_t* source) {
   uint32_t nvars = 0;
   uint32_t ncycles = 0;
 
-  uint8_t* currloc = source;
+  const uint8_t* currloc = source;
 
   memcpy(&numBytes, currloc, u32size);
   currloc += u32size;
@@ -49,6 +575,10 @@ PTrace TraceSerialize::load(uint8_t* source) {
   PTrace trace(new Trace(nprops, nvars));
 
   for (size_t pid = 0; pid < nprops; ++pid) {
+    if (projection && !projection->hasProp(pid)) {
+      currloc += ncycles * boolsize;
+      continue;
+    }
     bool data = false;
     for (size_t tstep = 0; tstep < ncycles; ++tstep) {
       memcpy(&data, currloc, sizeof(bool));
@@ -61,35 +591,194 @@ PTrace TraceSerialize::load(uint8_t* source) {
     uint32_t dim;
     memcpy(&dim, currloc, u32size);
     currloc += u32size;
+    if (dim == 0 || (projection && !projection->hasVar(vid))) {
+      currloc += size_t(dim) * ncycles * u32size;
+      continue;
+    }
 
     uint32_t data = 0;
     if (dim == 1) {
       // IntVar
+      IntSignal sig = trace->declareIntVar(vid);
       for (size_t tstep = 0; tstep < ncycles; ++tstep) {
         memcpy(&data, currloc, u32size);
-        trace->updateTermValue(vid, tstep, data);
+        trace->updateValue(sig, tstep, data);
         currloc += u32size;
       }
     } else {
       // ArrayVar
+      ArraySignal sig = trace->declareArrayVar(vid, dim);
       std::vector<uint32_t> vdata(dim);
       for (size_t tstep = 0; tstep < ncycles; ++tstep) {
+        memcpy(vdata.data(), currloc, dim * u32size);
+        currloc += dim * u32size;
+        // update arrayvar
+        trace->updateValue(sig, tstep, vdata);
+      }
+    }
+  }
+
+  return trace;
+}
+
+template <class Sink>
+void TraceSerialize::storeChanges(Sink& out, const Trace& trace) {
+  // header; the size is filled in by the caller once it is known.
+  putRaw(out, MAGIC);
+  putRaw(out, uint32_t(TraceFormat::CHANGES));
+  putRaw(out, uint64_t(0));
+  putRaw(out, uint32_t(trace.length()));
+  putRaw(out, trace.numProps());
+  putRaw(out, trace.numVars());
+  putRaw(out, uint32_t(0));
+
+  // the directory holds the offset of each proposition, then of each term
+  // variable, so that load() can skip the signals it does not need.
+  const size_t directory = out.size;
+  for (size_t k = 0; k < trace.numProps() + trace.numVars(); ++k) {
+    putRaw(out, uint64_t(0));
+  }
+
+  // a proposition is its initial value and the distance between toggles.
+  for (unsigned pid = 0; pid < trace.numProps(); ++pid) {
+    const PropTrace& prop = trace.propositions[pid];
+    out.patch(directory + pid * sizeof(uint64_t), out.size);
+    putVarint(out, prop.size());
+    if (prop.size() == 0) continue;
+    putRaw(out, uint8_t(prop[prop.firstCycle()]));
+    std::vector<uint32_t> times;
+    times.reserve(prop.size());
+    uint32_t time = 0;
+    prop.forEachChange([&](uint32_t t) {
+      times.push_back(t - time);
+      time = t;
+    });
+    putPacked(out, times);
+  }
+
+  for (unsigned vid = 0; vid < trace.numVars(); ++vid) {
+    TermKind kind = trace.termKind(vid);
+    out.patch(directory + (trace.numProps() + vid) * sizeof(uint64_t), out.size);
+    putRaw(out, uint8_t(kind));
+    if (kind == TermKind::NONE) continue;
+    const uint32_t width = trace.termWidth(vid);
+    putVarint(out, width);
+    trace.visitTerm(vid, [&](const auto& col) { storeColumn(out, col, width); });
+  }
+}
+
+PTrace TraceSerialize::loadChanges(const uint8_t* source,
+                                   const TraceProjection* projection, ThreadPool* pool) {
+  const uint8_t* src = source + 2 * sizeof(uint32_t) + sizeof(uint64_t);
+  const uint32_t ncycles = getRaw<uint32_t>(src);
+  const uint32_t nprops = getRaw<uint32_t>(src);
+  const uint32_t nvars = getRaw<uint32_t>(src);
+  const uint8_t* directory = source + HEADER_SIZE;
+  auto columnAt = [&](size_t k) {
+    const uint8_t* entry = directory + k * sizeof(uint64_t);
+    return source + getRaw<uint64_t>(entry);
+  };
+
+  PTrace trace(new Trace(nprops, nvars));
+
+  // declare the term variables up front; the columns, numbered as in the
+  // directory, can then be decoded independently of each other.
+  std::vector<size_t> columns;
+  for (uint32_t pid = 0; pid < nprops; ++pid) {
+    if (!projection || projection->hasProp(pid)) columns.push_back(pid);
+  }
+  for (uint32_t vid = 0; vid < nvars; ++vid) {
+    if (projection && !projection->hasVar(vid)) continue;
+    src = columnAt(nprops + vid);
+    TermKind kind = TermKind(getRaw<uint8_t>(src));
+    if (kind == TermKind::NONE) continue;
+    uint32_t width = getVarint(src);
+    if (kind == TermKind::INT) trace->declareIntVar(vid, width);
+    if (kind == TermKind::ARRAY) trace->declareArrayVar(vid, getVarint(src), width);
+    columns.push_back(nprops + vid);
+  }
+
+  // datapoints are appended directly to the columns: they are known to be
+  // changes, in order.
+  auto decodeColumn = [&](size_t n) {
+    const size_t k = columns[n];
+    const uint8_t* src = columnAt(k);
+    if (k < nprops) {
+      size_t count = getVarint(src);
+      if (count == 0) return;
+      bool value = getRaw<uint8_t>(src);
+      std::vector<uint32_t> times = getPacked(src, count);
+      uint32_t time = 0;
+      PropTrace& prop = trace->propositions[k];
+      for (size_t idx = 0; idx < count; ++idx, value = !value) {
+        time += times[idx];
+        prop.updateValue(time, value);
+      }
+      return;
+    }
 
-        for (size_t did = 0; did < dim; ++did) {
-          memcpy(&data, currloc, u32size);
-          currloc += u32size;
-          vdata[did] = data;
+    const unsigned vid = k - nprops;
+    const uint32_t width = trace->termWidth(vid);
+    TermKind kind = TermKind(getRaw<uint8_t>(src));
+    getVarint(src);
+    if (kind == TermKind::INT) {
+      VarTrace<uint32_t>& col = trace->intVars[trace->intSignal(vid).column];
+      size_t count = getVarint(src);
+      std::vector<uint32_t> times = getPacked(src, count);
+      std::vector<uint32_t> deltas = getPacked(src, count);
+      uint32_t time = 0, value = 0;
+      for (size_t idx = 0; idx < count; ++idx) {
+        time += times[idx];
+        value = unwrapDelta(deltas[idx], value, width);
+        col.appendChange(time, value);
+      }
+    } else {
+      uint32_t dim = getVarint(src);
+      ArrayTrace& col = trace->arrayVars[trace->arraySignal(vid).column];
+      size_t count = getVarint(src);
+      std::vector<uint32_t> times = getPacked(src, count);
+      std::vector<uint32_t> lengths = getPacked(src, dim == 0 ? count : 0);
+      size_t words = size_t(dim) * count;
+      for (uint32_t len : lengths) words += len;
+      std::vector<uint32_t> deltas = getPacked(src, words);
+
+      uint32_t time = 0;
+      const uint32_t* delta = deltas.data();
+      std::vector<uint32_t> value, prev;
+      for (size_t idx = 0; idx < count; ++idx) {
+        time += times[idx];
+        value.resize(dim != 0 ? dim : lengths[idx]);
+        for (size_t w = 0; w < value.size(); ++w) {
+          value[w] = unwrapDelta(*delta++, w < prev.size() ? prev[w] : 0, width);
         }
-        // update arrayvar
-        trace->updateTermValue(vid, tstep, vdata);
+        col.appendChange(time, value);
+        value.swap(prev);
       }
     }
+  };
+
+  if (pool) {
+    pool->parallelFor(columns.size(), decodeColumn);
+  } else {
+    for (size_t n = 0; n < columns.size(); ++n) decodeColumn(n);
   }
 
+  trace->extendToCycle(ncycles - 1);
   return trace;
 }
 
-size_t TraceSerialize::store(uint8_t* dest, PTrace trace) {
+size_t TraceSerialize::store(uint8_t* dest, PTrace trace, TraceFormat format) {
+  // the serialized form always starts at cycle 0.
+  assert(trace->firstCycle() == 0);
+
+  if (format == TraceFormat::MAPPED) return TraceView::store(dest, *trace);
+  if (format == TraceFormat::CHANGES) {
+    ByteWriter writer{dest};
+    storeChanges(writer, *trace);
+    uint64_t numBytes = writer.size;
+    memcpy(dest + 2 * sizeof(uint32_t), &numBytes, sizeof(numBytes));
+    return writer.size;
+  }
 
   const uint32_t nprops = trace->numProps();
   const uint32_t nvars = trace->numVars();
@@ -116,8 +805,9 @@ size_t TraceSerialize::store(uint8_t* dest, PTrace trace) {
 
   // copy propositions to current desitnation
   for (auto& prop : trace->propositions) {
+    auto cursor = prop.cursor();
     for (uint32_t tstep = 0; tstep < ncycles; ++tstep) {
-      bool data = prop[tstep];
+      bool data = cursor[tstep];
       memcpy(currloc, &data, boolsize);
       currloc += boolsize;
     }
@@ -129,9 +819,15 @@ size_t TraceSerialize::store(uint8_t* dest, PTrace trace) {
   // store array with nvars elemes which stores the dimension of each termvar element
   // stores 1 for IntVar and VarTrace::dimension() for ArrayVar
 
+  // a variable that was never declared has dimension 0 and no values.
   for (uint32_t vid = 0; vid < nvars; ++vid) {
-    uint32_t bsize =
-        std::visit(TraceStoreVisitor{currloc, ncycles}, trace->variables[vid]);
+    if (trace->termKind(vid) == TermKind::NONE) {
+      const uint32_t dim = 0;
+      memcpy(currloc, &dim, u32size);
+      currloc += u32size;
+      continue;
+    }
+    uint32_t bsize = trace->visitTerm(vid, TraceStoreVisitor{currloc, ncycles});
 
     currloc += bsize;
   }
@@ -143,37 +839,5 @@ size_t TraceSerialize::store(uint8_t* dest, PTrace trace) {
 }
 
 void TraceSerialize::stringify(std::ostream& out, PTrace trace) {
-
-  out << "propvars : " << trace->numProps() << "," << std::endl;
-  out << "termvars : " << trace->numVars() << "," << std::endl;
-
-  out << "propvalues : "
-      << "[" << std::endl;
-
-  for (size_t pid = 0; pid < trace->numProps(); ++pid) {
-    uint32_t tvlen = trace->propositions[pid].size();
-    out << "PROP_VAR_" << pid << " : [ ";
-    for (uint32_t tstep = 0; tstep < tvlen; ++tstep) {
-      out << " (" << tstep << " : " << trace->propValueAt(pid, tstep) << ") , ";
-    }
-    out << " ]" << std::endl;
-  }
-
-  out << "]" << std::endl;
-
-  out << "termvalues : "
-      << "[" << std::endl;
-
-  for (size_t vid = 0; vid < trace->numVars(); ++vid) {
-    uint32_t tvlen = std::visit(ElemCountVisitor{}, trace->variables[vid]);
-    out << "TERM_VAR_" << vid << " : [ ";
-    for (uint32_t tstep = 0; tstep < tvlen; ++tstep) {
-      out << " (" << tstep << " : ";
-      std::visit(ValuePrinter{out, tstep}, trace->variables[vid]);
-      out << ") , ";
-    }
-    out << " ]" << std::endl;
-  }
-
-  out << "]" << std::endl;
+  TraceExport::write(out, *trace, TextFormat::CHANGE_LIST);
 }
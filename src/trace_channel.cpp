@@ -0,0 +1,246 @@
+#include "trace_channel.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <numeric>
+
+namespace {
+
+const uint32_t CHANNEL_MAGIC = 0x4354504c;  // "LPTC"
+const uint32_t CHANNEL_VERSION = 2;
+
+/// slot headers and slots start on separate cache lines.
+const size_t LINE = 64;
+
+/// number of processes that may hold views of a slot at once.
+const size_t LEASES = 15;
+
+size_t roundUp(size_t n, size_t unit = LINE) { return (n + unit - 1) / unit * unit; }
+
+/// state of a slot being written; a slot that never held a trace is 0.
+const uint64_t WRITING = 1;
+
+/// state of a slot that holds the trace of sequence number seq.
+uint64_t holding(uint64_t seq) { return (seq + 1) << 1; }
+
+/// Return true if the process pid has not exited, or not been reaped yet.
+bool isAlive(pid_t pid) { return kill(pid, 0) == 0 || errno != ESRCH; }
+
+/**
+ * Add a view held by the process pid to a lease of a slot, and return the
+ * lease, or nullptr if every lease is taken by other processes. A lease is
+ * the pid in its upper half and the number of views in its lower half.
+ */
+std::atomic<uint64_t>* addLease(std::atomic<uint64_t>* leases, uint64_t pid) {
+  for (;;) {
+    std::atomic<uint64_t>* free = nullptr;
+    bool raced = false;
+    for (auto lease = leases; lease != leases + LEASES && !raced; ++lease) {
+      uint64_t value = lease->load();
+      if (value != 0 && value >> 32 == pid) {
+        if (lease->compare_exchange_strong(value, value + 1)) return lease;
+        raced = true;
+      }
+      if (value == 0 && !free) free = lease;
+    }
+    if (raced) continue;
+    if (!free) return nullptr;
+    uint64_t value = 0;
+    if (free->compare_exchange_strong(value, pid << 32 | 1)) return free;
+  }
+}
+
+/// Drop a view from lease, freeing it with the last view.
+void dropLease(std::atomic<uint64_t>* lease) {
+  uint64_t value = lease->load();
+  while (!lease->compare_exchange_weak(value, uint32_t(value) == 1 ? 0 : value - 1)) {
+  }
+}
+
+}  // namespace
+
+struct alignas(LINE) TraceChannel::Header {
+  std::atomic<uint32_t> magic;
+  uint32_t version;
+  uint32_t numSlots;
+  uint64_t slotBytes;
+  std::atomic<uint64_t> published;
+  std::atomic<uint32_t> closed;
+};
+
+struct alignas(LINE) TraceChannel::Slot {
+  std::atomic<uint64_t> state;
+  std::atomic<uint64_t> leases[LEASES];
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free &&
+              std::atomic<uint32_t>::is_always_lock_free);
+
+TraceChannel::TraceChannel(const std::string& name, uint32_t numSlots, size_t slotBytes)
+    : name(name), header(nullptr), slots(nullptr), creator(true) {
+  assert(numSlots > 0);
+  slotBytes = roundUp(slotBytes);
+  const size_t size = slotsOffset(numSlots) + numSlots * slotBytes;
+
+  shm_unlink(name.c_str());
+  int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+  if (fd < 0) return;
+  const bool mapped =
+      ftruncate(fd, size) == 0 && map(fd, size, PROT_READ | PROT_WRITE);
+  ::close(fd);
+  if (!mapped) return;
+
+  // the pages of a new segment are zero, so no slot holds a trace yet.
+  header->version = CHANNEL_VERSION;
+  header->numSlots = numSlots;
+  header->slotBytes = slotBytes;
+  header->magic.store(CHANNEL_MAGIC, std::memory_order_release);
+}
+
+TraceChannel::TraceChannel(const std::string& name)
+    : name(name), header(nullptr), slots(nullptr), creator(false) {
+  int fd = shm_open(name.c_str(), O_RDWR, 0);
+  if (fd < 0) return;
+  struct stat st;
+  const bool mapped = fstat(fd, &st) == 0 && size_t(st.st_size) >= sizeof(Header) &&
+                      map(fd, st.st_size, PROT_READ);
+  ::close(fd);
+  if (!mapped) return;
+
+  // the creator may not have finished setting up the header. Only the
+  // headers, which hold the leases, are writable by readers.
+  const size_t offset = slotsOffset(header->numSlots);
+  if (header->magic.load(std::memory_order_acquire) != CHANNEL_MAGIC ||
+      header->version != CHANNEL_VERSION ||
+      offset + header->numSlots * header->slotBytes != size_t(st.st_size) ||
+      mprotect(segment.get(), offset, PROT_READ | PROT_WRITE) != 0) {
+    header = nullptr;
+    slots = nullptr;
+    segment.reset();
+  }
+}
+
+TraceChannel::~TraceChannel() {
+  if (creator && good()) shm_unlink(name.c_str());
+}
+
+bool TraceChannel::map(int fd, size_t size, int prot) {
+  void* addr = mmap(nullptr, size, prot, MAP_SHARED, fd, 0);
+  if (addr == MAP_FAILED) return false;
+  segment.reset(static_cast<uint8_t*>(addr), [size](uint8_t* p) { munmap(p, size); });
+  header = reinterpret_cast<Header*>(addr);
+  slots = reinterpret_cast<Slot*>(segment.get() + sizeof(Header));
+  return true;
+}
+
+size_t TraceChannel::slotsOffset(uint32_t numSlots) {
+  return roundUp(sizeof(Header) + numSlots * sizeof(Slot), sysconf(_SC_PAGESIZE));
+}
+
+uint8_t* TraceChannel::slotData(uint32_t k) const {
+  return segment.get() + slotsOffset(header->numSlots) +
+         k * header->slotBytes;
+}
+
+uint32_t TraceChannel::numSlots() const { return header->numSlots; }
+
+size_t TraceChannel::slotBytes() const { return header->slotBytes; }
+
+uint64_t TraceChannel::published() const {
+  return header->published.load(std::memory_order_acquire);
+}
+
+uint64_t TraceChannel::oldest() const {
+  // walk back from the last trace published while slots hold every trace.
+  const uint64_t n = published();
+  std::vector<uint64_t> held;
+  for (uint32_t k = 0; k < header->numSlots; ++k) {
+    const uint64_t state = slots[k].state.load();
+    if (state >= holding(0) && (state >> 1) - 1 < n) held.push_back((state >> 1) - 1);
+  }
+  std::sort(held.rbegin(), held.rend());
+  uint64_t seq = n;
+  for (size_t k = 0; k < held.size() && held[k] + 1 == seq; ++k) seq = held[k];
+  return seq;
+}
+
+bool TraceChannel::isLeased(Slot& slot) {
+  bool leased = false;
+  for (auto& lease : slot.leases) {
+    uint64_t value = lease.load();
+    if (value == 0) continue;
+    if (isAlive(pid_t(value >> 32))) {
+      leased = true;
+    } else {
+      // a process that exited can not drop its views.
+      lease.compare_exchange_strong(value, 0);
+    }
+  }
+  return leased;
+}
+
+bool TraceChannel::publish(const Trace& trace) {
+  assert(creator && !isClosed());
+  if (TraceView::getByteSize(trace) > header->slotBytes) return false;
+
+  // try the slots from the one holding the oldest trace; only the writer
+  // changes their states.
+  const uint64_t seq = header->published.load(std::memory_order_relaxed);
+  std::vector<uint32_t> order(header->numSlots);
+  std::iota(order.begin(), order.end(), 0);
+  std::sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b) {
+    return slots[a].state.load() < slots[b].state.load();
+  });
+
+  for (uint32_t k : order) {
+    // a reader leases the slot and then checks its state; the writer marks
+    // the slot and then checks the leases. Whichever comes second sees the
+    // other.
+    Slot& slot = slots[k];
+    const uint64_t previous = slot.state.load();
+    slot.state.store(WRITING);
+    if (isLeased(slot)) {
+      slot.state.store(previous);
+      continue;
+    }
+
+    TraceView::store(slotData(k), trace);
+    slot.state.store(holding(seq), std::memory_order_release);
+    header->published.store(seq + 1, std::memory_order_release);
+    return true;
+  }
+  return false;
+}
+
+PTraceView TraceChannel::acquire(uint64_t seq) const {
+  if (seq >= published()) return nullptr;
+  for (uint32_t k = 0; k < header->numSlots; ++k) {
+    Slot& slot = slots[k];
+    if (slot.state.load() != holding(seq)) continue;
+    std::atomic<uint64_t>* lease = addLease(slot.leases, getpid());
+    if (!lease) return nullptr;
+    if (slot.state.load() != holding(seq)) {
+      dropLease(lease);
+      return nullptr;
+    }
+
+    // the view keeps the segment mapped and the slot leased.
+    std::shared_ptr<uint8_t> mapping = segment;
+    std::shared_ptr<const void> pin(
+        slotData(k), [mapping, lease](const void*) { dropLease(lease); });
+    return std::make_shared<TraceView>(slotData(k), pin);
+  }
+  return nullptr;
+}
+
+void TraceChannel::close() { header->closed.store(1, std::memory_order_release); }
+
+bool TraceChannel::isClosed() const {
+  return header->closed.load(std::memory_order_acquire) != 0;
+}
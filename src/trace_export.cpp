@@ -0,0 +1,270 @@
+#include "trace_export.h"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <functional>
+#include <queue>
+
+#include "formula.h"
+
+TextWriter::TextWriter(int fd, size_t bufferSize)
+    : buffer(bufferSize), used(0), fd(fd), out(nullptr), error(0) {
+  assert(bufferSize > 0);
+}
+
+TextWriter::TextWriter(std::ostream& out, size_t bufferSize)
+    : buffer(bufferSize), used(0), fd(-1), out(&out), error(0) {
+  assert(bufferSize > 0);
+}
+
+void TextWriter::put(const char* s, size_t n) {
+  while (n > 0) {
+    if (used == buffer.size()) flush();
+    const size_t k = std::min(n, buffer.size() - used);
+    memcpy(buffer.data() + used, s, k);
+    used += k;
+    s += k;
+    n -= k;
+  }
+}
+
+void TextWriter::putUint(uint64_t v) {
+  char digits[20];
+  char* end = std::to_chars(digits, digits + sizeof(digits), v).ptr;
+  put(digits, end - digits);
+}
+
+void TextWriter::flush() {
+  if (error != 0) {
+    used = 0;
+    return;
+  }
+  if (out) {
+    if (!out->write(buffer.data(), used)) error = EIO;
+    used = 0;
+    return;
+  }
+  for (size_t done = 0; done < used;) {
+    const ssize_t n = ::write(fd, buffer.data() + done, used - done);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) {
+      error = n < 0 ? errno : EIO;
+      break;
+    }
+    done += n;
+  }
+  used = 0;
+}
+
+/**
+ * Walks the datapoints of the signals of a trace in order of cycles. Every
+ * signal has a current datapoint; a heap holds the cycle of the next one.
+ */
+class TraceExporter {
+  /** A signal written and its datapoint at the current cycle. */
+  struct Column {
+    bool prop;
+    unsigned id;
+    std::string name;
+    /// start of each datapoint of a proposition, whose values alternate
+    /// starting from initial.
+    std::vector<uint32_t> times;
+    bool initial;
+    size_t idx;
+    size_t count;
+  };
+
+  using Next = std::pair<uint32_t, size_t>;
+
+  TextWriter& out;
+  const Trace& trace;
+  TextFormat format;
+  std::vector<Column> columns;
+  std::priority_queue<Next, std::vector<Next>, std::greater<Next>> pending;
+
+  uint32_t changeTime(const Column& c, size_t idx) const {
+    if (c.prop) return c.times[idx];
+    return trace.visitTerm(c.id, [&](const auto& col) { return col.changeTime(idx); });
+  }
+
+  /// Move column k to the datapoint in effect at cycle, and queue the next.
+  void start(size_t k, uint32_t cycle) {
+    Column& c = columns[k];
+    if (c.prop) {
+      auto it = std::upper_bound(c.times.begin(), c.times.end(), cycle);
+      c.idx = it == c.times.begin() ? 0 : it - c.times.begin() - 1;
+    } else {
+      c.idx = trace.visitTerm(c.id, [&](const auto& col) { return col.find(cycle); });
+    }
+    if (c.idx + 1 < c.count) pending.push(Next(changeTime(c, c.idx + 1), k));
+  }
+
+  /// Move the column of the earliest pending change to it, and return it.
+  size_t advance() {
+    const size_t k = pending.top().second;
+    pending.pop();
+    Column& c = columns[k];
+    if (++c.idx + 1 < c.count) pending.push(Next(changeTime(c, c.idx + 1), k));
+    return k;
+  }
+
+  void putValue(const Column& c) {
+    if (c.prop) {
+      const bool v = c.initial ^ (c.idx & 1);
+      if (format == TextFormat::JSONL) {
+        out.put(v ? "true" : "false", v ? 4 : 5);
+      } else {
+        out.put(v ? '1' : '0');
+      }
+      return;
+    }
+    trace.visitTerm(c.id, [&](const auto& col) { putTerm(col.value(c.idx)); });
+  }
+
+  void putTerm(uint32_t value) { out.putUint(value); }
+
+  void putTerm(ArrayView value) {
+    const bool brackets = format != TextFormat::CSV;
+    if (brackets) out.put('[');
+    for (size_t w = 0; w < value.size(); ++w) {
+      if (w > 0) out.put(format == TextFormat::JSONL ? ',' : ' ');
+      out.putUint(value[w]);
+    }
+    if (brackets) out.put(']');
+  }
+
+  void putName(const std::string& name) {
+    if (format == TextFormat::CHANGE_LIST) {
+      out.put(name);
+      return;
+    }
+    // JSON strings and CSV fields with special characters are quoted; CSV
+    // escapes a quote by doubling it.
+    const bool csv = format == TextFormat::CSV;
+    if (csv && name.find_first_of(",\"\n") == std::string::npos) {
+      out.put(name);
+      return;
+    }
+    out.put('"');
+    for (char ch : name) {
+      if (ch == '"') out.put(csv ? '"' : '\\');
+      if (ch == '\\' && !csv) out.put('\\');
+      out.put(ch);
+    }
+    out.put('"');
+  }
+
+  void putRow(uint32_t cycle) {
+    if (format == TextFormat::CSV) {
+      out.putUint(cycle);
+      for (const Column& c : columns) {
+        out.put(',');
+        putValue(c);
+      }
+    } else {
+      out.put("{\"cycle\":", 9);
+      out.putUint(cycle);
+      for (const Column& c : columns) {
+        out.put(',');
+        putName(c.name);
+        out.put(':');
+        putValue(c);
+      }
+      out.put('}');
+    }
+    out.put('\n');
+  }
+
+  void putChange(uint32_t cycle, const Column& c) {
+    out.putUint(cycle);
+    out.put(' ');
+    putName(c.name);
+    out.put(' ');
+    putValue(c);
+    out.put('\n');
+  }
+
+ public:
+  TraceExporter(TextWriter& out, const Trace& trace, TextFormat format,
+                const HyperPLTL::VarMap* varmap)
+      : out(out), trace(trace), format(format) {
+    for (unsigned pid = 0; pid < trace.numProps(); ++pid) {
+      const PropTrace& prop = trace.propositions[pid];
+      Column c{true, pid,
+               varmap ? varmap->getPropName(pid) : "p" + std::to_string(pid)};
+      prop.forEachChange([&](uint32_t time) { c.times.push_back(time); });
+      if (c.times.empty()) continue;
+      c.initial = prop[c.times[0]];
+      c.count = c.times.size();
+      columns.push_back(std::move(c));
+    }
+    for (unsigned vid = 0; vid < trace.numVars(); ++vid) {
+      if (trace.termKind(vid) == TermKind::NONE) continue;
+      const uint32_t count =
+          trace.visitTerm(vid, [](const auto& col) { return col.size(); });
+      if (count == 0) continue;
+      Column c{false, vid,
+               varmap ? varmap->getVarName(vid) : "v" + std::to_string(vid)};
+      c.count = count;
+      columns.push_back(std::move(c));
+    }
+  }
+
+  void run() {
+    const uint32_t first = trace.firstCycle();
+    const uint32_t last = trace.length() - 1;
+    for (size_t k = 0; k < columns.size(); ++k) start(k, first);
+
+    if (format == TextFormat::CHANGE_LIST) {
+      out.put("length ", 7);
+      out.putUint(trace.length());
+      out.put('\n');
+      for (const Column& c : columns) putChange(first, c);
+      while (!pending.empty()) {
+        const uint32_t cycle = pending.top().first;
+        putChange(cycle, columns[advance()]);
+      }
+      return;
+    }
+
+    if (format == TextFormat::CSV) {
+      out.put("cycle", 5);
+      for (const Column& c : columns) {
+        out.put(',');
+        putName(c.name);
+      }
+      out.put('\n');
+    }
+    putRow(first);
+    uint32_t cycle = first;
+    while (!pending.empty()) {
+      cycle = pending.top().first;
+      while (!pending.empty() && pending.top().first == cycle) advance();
+      putRow(cycle);
+    }
+    if (cycle != last) putRow(last);
+  }
+};
+
+bool TraceExport::write(TextWriter& out, const Trace& trace, TextFormat format,
+                        const HyperPLTL::VarMap* varmap) {
+  TraceExporter(out, trace, format, varmap).run();
+  out.flush();
+  return out.good();
+}
+
+bool TraceExport::write(int fd, const Trace& trace, TextFormat format,
+                        const HyperPLTL::VarMap* varmap) {
+  TextWriter out(fd);
+  return write(out, trace, format, varmap);
+}
+
+bool TraceExport::write(std::ostream& out, const Trace& trace, TextFormat format,
+                        const HyperPLTL::VarMap* varmap) {
+  TextWriter writer(out);
+  return write(writer, trace, format, varmap);
+}
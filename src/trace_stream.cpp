@@ -0,0 +1,309 @@
+#include "trace_stream.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+/*
+ * The file header is STREAM_MAGIC, the version, numProps, numVars and the
+ * number of cycles per chunk, padded to HEADER_SIZE bytes. The footer is the
+ * offset of the index, the number of chunks and INDEX_MAGIC.
+ */
+
+const uint32_t STREAM_MAGIC = 0x5354504c;  // "LPTS"
+const uint32_t INDEX_MAGIC = 0x4954504c;   // "LPTI"
+const uint32_t STREAM_VERSION = 1;
+const size_t HEADER_SIZE = 32;
+
+struct Footer {
+  uint64_t index;
+  uint32_t count;
+  uint32_t magic;
+};
+
+static_assert(sizeof(TraceChunk) == 24 && sizeof(Footer) == 16);
+
+template <class T>
+void putRaw(std::ostream& out, const T& v) {
+  out.write(reinterpret_cast<const char*>(&v), sizeof(T));
+}
+
+template <class T>
+bool getRaw(std::istream& in, uint64_t offset, T& v) {
+  in.clear();
+  in.seekg(offset);
+  return bool(in.read(reinterpret_cast<char*>(&v), sizeof(T)));
+}
+
+uint64_t fileSize(std::istream& in) {
+  in.clear();
+  in.seekg(0, std::ios::end);
+  return uint64_t(in.tellg());
+}
+
+/*
+ * Each chunk starts with the header of TraceFormat::CHANGES: the magic, the
+ * format, the size in bytes, the number of cycles, numProps and numVars.
+ */
+typedef uint32_t ChunkHeader[TraceSerialize::HEADER_SIZE / sizeof(uint32_t)];
+
+/// Return the size in bytes of the chunk that starts with header, or 0 if it
+/// is not a trace of at least one cycle over numProps and numVars.
+uint64_t chunkSize(const ChunkHeader& header, unsigned numProps, unsigned numVars) {
+  uint64_t bytes;
+  memcpy(&bytes, &header[2], sizeof(bytes));
+  const uint64_t directory =
+      TraceSerialize::HEADER_SIZE + (uint64_t(numProps) + numVars) * sizeof(uint64_t);
+  if (header[0] != TraceSerialize::MAGIC || header[1] != uint32_t(TraceFormat::CHANGES) ||
+      header[4] == 0 || header[5] != numProps || header[6] != numVars ||
+      bytes < directory) {
+    return 0;
+  }
+  return bytes;
+}
+
+}  // namespace
+
+TraceWriter::TraceWriter(const std::string& path, unsigned numProps, unsigned numVars,
+                         uint32_t chunkCycles)
+    : out(path, std::ios::binary | std::ios::trunc),
+      numProps(numProps),
+      numVars(numVars),
+      chunkCycles(chunkCycles),
+      chunk(new Trace(numProps, numVars)),
+      chunkStart(0),
+      previousLast(0),
+      propStarted(numProps, false),
+      termStarted(numVars, false),
+      schema(numProps, numVars),
+      lastCycle(0),
+      empty(true),
+      closed(false) {
+  assert(chunkCycles > 0);
+  uint32_t header[HEADER_SIZE / sizeof(uint32_t)] = {STREAM_MAGIC, STREAM_VERSION,
+                                                     numProps, numVars, chunkCycles};
+  out.write(reinterpret_cast<const char*>(header), sizeof(header));
+}
+
+TraceWriter::~TraceWriter() {
+  if (!closed && !empty) close(lastCycle);
+}
+
+void TraceWriter::declareIntVar(unsigned i, uint32_t width) {
+  schema.declareIntVar(i, width);
+  chunk->declareIntVar(i, width);
+}
+
+void TraceWriter::declareArrayVar(unsigned i, uint32_t dim, uint32_t width) {
+  schema.declareArrayVar(i, dim, width);
+  chunk->declareArrayVar(i, dim, width);
+}
+
+uint32_t TraceWriter::advance(uint32_t cycle) {
+  assert(!closed && cycle >= chunkStart);
+  while (cycle - chunkStart >= chunkCycles) writeChunk(chunkStart + chunkCycles - 1);
+  if (empty || cycle > lastCycle) lastCycle = cycle;
+  empty = false;
+  return cycle - chunkStart;
+}
+
+void TraceWriter::startProp(unsigned i, bool writesFirst) {
+  if (propStarted[i]) return;
+  propStarted[i] = true;
+  if (previous && !writesFirst) {
+    chunk->updatePropValue(i, 0, previous->propValueAt(i, previousLast));
+  }
+}
+
+void TraceWriter::startTerm(unsigned i, bool writesFirst) {
+  if (termStarted[i]) return;
+  termStarted[i] = true;
+  if (!previous || writesFirst) return;
+  if (previous->termKind(i) == TermKind::INT) {
+    chunk->updateTermValue(i, 0, previous->valueAt(previous->intSignal(i), previousLast));
+  } else if (previous->termKind(i) == TermKind::ARRAY) {
+    chunk->updateArrayValue(i, 0, previous->arrayValueAt(i, previousLast));
+  }
+}
+
+void TraceWriter::updatePropValue(unsigned i, uint32_t cycle, bool value) {
+  const uint32_t local = advance(cycle);
+  startProp(i, local == 0);
+  chunk->updatePropValue(i, local, value);
+}
+
+void TraceWriter::updateTermValue(unsigned i, uint32_t cycle, uint32_t value) {
+  const uint32_t local = advance(cycle);
+  startTerm(i, local == 0);
+  chunk->updateTermValue(i, local, value);
+}
+
+void TraceWriter::updateArrayValue(unsigned i, uint32_t cycle, ArrayView value) {
+  const uint32_t local = advance(cycle);
+  startTerm(i, local == 0);
+  chunk->updateArrayValue(i, local, value);
+}
+
+void TraceWriter::append(const Trace& block) {
+  assert(block.numProps() == numProps && block.numVars() == numVars);
+  const uint32_t last = block.length() - 1;
+  uint32_t at = empty ? 0 : lastCycle + 1;
+
+  // copy the block chunk by chunk.
+  for (uint32_t from = 0;;) {
+    const uint32_t local = advance(at);
+    const uint32_t to =
+        std::min<uint64_t>(last, uint64_t(from) + chunkCycles - local - 1);
+    for (unsigned pid = 0; pid < numProps; ++pid) {
+      startProp(pid, local == 0 && block.propStats(pid).changes != 0);
+    }
+    for (unsigned vid = 0; vid < numVars; ++vid) {
+      startTerm(vid, local == 0 && block.termKind(vid) != TermKind::NONE);
+    }
+    chunk->copyCycles(block, from, to, local);
+    lastCycle = at + (to - from);
+    if (to == last) break;
+    at += to - from + 1;
+    from = to + 1;
+  }
+}
+
+void TraceWriter::writeChunk(uint32_t last) {
+  for (unsigned pid = 0; pid < numProps; ++pid) startProp(pid, false);
+  for (unsigned vid = 0; vid < numVars; ++vid) startTerm(vid, false);
+  chunk->seal(last - chunkStart);
+
+  const size_t size = TraceSerialize::getByteSize(chunk, TraceFormat::CHANGES);
+  std::vector<uint8_t> buffer(size);
+  TraceSerialize::store(buffer.data(), chunk, TraceFormat::CHANGES);
+  const uint64_t offset = uint64_t(out.tellp());
+  out.write(reinterpret_cast<const char*>(buffer.data()), size);
+  // make the chunk visible to readers of the file as soon as it is complete.
+  out.flush();
+  index.push_back(TraceChunk{chunkStart, last, offset, size});
+
+  previous = chunk;
+  previousLast = last - chunkStart;
+  chunk = std::make_shared<Trace>(schema);
+  std::fill(propStarted.begin(), propStarted.end(), false);
+  std::fill(termStarted.begin(), termStarted.end(), false);
+  chunkStart = last + 1;
+}
+
+void TraceWriter::close(uint32_t last) {
+  assert(!closed && last >= lastCycle);
+  advance(last);
+  writeChunk(last);
+
+  const uint64_t offset = uint64_t(out.tellp());
+  out.write(reinterpret_cast<const char*>(index.data()),
+            index.size() * sizeof(TraceChunk));
+  putRaw(out, Footer{offset, uint32_t(index.size()), INDEX_MAGIC});
+  out.flush();
+  closed = true;
+}
+
+TraceReader::TraceReader(const std::string& path)
+    : in(path, std::ios::binary), numProps(0), numVars(0), valid(false), complete(false) {
+  uint32_t header[HEADER_SIZE / sizeof(uint32_t)];
+  if (!getRaw(in, 0, header) || header[0] != STREAM_MAGIC ||
+      header[1] != STREAM_VERSION) {
+    return;
+  }
+  numProps = header[2];
+  numVars = header[3];
+  valid = true;
+  refresh();
+}
+
+void TraceReader::refresh() {
+  if (!valid || complete) return;
+
+  Footer footer;
+  const uint64_t size = fileSize(in);
+  if (size >= HEADER_SIZE + sizeof(Footer) && getRaw(in, size - sizeof(Footer), footer) &&
+      footer.magic == INDEX_MAGIC && footer.index <= size &&
+      footer.index + footer.count * sizeof(TraceChunk) + sizeof(Footer) == size) {
+    chunks.resize(footer.count);
+    in.clear();
+    in.seekg(footer.index);
+    in.read(reinterpret_cast<char*>(chunks.data()), footer.count * sizeof(TraceChunk));
+    complete = bool(in) && indexValid(footer.index);
+    if (complete) return;
+    chunks.clear();
+  }
+  scanChunks();
+}
+
+bool TraceReader::indexValid(uint64_t end) const {
+  uint64_t first = 0;
+  for (const TraceChunk& c : chunks) {
+    if (c.firstCycle != first || c.lastCycle < c.firstCycle ||
+        c.size < TraceSerialize::HEADER_SIZE || c.offset < HEADER_SIZE ||
+        c.offset > end || c.size > end - c.offset) {
+      return false;
+    }
+    first = uint64_t(c.lastCycle) + 1;
+  }
+  return true;
+}
+
+void TraceReader::scanChunks() {
+  const uint64_t size = fileSize(in);
+  uint64_t offset =
+      chunks.empty() ? HEADER_SIZE : chunks.back().offset + chunks.back().size;
+  uint32_t first = chunks.empty() ? 0 : chunks.back().lastCycle + 1;
+
+  // the walk stops at the first chunk that is not completely written, or
+  // whose cycles would run past the last cycle a trace can have.
+  ChunkHeader header;
+  while (offset + sizeof(header) <= size && getRaw(in, offset, header)) {
+    const uint64_t bytes = chunkSize(header, numProps, numVars);
+    if (bytes == 0 || offset + bytes > size || header[4] - 1 > UINT32_MAX - first) {
+      break;
+    }
+    chunks.push_back(TraceChunk{first, first + header[4] - 1, offset, bytes});
+    first += header[4];
+    offset += bytes;
+  }
+}
+
+PTrace TraceReader::readChunk(size_t k) const {
+  const TraceChunk& c = chunks[k];
+  std::vector<uint8_t> buffer(c.size);
+  in.clear();
+  in.seekg(c.offset);
+  in.read(reinterpret_cast<char*>(buffer.data()), buffer.size());
+  if (!in) return nullptr;
+
+  // the chunk must be the one the index or the walk found there.
+  ChunkHeader header;
+  memcpy(header, buffer.data(), sizeof(header));
+  if (chunkSize(header, numProps, numVars) != c.size ||
+      header[4] != c.lastCycle - c.firstCycle + 1) {
+    return nullptr;
+  }
+  return TraceSerialize::load(buffer.data());
+}
+
+PTrace TraceReader::read(uint32_t first, uint32_t last) const {
+  assert(first <= last && last < length());
+  PTrace result(new Trace(numProps, numVars));
+
+  // the first chunk that ends at or after first.
+  size_t k = std::lower_bound(chunks.begin(), chunks.end(), first,
+                              [](const TraceChunk& c, uint32_t cycle) {
+                                return c.lastCycle < cycle;
+                              }) -
+             chunks.begin();
+  for (; k < chunks.size() && chunks[k].firstCycle <= last; ++k) {
+    const TraceChunk& c = chunks[k];
+    PTrace values = readChunk(k);
+    if (!values) return nullptr;
+    const uint32_t from = std::max(first, c.firstCycle) - c.firstCycle;
+    const uint32_t to = std::min(last, c.lastCycle) - c.firstCycle;
+    result->copyCycles(*values, from, to, c.firstCycle + from - first);
+  }
+  return result;
+}
@@ -0,0 +1,312 @@
+#include "trace_view.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+/*
+ * Layout of TraceFormat::MAPPED. The header is the one of TraceFormat::CHANGES
+ * and is followed by a directory with the offset of each proposition, then of
+ * each term variable. Every column starts with a record and its arrays follow
+ * it; records and arrays start at multiples of 8 bytes.
+ */
+
+struct PropRecord {
+  uint32_t count;
+  /// number of words of bits, if dense.
+  uint32_t words;
+  uint8_t initial;
+  uint8_t dense;
+  uint8_t pad[6];
+  // followed by count change times, or words words of bits.
+};
+
+struct TermRecord {
+  uint32_t kind;
+  /// 0 for arrays whose values vary in length.
+  uint32_t dim;
+  uint32_t count;
+  /// declared bit width of the values.
+  uint32_t width;
+  // followed by count change times, then count values (of dim words each).
+  // Values that vary in length are count + 1 64-bit offsets and the words.
+};
+
+static_assert(sizeof(PropRecord) == 16 && sizeof(TermRecord) == 16);
+
+/// Writes to dest, or only counts bytes if dest is null.
+struct Writer {
+  uint8_t* dest;
+  size_t size = 0;
+
+  void putBytes(const void* src, size_t n) {
+    if (dest) memcpy(dest + size, src, n);
+    size += n;
+  }
+
+  template <class T>
+  void put(const T& v) {
+    putBytes(&v, sizeof(T));
+  }
+
+  template <class T>
+  void patch(size_t at, const T& v) {
+    if (dest) memcpy(dest + at, &v, sizeof(T));
+  }
+
+  void align() {
+    static const uint8_t zeros[8] = {};
+    putBytes(zeros, (8 - size % 8) % 8);
+  }
+};
+
+uint32_t headerWord(const uint8_t* source, unsigned k) {
+  uint32_t v;
+  memcpy(&v, source + k * sizeof(uint32_t), sizeof(v));
+  return v;
+}
+
+template <class T>
+const T* at(const uint8_t* source, size_t offset) {
+  return reinterpret_cast<const T*>(source + offset);
+}
+
+/// Return the offset of the first value after count timestamps at offset.
+size_t afterTimes(size_t offset, size_t count) {
+  return (offset + count * sizeof(uint32_t) + 7) & ~size_t(7);
+}
+
+void storeColumn(Writer& out, const VarTrace<uint32_t>& col, uint32_t width) {
+  out.put(TermRecord{uint32_t(TermKind::INT), 1, col.size(), width});
+  for (size_t idx = 0; idx < col.size(); ++idx) out.put(col.changeTime(idx));
+  out.align();
+  for (size_t idx = 0; idx < col.size(); ++idx) out.put(col.value(idx));
+}
+
+void storeColumn(Writer& out, const ArrayTrace& col, uint32_t width) {
+  const uint32_t dim = col.isFixed() ? col.dimension() : 0;
+  out.put(TermRecord{uint32_t(TermKind::ARRAY), dim, col.size(), width});
+  for (size_t idx = 0; idx < col.size(); ++idx) out.put(col.changeTime(idx));
+  out.align();
+  if (dim == 0) {
+    uint64_t offset = 0;
+    out.put(offset);
+    for (size_t idx = 0; idx < col.size(); ++idx) {
+      out.put(offset += col.value(idx).size());
+    }
+  }
+  for (size_t idx = 0; idx < col.size(); ++idx) {
+    ArrayView v = col.value(idx);
+    out.putBytes(v.data, v.size() * sizeof(uint32_t));
+  }
+}
+
+}  // namespace
+
+size_t TraceView::store(uint8_t* dest, const Trace& trace) {
+  // the view always starts at cycle 0.
+  assert(trace.firstCycle() == 0);
+  const uint32_t lastCycle = trace.length() - 1;
+
+  Writer out{dest};
+  out.put(TraceSerialize::MAGIC);
+  out.put(uint32_t(TraceFormat::MAPPED));
+  out.put(uint64_t(0));
+  out.put(uint32_t(trace.length()));
+  out.put(trace.numProps());
+  out.put(trace.numVars());
+  out.put(uint32_t(0));
+
+  size_t directory = out.size;
+  for (size_t k = 0; k < trace.numProps() + trace.numVars(); ++k) out.put(uint64_t(0));
+
+  for (unsigned pid = 0; pid < trace.numProps(); ++pid) {
+    const PropTrace& prop = trace.propositions[pid];
+    out.align();
+    out.patch(directory + pid * sizeof(uint64_t), uint64_t(out.size));
+
+    PropRecord rec = {prop.size(), 0, 0, prop.isDense(), {}};
+    if (prop.size() == 0) {
+      out.put(rec);
+      continue;
+    }
+    rec.initial = prop[0];
+    if (prop.isDense()) rec.words = (lastCycle >> 6) + 1;
+    out.put(rec);
+
+    if (prop.isDense()) {
+      size_t hint = 0;
+      for (uint32_t w = 0; w < rec.words; ++w) out.put(prop.word(w, hint));
+    } else {
+      prop.forEachChange([&](uint32_t time) { out.put(time); });
+    }
+  }
+
+  for (unsigned vid = 0; vid < trace.numVars(); ++vid) {
+    out.align();
+    out.patch(directory + (trace.numProps() + vid) * sizeof(uint64_t),
+              uint64_t(out.size));
+    if (trace.termKind(vid) == TermKind::NONE) {
+      out.put(TermRecord{uint32_t(TermKind::NONE), 0, 0, 0});
+      continue;
+    }
+    const uint32_t width = trace.termWidth(vid);
+    trace.visitTerm(vid, [&](const auto& col) { storeColumn(out, col, width); });
+  }
+
+  out.align();
+  out.patch(2 * sizeof(uint32_t), uint64_t(out.size));
+  return out.size;
+}
+
+size_t TraceView::getByteSize(const Trace& trace) { return store(nullptr, trace); }
+
+bool TraceView::isValid(const uint8_t* source, size_t size) {
+  if (reinterpret_cast<uintptr_t>(source) % 8 != 0) return false;
+  if (size < TraceSerialize::HEADER_SIZE) return false;
+  if (headerWord(source, 0) != TraceSerialize::MAGIC ||
+      headerWord(source, 1) != uint32_t(TraceFormat::MAPPED)) {
+    return false;
+  }
+  uint64_t total;
+  memcpy(&total, source + 2 * sizeof(uint32_t), sizeof(total));
+  const uint32_t ncycles = headerWord(source, 4);
+  const uint64_t numProps = headerWord(source, 5), numVars = headerWord(source, 6);
+  if (total > size || ncycles == 0) return false;
+  size = total;
+
+  // every extent is computed in 64 bits from 32-bit counts, so none wraps.
+  const uint64_t* directory = at<uint64_t>(source, TraceSerialize::HEADER_SIZE);
+  if (TraceSerialize::HEADER_SIZE + (numProps + numVars) * sizeof(uint64_t) > size) {
+    return false;
+  }
+  auto record = [&](uint64_t offset, uint64_t bytes) {
+    return offset % 8 == 0 && offset <= size && bytes <= size - offset;
+  };
+
+  for (uint64_t pid = 0; pid < numProps; ++pid) {
+    const uint64_t offset = directory[pid];
+    if (!record(offset, sizeof(PropRecord))) return false;
+    const PropRecord* rec = at<PropRecord>(source, offset);
+    if (rec->count == 0) continue;
+    const uint64_t data = offset + sizeof(PropRecord);
+    if (rec->dense) {
+      if (rec->words != ((ncycles - 1) >> 6) + 1) return false;
+      if (!record(data, uint64_t(rec->words) * sizeof(uint64_t))) return false;
+    } else {
+      if (!record(data, uint64_t(rec->count) * sizeof(uint32_t))) return false;
+      if (at<uint32_t>(source, data)[0] != 0) return false;
+    }
+  }
+
+  for (uint64_t vid = 0; vid < numVars; ++vid) {
+    const uint64_t offset = directory[numProps + vid];
+    if (!record(offset, sizeof(TermRecord))) return false;
+    const TermRecord* rec = at<TermRecord>(source, offset);
+    if (TermKind(rec->kind) == TermKind::NONE) continue;
+    if (TermKind(rec->kind) != TermKind::INT && TermKind(rec->kind) != TermKind::ARRAY) {
+      return false;
+    }
+    if (rec->count == 0 || rec->width > Trace::MAX_WIDTH) return false;
+    const uint64_t times = offset + sizeof(TermRecord);
+    if (!record(times, uint64_t(rec->count) * sizeof(uint32_t))) return false;
+    const uint64_t values = afterTimes(times, rec->count);
+
+    if (TermKind(rec->kind) == TermKind::INT || rec->dim != 0) {
+      const uint64_t dim = TermKind(rec->kind) == TermKind::INT ? 1 : rec->dim;
+      if (!record(values, rec->count * dim * sizeof(uint32_t))) return false;
+      continue;
+    }
+    // values of varying length: offsets must grow and stay inside the words.
+    const uint64_t words = values + (uint64_t(rec->count) + 1) * sizeof(uint64_t);
+    if (!record(values, words - values)) return false;
+    const uint64_t* offsets = at<uint64_t>(source, values);
+    if (offsets[0] != 0) return false;
+    for (size_t idx = 0; idx < rec->count; ++idx) {
+      if (offsets[idx + 1] < offsets[idx]) return false;
+    }
+    if (offsets[rec->count] > (size - words) / sizeof(uint32_t)) return false;
+  }
+  return true;
+}
+
+TraceView::TraceView(const uint8_t* source, std::shared_ptr<const void> owner)
+    : Trace(headerWord(source, 5), headerWord(source, 6)), owner(std::move(owner)) {
+  assert(TraceSerialize::getFormat(source) == TraceFormat::MAPPED);
+  assert(reinterpret_cast<uintptr_t>(source) % 8 == 0);
+
+  const uint32_t ncycles = headerWord(source, 4);
+  const uint64_t* directory = at<uint64_t>(source, TraceSerialize::HEADER_SIZE);
+  lastCycle = ncycles - 1;
+
+  for (unsigned pid = 0; pid < numProps(); ++pid) {
+    const size_t offset = directory[pid];
+    const PropRecord* rec = at<PropRecord>(source, offset);
+    if (rec->count == 0) continue;
+
+    const size_t data = offset + sizeof(PropRecord);
+    if (rec->dense) {
+      propositions[pid].borrowBits(at<uint64_t>(source, data), rec->words, rec->count,
+                                   lastCycle);
+    } else {
+      propositions[pid].borrowChanges(rec->initial, at<uint32_t>(source, data),
+                                      rec->count, lastCycle);
+    }
+  }
+
+  for (unsigned vid = 0; vid < numVars(); ++vid) {
+    const size_t offset = directory[numProps() + vid];
+    const TermRecord* rec = at<TermRecord>(source, offset);
+    const size_t times = offset + sizeof(TermRecord);
+    const size_t values = afterTimes(times, rec->count);
+
+    if (TermKind(rec->kind) == TermKind::INT) {
+      VarTrace<uint32_t>& col = intVars[declareIntVar(vid, rec->width).column];
+      col.borrow(at<uint32_t>(source, times), at<uint32_t>(source, values), rec->count,
+                 lastCycle);
+    } else if (TermKind(rec->kind) == TermKind::ARRAY && rec->dim != 0) {
+      ArrayTrace& col = arrayVars[declareArrayVar(vid, rec->dim, rec->width).column];
+      col.borrow(at<uint32_t>(source, times), at<uint32_t>(source, values), rec->count,
+                 lastCycle);
+    } else if (TermKind(rec->kind) == TermKind::ARRAY) {
+      // values of varying length are not stored in pages, so they are copied.
+      ArrayTrace& col = arrayVars[declareArrayVar(vid, 0, rec->width).column];
+      const uint64_t* offsets = at<uint64_t>(source, values);
+      const uint32_t* words =
+          at<uint32_t>(source, values + (rec->count + 1) * sizeof(uint64_t));
+      for (size_t idx = 0; idx < rec->count; ++idx) {
+        const size_t len = offsets[idx + 1] - offsets[idx];
+        col.appendChange(at<uint32_t>(source, times)[idx],
+                         ArrayView(words + offsets[idx], len));
+      }
+      col.extendToCycle(lastCycle);
+    }
+  }
+
+  sealed = true;
+}
+
+std::shared_ptr<TraceView> TraceView::open(const std::string& path) {
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) return nullptr;
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size < off_t(TraceSerialize::HEADER_SIZE)) {
+    close(fd);
+    return nullptr;
+  }
+
+  const size_t size = st.st_size;
+  void* addr = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (addr == MAP_FAILED) return nullptr;
+
+  std::shared_ptr<const void> mapping(
+      addr, [size](const void* p) { munmap(const_cast<void*>(p), size); });
+  const uint8_t* source = static_cast<const uint8_t*>(addr);
+  if (!isValid(source, size)) return nullptr;
+  return std::make_shared<TraceView>(source, mapping);
+}
@@ -0,0 +1,356 @@
+#include "vcd_reader.h"
+
+#include <cctype>
+#include <map>
+
+#include "trace_stream.h"
+
+using namespace HyperPLTL;
+
+namespace {
+
+const uint32_t WORD_BITS = 32;
+
+uint32_t wordsFor(uint32_t width) { return (width + WORD_BITS - 1) / WORD_BITS; }
+
+/// Return the bits of a value change: the digits after 'b', or the digit of a
+/// scalar change.
+const char* valueBits(const std::string& value, size_t& len) {
+  if (value[0] == 'b' || value[0] == 'B') {
+    len = value.size() - 1;
+    return value.data() + 1;
+  }
+  len = 1;
+  return value.data();
+}
+
+/// Write the low width bits of a binary value to words, least significant
+/// word first; x and z bits are 0, and missing high bits too.
+void parseBits(const std::string& value, uint32_t width, uint32_t* words) {
+  size_t len;
+  const char* bits = valueBits(value, len);
+  std::fill(words, words + wordsFor(width), 0);
+  for (size_t i = 0; i < len && i < width; ++i) {
+    if (bits[len - 1 - i] == '1') words[i / WORD_BITS] |= uint32_t(1) << (i % WORD_BITS);
+  }
+}
+
+}  // namespace
+
+bool VcdReader::Tokenizer::next(std::string& token) {
+  token.clear();
+  for (;;) {
+    if (pos == len) {
+      in.read(buffer.data(), buffer.size());
+      len = in.gcount();
+      pos = 0;
+      if (len == 0) return !token.empty();
+    }
+    const char c = buffer[pos++];
+    if (!isspace(static_cast<unsigned char>(c))) {
+      token.push_back(c);
+    } else if (!token.empty()) {
+      return true;
+    }
+  }
+}
+
+VcdReader::VcdReader(std::istream& in, PVarMap varmap, const VcdOptions& options)
+    : tokens(in),
+      varmap(varmap),
+      options(options),
+      valid(false),
+      groupSize(0),
+      atTimestamp(false),
+      clockValue('x') {
+  readHeader();
+}
+
+void VcdReader::readHeader() {
+  struct Decl {
+    std::string code;
+    std::string name;
+    uint32_t width;
+    /// index of a memory word, or -1.
+    long index;
+  };
+
+  std::vector<std::string> scopes;
+  std::vector<Decl> decls;
+  std::string tok, type, size, code, ref;
+  auto skipToEnd = [&] {
+    while (tokens.next(tok) && tok != "$end") {
+    }
+  };
+
+  bool complete = false;
+  while (!complete && tokens.next(tok)) {
+    if (tok == "$scope") {
+      tokens.next(type);
+      tokens.next(ref);
+      scopes.push_back(ref);
+      skipToEnd();
+    } else if (tok == "$upscope") {
+      if (!scopes.empty()) scopes.pop_back();
+      skipToEnd();
+    } else if (tok == "$var") {
+      tokens.next(type);
+      tokens.next(size);
+      tokens.next(code);
+      tokens.next(ref);
+      // the reference may be followed by a memory index and a bit range,
+      // as in "mem[3] [7:0]"; only an index names a memory word.
+      while (tokens.next(tok) && tok != "$end") ref += tok;
+      if (type == "real" || type == "realtime") continue;
+
+      long index = -1;
+      const size_t bracket = ref.find('[');
+      if (bracket != std::string::npos) {
+        const size_t close = ref.find(']', bracket);
+        const std::string sub = ref.substr(bracket + 1, close - bracket - 1);
+        if (!sub.empty() && sub.find_first_not_of("0123456789") == std::string::npos) {
+          index = std::stol(sub);
+        }
+        ref.resize(bracket);
+      }
+      std::string name;
+      for (auto& scope : scopes) name += scope + options.separator;
+      decls.push_back(Decl{code, name + ref, uint32_t(std::stoul(size)), index});
+    } else if (tok == "$enddefinitions") {
+      skipToEnd();
+      complete = true;
+    } else if (tok[0] == '$') {
+      skipToEnd();
+    }
+  }
+  if (!complete) return;
+
+  // memory words of the same name form one array of equally sized elements.
+  std::map<std::string, std::pair<long, uint32_t>> memories;
+  for (auto& d : decls) {
+    if (d.index < 0) continue;
+    auto& m = memories[d.name];
+    m.first = std::max(m.first, d.index);
+    m.second = std::max(m.second, d.width);
+  }
+
+  // a name declared with another type, or array dimension, by the dump or
+  // by the VarMap can not be read into it.
+  auto typeOf = [&](const Decl& d) {
+    if (d.index >= 0 || d.width > WORD_BITS) return VarType::ARRAY_VAR;
+    return d.width == 1 ? VarType::PROP_VAR : VarType::INT_VAR;
+  };
+  auto dimOf = [&](const Decl& d) {
+    if (d.index < 0) return wordsFor(d.width);
+    const auto& m = memories[d.name];
+    return uint32_t(m.first + 1) * wordsFor(m.second);
+  };
+  std::map<std::string, const Decl*> first;
+  for (auto& d : decls) {
+    const Decl*& other = first[d.name];
+    if (!other) other = &d;
+    const VarType t = typeOf(d);
+    if (typeOf(*other) != t || (t == VarType::ARRAY_VAR && dimOf(*other) != dimOf(d))) {
+      return;
+    }
+    if (!varmap->hasVar(d.name)) continue;
+    if (varmap->getVarType(d.name) != t) return;
+    if (t == VarType::ARRAY_VAR) {
+      const uint32_t dim = varmap->getArrayDim(varmap->getVarIndex(d.name));
+      if (dim != 0 && dim != dimOf(d)) return;
+    }
+  }
+
+  for (auto& d : decls) {
+    if (d.index >= 0) {
+      const auto& m = memories[d.name];
+      const uint32_t elemWords = wordsFor(m.second);
+      const unsigned var =
+          varmap->addArrayVar(d.name, dimOf(d), std::min(m.second, WORD_BITS));
+      wires[d.code].push_back(
+          Wire{VarType::ARRAY_VAR, var, d.width, uint32_t(d.index) * elemWords});
+    } else if (d.width == 1) {
+      wires[d.code].push_back(Wire{VarType::PROP_VAR, varmap->addPropVar(d.name), 1, 0});
+    } else if (d.width <= WORD_BITS) {
+      const unsigned var = varmap->addIntVar(d.name, d.width);
+      wires[d.code].push_back(Wire{VarType::INT_VAR, var, d.width, 0});
+    } else {
+      const unsigned var = varmap->addArrayVar(d.name, dimOf(d), WORD_BITS);
+      wires[d.code].push_back(Wire{VarType::ARRAY_VAR, var, d.width, 0});
+    }
+    if (d.name == options.clock && d.width == 1) clockCode = d.code;
+  }
+
+  propValues.assign(varmap->numProps(), 0);
+  intValues.assign(varmap->numVars(), 0);
+  arrayValues.assign(varmap->numVars(), {});
+  for (unsigned i = 0; i < varmap->numVars(); ++i) {
+    if (varmap->getVarType(varmap->getVarName(i)) == VarType::ARRAY_VAR) {
+      arrayValues[i].assign(varmap->getArrayDim(i), 0);
+    }
+  }
+  propDirty.assign(varmap->numProps(), false);
+  varDirty.assign(varmap->numVars(), false);
+
+  valid = options.clock.empty() || !clockCode.empty();
+}
+
+bool VcdReader::readGroup() {
+  groupSize = 0;
+  // changes before the first timestamp, such as the initial $dumpvars, are
+  // part of the first group.
+  bool timestamp = atTimestamp;
+  atTimestamp = false;
+
+  std::string tok;
+  while (tokens.next(tok)) {
+    if (tok[0] == '#') {
+      if (timestamp) {
+        atTimestamp = true;
+        return true;
+      }
+      timestamp = true;
+    } else if (tok == "$comment") {
+      while (tokens.next(tok) && tok != "$end") {
+      }
+    } else if (tok[0] == '$') {
+      // $dumpvars, $dumpall, $dumpon, $dumpoff and their $end.
+    } else {
+      if (groupSize == group.size()) group.emplace_back();
+      auto& change = group[groupSize++];
+      const char c = tok[0];
+      if (c == 'b' || c == 'B' || c == 'r' || c == 'R') {
+        change.second.swap(tok);
+        tokens.next(change.first);
+      } else {
+        change.first.assign(tok, 1, std::string::npos);
+        change.second.assign(1, c);
+      }
+    }
+  }
+  return timestamp || groupSize > 0;
+}
+
+bool VcdReader::isEdge(const std::string& value) const {
+  size_t len;
+  const char bit = valueBits(value, len)[len - 1];
+  if (options.negedge) return clockValue == '1' && bit == '0';
+  return clockValue == '0' && bit == '1';
+}
+
+void VcdReader::markProp(unsigned i) {
+  if (propDirty[i]) return;
+  propDirty[i] = true;
+  dirtyProps.push_back(i);
+}
+
+void VcdReader::markVar(unsigned i) {
+  if (varDirty[i]) return;
+  varDirty[i] = true;
+  dirtyVars.push_back(i);
+}
+
+void VcdReader::apply(const std::string& code, const std::string& value) {
+  if (value[0] == 'r' || value[0] == 'R') return;
+  auto it = wires.find(code);
+  if (it == wires.end()) return;
+
+  if (code == clockCode) {
+    size_t len;
+    const char bit = valueBits(value, len)[len - 1];
+    clockValue = bit == '0' || bit == '1' ? bit : 'x';
+  }
+
+  for (const Wire& w : it->second) {
+    if (w.type == VarType::PROP_VAR) {
+      size_t len;
+      propValues[w.var] = valueBits(value, len)[len - 1] == '1';
+      markProp(w.var);
+    } else if (w.type == VarType::INT_VAR) {
+      parseBits(value, w.width, &intValues[w.var]);
+      markVar(w.var);
+    } else {
+      parseBits(value, w.width, arrayValues[w.var].data() + w.offset);
+      markVar(w.var);
+    }
+  }
+}
+
+template <class Sink>
+void VcdReader::writeCycle(Sink& sink, uint32_t cycle) {
+  for (unsigned i : dirtyProps) {
+    sink.updatePropValue(i, cycle, propValues[i]);
+    propDirty[i] = false;
+  }
+  for (unsigned i : dirtyVars) {
+    if (arrayValues[i].empty()) {
+      sink.updateTermValue(i, cycle, intValues[i]);
+    } else {
+      sink.updateArrayValue(i, cycle, arrayValues[i]);
+    }
+    varDirty[i] = false;
+  }
+  dirtyProps.clear();
+  dirtyVars.clear();
+}
+
+template <class Sink>
+uint32_t VcdReader::readInto(Sink& sink) {
+  assert(valid);
+  // every signal of the dump is written in the first cycle.
+  for (auto& entry : wires) {
+    for (const Wire& w : entry.second) {
+      if (w.type == VarType::PROP_VAR) {
+        markProp(w.var);
+      } else {
+        markVar(w.var);
+      }
+    }
+  }
+
+  uint32_t cycles = 0;
+  while (readGroup()) {
+    if (clockCode.empty()) {
+      for (size_t k = 0; k < groupSize; ++k) apply(group[k].first, group[k].second);
+      writeCycle(sink, cycles++);
+      continue;
+    }
+
+    // the values before an edge are sampled, not the ones it causes.
+    for (size_t k = 0; k < groupSize; ++k) {
+      if (group[k].first == clockCode && isEdge(group[k].second)) {
+        writeCycle(sink, cycles++);
+        break;
+      }
+    }
+    for (size_t k = 0; k < groupSize; ++k) apply(group[k].first, group[k].second);
+  }
+  return cycles;
+}
+
+uint32_t VcdReader::read(Trace& trace) {
+  assert(trace.numProps() == varmap->numProps() && trace.numVars() == varmap->numVars());
+  return readInto(trace);
+}
+
+uint32_t VcdReader::read(TraceWriter& writer) {
+  for (auto& entry : wires) {
+    for (const Wire& w : entry.second) {
+      // w.var is a proposition index for PROP_VAR, with no width.
+      if (w.type == VarType::INT_VAR) {
+        writer.declareIntVar(w.var, varmap->getVarWidth(w.var));
+      } else if (w.type == VarType::ARRAY_VAR) {
+        writer.declareArrayVar(w.var, varmap->getArrayDim(w.var),
+                               varmap->getVarWidth(w.var));
+      }
+    }
+  }
+  return readInto(writer);
+}
+
+PTrace VcdReader::read() {
+  PTrace trace = varmap->createTrace();
+  const uint32_t cycles = read(*trace);
+  if (cycles > 0) trace->seal(cycles - 1);
+  return trace;
+}
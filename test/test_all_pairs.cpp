@@ -0,0 +1,111 @@
+#include <gtest/gtest.h>
+
+#include <cstdio>
+
+#include "corpus.h"
+#include "testutils.h"
+#include "thread_pool.h"
+
+using namespace HyperPLTL;
+
+namespace {
+
+/// Return a trace reading input class into x and, for leaky traces, leaking
+/// secret to m.
+PTrace makeTrace(PVarMap varmap, uint32_t input, uint32_t secret, bool leaky) {
+  PTrace trace = varmap->createTrace();
+  for (uint32_t cycle = 0; cycle < 100; ++cycle) {
+    trace->updateTermValue(0, cycle, input);
+    const std::vector<uint32_t> m = {leaky && cycle > 50 ? secret : input, 0};
+    trace->updateArrayValue(1, cycle, m);
+  }
+  trace->seal(99);
+  return trace;
+}
+
+PCorpus makeCorpus(const std::string& name, PVarMap varmap, unsigned n) {
+  TraceList traces;
+  for (unsigned k = 0; k < n; ++k) {
+    traces.push_back(makeTrace(varmap, k % 3, k, k % 5 == 4));
+  }
+  PCorpus corpus = Corpus::create(testing::TempDir() + name, varmap);
+  EXPECT_NE(corpus, nullptr);
+  EXPECT_TRUE(corpus->append(traces));
+  return corpus;
+}
+
+const char* const NONINTERFERENCE = "(IMPLIES (G+ (EQ x)) (G+ (EQ m)))";
+
+}  // namespace
+
+TEST(AllPairsTest, MatchesSerialCheck) {
+  PVarMap varmap = makeRandomVarMap();
+  PCorpus corpus = makeCorpus("libprop_all_pairs.corpus", varmap, 20);
+  PHyperProp formula = parse_formula(NONINTERFERENCE, varmap);
+
+  std::vector<TraceTuple> expected;
+  for (size_t i = 0; i < corpus->size(); ++i) {
+    for (size_t j = 0; j < corpus->size(); ++j) {
+      if (i == j) continue;
+      TraceList pair = {corpus->trace(i), corpus->trace(j)};
+      if (!evaluateTraces(parse_formula(NONINTERFERENCE, varmap), pair)) {
+        expected.push_back({i, j});
+      }
+    }
+  }
+  EXPECT_FALSE(expected.empty());
+  EXPECT_EQ(checkAllPairs(formula, *corpus, 4), expected);
+  EXPECT_EQ(checkAllPairs(formula, *corpus, 1), expected);
+  std::remove((testing::TempDir() + "libprop_all_pairs.corpus").c_str());
+}
+
+TEST(AllPairsTest, Tuples) {
+  PVarMap varmap = makeRandomVarMap();
+  PCorpus corpus = makeCorpus("libprop_all_tuples.corpus", varmap, 7);
+  ThreadPool pool(3);
+
+  // every ordered tuple of distinct traces, in order.
+  std::vector<TraceTuple> all =
+      checkAllTuples(parse_formula("(NOT (EQ x))", varmap), *corpus, 3, pool);
+  std::vector<TraceTuple> expected;
+  for (size_t i = 0; i < 7; ++i) {
+    for (size_t j = 0; j < 7; ++j) {
+      for (size_t k = 0; k < 7; ++k) {
+        if (i % 3 == j % 3 && j % 3 == k % 3 && i != j && j != k && i != k) {
+          expected.push_back({i, j, k});
+        }
+      }
+    }
+  }
+  EXPECT_EQ(all, expected);
+  EXPECT_TRUE(checkAllTuples(parse_formula("(NOT (EQ x))", varmap), *corpus, 8, pool)
+                  .empty());
+  std::remove((testing::TempDir() + "libprop_all_tuples.corpus").c_str());
+}
+
+TEST(AllPairsTest, TooManyTuples) {
+  // 21! tuples of every trace of 21 do not fit in a size_t.
+  PVarMap varmap = makeRandomVarMap();
+  PCorpus corpus = makeCorpus("libprop_all_tuples_overflow.corpus", varmap, 21);
+  ThreadPool pool(1);
+  PHyperProp formula = parse_formula("(NOT (EQ x))", varmap);
+  EXPECT_EQ(checkAllTuples(formula, *corpus, 2, pool).size(), 3u * 7 * 6);
+  EXPECT_EXIT(checkAllTuples(formula, *corpus, 21, pool), ::testing::ExitedWithCode(1),
+              "too many tuples");
+  std::remove((testing::TempDir() + "libprop_all_tuples_overflow.corpus").c_str());
+}
+
+TEST(AllPairsTest, StopAtFirst) {
+  PVarMap varmap = makeRandomVarMap();
+  PCorpus corpus = makeCorpus("libprop_all_pairs_stop.corpus", varmap, 40);
+  PHyperProp formula = parse_formula(NONINTERFERENCE, varmap);
+
+  const std::vector<TraceTuple> all = checkAllPairs(formula, *corpus, 4);
+  const std::vector<TraceTuple> first = checkAllPairs(formula, *corpus, 4, true);
+  ASSERT_FALSE(first.empty());
+  EXPECT_LT(first.size(), all.size());
+  for (auto& tuple : first) {
+    EXPECT_NE(std::find(all.begin(), all.end(), tuple), all.end());
+  }
+  std::remove((testing::TempDir() + "libprop_all_pairs_stop.corpus").c_str());
+}
@@ -0,0 +1,79 @@
+#include <gtest/gtest.h>
+
+#include "testutils.h"
+
+using namespace HyperPLTL;
+
+namespace {
+
+/// odds under which p and q hold for long runs spanning whole words.
+const RandomOdds SPARSE = {40, 50, 2, 8};
+
+/// Return the bit of cycle in values.
+bool bitAt(const std::vector<uint64_t>& values, uint32_t cycle) {
+  return (values[cycle / 64] >> (cycle % 64)) & 1;
+}
+
+}  // namespace
+
+TEST(BlockEvalTest, MatchesFormula) {
+  // lengths on and around word boundaries.
+  const uint32_t lengths[] = {1, 63, 64, 65, 128, 200, 300};
+  PVarMap varmap = makeRandomVarMap();
+  for (unsigned k = 0; k < 300; ++k) {
+    const uint32_t length = lengths[k % 7];
+    const unsigned numTraces = 1 + rand() % 3;
+    TraceList traces;
+    for (unsigned t = 0; t < numTraces; ++t) {
+      traces.push_back(makeRandomTrace(varmap, length, SPARSE));
+    }
+
+    std::string text = randomFormula(1 + rand() % 5, numTraces);
+    if (text[0] != '(' || text[1] == 'E') text = "(NOT " + text + ")";
+    PHyperProp formula = parse_formula(text, varmap);
+    const std::vector<uint64_t> values =
+        BlockEvaluator(traces).evaluate(parse_formula(text, varmap));
+    ASSERT_EQ(values.size(), (length + 63) / 64);
+    for (long cycle = length - 1; cycle >= 0; --cycle) {
+      ASSERT_EQ(bitAt(values, cycle), formula->eval(cycle, traces))
+          << text << " at " << cycle << " of " << length;
+    }
+    EXPECT_EQ(evaluateBlocks(parse_formula(text, varmap), traces),
+              evaluateTraces(parse_formula(text, varmap), traces));
+  }
+}
+
+TEST(BlockEvalTest, SharedNodes) {
+  // a stateful node reached along two paths has a state for each path.
+  PVarMap varmap = makeRandomVarMap();
+  TraceList traces = {makeRandomTrace(varmap, 150, SPARSE),
+                      makeRandomTrace(varmap, 150, SPARSE)};
+  PTraceProp p = std::make_shared<PropVar>(varmap, 0);
+  PHyperProp prev = std::make_shared<NextMinus>(
+      varmap, std::make_shared<TraceSelect>(varmap, 0, p));
+  PHyperProp shared = std::make_shared<And>(varmap, std::vector<PHyperProp>{prev, prev});
+  const std::vector<uint64_t> values = BlockEvaluator(traces).evaluate(shared);
+
+  PHyperProp prev2 = std::make_shared<NextMinus>(
+      varmap, std::make_shared<TraceSelect>(varmap, 0, p));
+  PHyperProp formula =
+      std::make_shared<And>(varmap, std::vector<PHyperProp>{prev2, prev2});
+  for (long cycle = 149; cycle >= 0; --cycle) {
+    ASSERT_EQ(bitAt(values, cycle), formula->eval(cycle, traces)) << cycle;
+  }
+}
+
+TEST(BlockEvalTest, TemporaryTraceList) {
+  // an evaluator built from a temporary list outlives it.
+  PVarMap varmap = makeRandomVarMap();
+  PTrace first = makeRandomTrace(varmap, 100, SPARSE);
+  PTrace second = makeRandomTrace(varmap, 100, SPARSE);
+  BlockEvaluator evaluator(TraceList{first, second});
+  const std::string text = "(G+ (OR (EQ x) p.0))";
+  const std::vector<uint64_t> values = evaluator.evaluate(parse_formula(text, varmap));
+  PHyperProp formula = parse_formula(text, varmap);
+  const TraceList traces = {first, second};
+  for (long cycle = 99; cycle >= 0; --cycle) {
+    ASSERT_EQ(bitAt(values, cycle), formula->eval(cycle, traces)) << cycle;
+  }
+}
@@ -0,0 +1,109 @@
+#include <gtest/gtest.h>
+
+#include <sys/stat.h>
+
+#include <cstdio>
+#include <fstream>
+
+#include "corpus.h"
+#include "testutils.h"
+
+using namespace HyperPLTL;
+
+TEST(CorpusTest, AppendAndReopen) {
+  for (TraceFormat format : {TraceFormat::CHANGES, TraceFormat::MAPPED}) {
+    const std::string path = testing::TempDir() + "libprop_corpus_test.corpus";
+    PVarMap varmap = makeRandomVarMap();
+    TraceList traces;
+    for (unsigned k = 0; k < 30; ++k) {
+      traces.push_back(makeRandomTrace(varmap, 50 + k * 37));
+    }
+
+    PCorpus corpus = Corpus::create(path, varmap, format);
+    ASSERT_NE(corpus, nullptr);
+    EXPECT_EQ(corpus->size(), 0u);
+    ASSERT_TRUE(corpus->append(TraceList(traces.begin(), traces.begin() + 10)));
+    PTrace held = corpus->trace(3);
+    ASSERT_TRUE(corpus->append(TraceList(traces.begin() + 10, traces.end())));
+    EXPECT_TRUE(*held == *traces[3]);
+
+    PCorpus reopened = Corpus::open(path);
+    ASSERT_NE(reopened, nullptr);
+    ASSERT_EQ(reopened->size(), traces.size());
+    PVarMap schema = reopened->getVarMap();
+    EXPECT_EQ(schema->getPropName(0), "p");
+    EXPECT_EQ(schema->getVarWidth(schema->getVarIndex("x")), 8u);
+    EXPECT_EQ(schema->getArrayDim(schema->getVarIndex("m")), 2u);
+
+    size_t k = 0;
+    for (PTrace trace : *reopened) {
+      EXPECT_TRUE(reopened->verify(k));
+      EXPECT_EQ(reopened->entry(k).length, traces[k]->length());
+      EXPECT_TRUE(*trace == *traces[k]) << k;
+      ++k;
+    }
+    EXPECT_EQ(k, traces.size());
+
+    // traces of the corpus are evaluated like any other.
+    PHyperProp property = parse_formula("(G+ (IMPLIES (EQ x) (EQ m)))", schema);
+    TraceList pair = reopened->traces(7, 9);
+    EXPECT_EQ(evaluateTraces(property, pair),
+              evaluateTraces(property, {traces[7], traces[8]}));
+
+    std::remove(path.c_str());
+  }
+
+  EXPECT_EQ(Corpus::open(testing::TempDir() + "libprop_no_such.corpus"), nullptr);
+}
+
+TEST(CorpusTest, InterruptedAppend) {
+  const std::string path = testing::TempDir() + "libprop_corpus_partial.corpus";
+  PVarMap varmap = makeRandomVarMap();
+  PCorpus corpus = Corpus::create(path, varmap);
+  ASSERT_TRUE(
+      corpus->append({makeRandomTrace(varmap, 100), makeRandomTrace(varmap, 200)}));
+
+  // bytes written past the table without the header pointing to them, as
+  // after a crash while adding traces, are ignored.
+  {
+    std::ofstream out(path, std::ios::binary | std::ios::app);
+    out << "partial trace";
+  }
+  PCorpus reopened = Corpus::open(path);
+  ASSERT_NE(reopened, nullptr);
+  EXPECT_EQ(reopened->size(), 2u);
+  EXPECT_TRUE(reopened->verify(1));
+  ASSERT_TRUE(reopened->append({makeRandomTrace(varmap, 300)}));
+  EXPECT_EQ(Corpus::open(path)->size(), 3u);
+  EXPECT_EQ(Corpus::open(path)->trace(2)->length(), 300u);
+  std::remove(path.c_str());
+}
+
+TEST(CorpusTest, AppendOneAtATime) {
+  const std::string path = testing::TempDir() + "libprop_corpus_single.corpus";
+  PVarMap varmap = makeRandomVarMap();
+  PCorpus corpus = Corpus::create(path, varmap);
+  ASSERT_NE(corpus, nullptr);
+  TraceList traces;
+  uint64_t payload = 0;
+  for (unsigned k = 0; k < 200; ++k) {
+    traces.push_back(makeRandomTrace(varmap, 20 + k % 7));
+    ASSERT_TRUE(corpus->append({traces.back()}));
+    payload += corpus->entry(k).size;
+  }
+
+  // every append adds its traces and a table of one entry, not a copy of
+  // all the entries so far.
+  struct stat st;
+  ASSERT_EQ(stat(path.c_str(), &st), 0);
+  EXPECT_LT(uint64_t(st.st_size), 1024 + payload + traces.size() * 64);
+
+  PCorpus reopened = Corpus::open(path);
+  ASSERT_NE(reopened, nullptr);
+  ASSERT_EQ(reopened->size(), traces.size());
+  for (size_t k = 0; k < traces.size(); ++k) {
+    EXPECT_TRUE(reopened->verify(k));
+    EXPECT_TRUE(*reopened->trace(k) == *traces[k]) << k;
+  }
+  std::remove(path.c_str());
+}
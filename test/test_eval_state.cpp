@@ -0,0 +1,103 @@
+#include <gtest/gtest.h>
+
+#include <thread>
+
+#include "monitor.h"
+#include "testutils.h"
+
+using namespace HyperPLTL;
+
+TEST(EvalStateTest, Layout) {
+  PVarMap varmap = makeRandomVarMap();
+  PHyperProp formula =
+      parse_formula("(AND (G+ (EQ x)) (U p.0 (X- q.1)) (IMPLIES p.0 (EQ m)))", varmap);
+  // G+, U and X- keep 1, 2 and 1 bytes; x, p, q, p and m each a row of hints.
+  EXPECT_EQ(formula->getStateSize(), 4u);
+  EXPECT_EQ(formula->getNumLeaves(), 5u);
+  EvalState state(*formula);
+  EXPECT_EQ(state.size(), 4u);
+}
+
+TEST(EvalStateTest, ResetMatchesNewFormula) {
+  PVarMap varmap = makeRandomVarMap();
+  for (unsigned k = 0; k < 100; ++k) {
+    std::string text = randomFormula(1 + rand() % 5, 2);
+    if (text[0] != '(' || text[1] == 'E') text = "(NOT " + text + ")";
+    PHyperProp formula = parse_formula(text, varmap);
+    EvalState state(*formula);
+
+    // the same state is reset and reused for every run.
+    for (unsigned run = 0; run < 3; ++run) {
+      TraceList traces = {makeRandomTrace(varmap, 50), makeRandomTrace(varmap, 50)};
+      ASSERT_EQ(evaluateTraces(formula, traces, state),
+                evaluateTraces(parse_formula(text, varmap), traces))
+          << text;
+    }
+  }
+}
+
+TEST(EvalStateTest, ConcurrentStates) {
+  PVarMap varmap = makeRandomVarMap();
+  const std::string text = "(AND (G+ (IMPLIES p.0 (X+ (EQ x)))) (U (EQ m) q.1))";
+  PHyperProp formula = parse_formula(text, varmap);
+
+  const unsigned numThreads = 4, perThread = 50;
+  std::vector<TraceList> pairs;
+  std::vector<bool> expected;
+  for (unsigned i = 0; i < numThreads * perThread; ++i) {
+    pairs.push_back({makeRandomTrace(varmap, 200), makeRandomTrace(varmap, 200)});
+    expected.push_back(evaluateTraces(parse_formula(text, varmap), pairs.back()));
+  }
+
+  // one formula, evaluated by every thread with a state of its own.
+  std::vector<char> results(pairs.size());
+  std::vector<std::thread> threads;
+  for (unsigned t = 0; t < numThreads; ++t) {
+    threads.emplace_back([&, t] {
+      EvalState state(*formula);
+      for (unsigned i = t * perThread; i < (t + 1) * perThread; ++i) {
+        results[i] = evaluateTraces(formula, pairs[i], state);
+      }
+    });
+  }
+  for (auto& thread : threads) thread.join();
+
+  for (size_t i = 0; i < pairs.size(); ++i) EXPECT_EQ(bool(results[i]), expected[i]) << i;
+}
+
+TEST(EvalStateTest, SharedSubformulas) {
+  // a stateful subformula reached along three paths evaluates as if each
+  // path had a copy of it, with every evaluator.
+  PVarMap varmap = makeRandomVarMap();
+  const std::string sub = "(U p.0 (X- q.1))";
+  const std::string text =
+      "(AND (G+ (IMPLIES p.1 " + sub + ")) (OR " + sub + " (X+ " + sub + ")))";
+  PHyperProp s = parse_formula(sub, varmap);
+  PHyperProp p1 = std::make_shared<TraceSelect>(
+      varmap, 1, std::make_shared<PropVar>(varmap, 0));
+  PHyperProp always =
+      std::make_shared<AlwaysPlus>(varmap, std::make_shared<Implies>(varmap, p1, s));
+  PHyperProp either = std::make_shared<Or>(
+      varmap, std::vector<PHyperProp>{s, std::make_shared<NextPlus>(varmap, s)});
+  PHyperProp shared =
+      std::make_shared<And>(varmap, std::vector<PHyperProp>{always, either});
+  EXPECT_EQ(shared->getStateSize(), parse_formula(text, varmap)->getStateSize());
+
+  for (unsigned k = 0; k < 50; ++k) {
+    TraceList traces = {makeRandomTrace(varmap, 100), makeRandomTrace(varmap, 100)};
+    PHyperProp tree = parse_formula(text, varmap);
+    EvalState state(*shared);
+    Program program(shared);
+    ProgramState programState(program);
+    const std::vector<uint64_t> values = BlockEvaluator(traces).evaluate(shared);
+    for (long cycle = 99; cycle >= 0; --cycle) {
+      const bool expected = tree->eval(cycle, traces);
+      ASSERT_EQ(shared->eval(cycle, traces, state), expected) << cycle;
+      ASSERT_EQ(program.eval(cycle, traces, programState), expected) << cycle;
+      ASSERT_EQ(bool((values[cycle / 64] >> (cycle % 64)) & 1), expected) << cycle;
+    }
+    Monitor monitor(shared, traces);
+    EXPECT_EQ(monitor.finish() == Monitor::Verdict::SATISFIED,
+              evaluateTraces(parse_formula(text, varmap), traces));
+  }
+}
@@ -0,0 +1,140 @@
+#include <gtest/gtest.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+#include "formula.h"
+#include "trace_export.h"
+
+using namespace HyperPLTL;
+
+namespace {
+
+PTrace sample(PVarMap varmap) {
+  varmap->addPropVar("valid");
+  varmap->addIntVar("state", 4);
+  varmap->addArrayVar("mem", 2);
+  varmap->addPropVar("idle");
+  PTrace trace = varmap->createTrace();
+  trace->updatePropValue(0, 0, false);
+  trace->updatePropValue(0, 3, true);
+  trace->updatePropValue(0, 7, false);
+  trace->updateTermValue(0, 0, 5);
+  trace->updateTermValue(0, 3, 6);
+  trace->updateArrayValue(1, 0, std::vector<uint32_t>{0, 0});
+  trace->updateArrayValue(1, 5, std::vector<uint32_t>{1, 2});
+  trace->seal(9);
+  return trace;
+}
+
+std::string exported(const Trace& trace, TextFormat format, const VarMap* varmap) {
+  std::ostringstream out;
+  TraceExport::write(out, trace, format, varmap);
+  return out.str();
+}
+
+}  // namespace
+
+TEST(TraceExportTest, Formats) {
+  PVarMap varmap = std::make_shared<VarMap>();
+  PTrace trace = sample(varmap);
+
+  EXPECT_EQ(exported(*trace, TextFormat::CSV, varmap.get()),
+            "cycle,valid,idle,state,mem\n"
+            "0,0,0,5,0 0\n"
+            "3,1,0,6,0 0\n"
+            "5,1,0,6,1 2\n"
+            "7,0,0,6,1 2\n"
+            "9,0,0,6,1 2\n");
+  EXPECT_EQ(exported(*trace, TextFormat::JSONL, varmap.get()),
+            "{\"cycle\":0,\"valid\":false,\"idle\":false,\"state\":5,\"mem\":[0,0]}\n"
+            "{\"cycle\":3,\"valid\":true,\"idle\":false,\"state\":6,\"mem\":[0,0]}\n"
+            "{\"cycle\":5,\"valid\":true,\"idle\":false,\"state\":6,\"mem\":[1,2]}\n"
+            "{\"cycle\":7,\"valid\":false,\"idle\":false,\"state\":6,\"mem\":[1,2]}\n"
+            "{\"cycle\":9,\"valid\":false,\"idle\":false,\"state\":6,\"mem\":[1,2]}\n");
+  EXPECT_EQ(exported(*trace, TextFormat::CHANGE_LIST, nullptr),
+            "length 10\n"
+            "0 p0 0\n"
+            "0 p1 0\n"
+            "0 v0 5\n"
+            "0 v1 [0 0]\n"
+            "3 p0 1\n"
+            "3 v0 6\n"
+            "5 v1 [1 2]\n"
+            "7 p0 0\n");
+
+  std::ostringstream legacy;
+  TraceSerialize::stringify(legacy, trace);
+  EXPECT_EQ(legacy.str(), exported(*trace, TextFormat::CHANGE_LIST, nullptr));
+}
+
+TEST(TraceExportTest, LongTraceToFile) {
+  // a dense proposition and a counter over many cycles, written through a
+  // small buffer to a file descriptor.
+  const uint32_t cycles = 200000;
+  Trace trace(1, 1);
+  for (uint32_t cycle = 0; cycle < cycles; ++cycle) {
+    trace.updatePropValue(0, cycle, (cycle / 3) % 2);
+    if (cycle % 10 == 0) trace.updateTermValue(0, cycle, cycle / 10);
+  }
+  trace.seal(cycles - 1);
+
+  const std::string path = testing::TempDir() + "libprop_export_test.csv";
+  const int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  ASSERT_GE(fd, 0);
+  {
+    TextWriter out(fd, 100);
+    EXPECT_TRUE(TraceExport::write(out, trace, TextFormat::CSV));
+  }
+  close(fd);
+
+  std::ifstream in(path);
+  std::string line;
+  std::getline(in, line);
+  EXPECT_EQ(line, "cycle,p0,v0");
+  uint32_t rows = 0, cycle = 0;
+  while (std::getline(in, line)) {
+    unsigned c, p, v;
+    ASSERT_EQ(sscanf(line.c_str(), "%u,%u,%u", &c, &p, &v), 3);
+    ASSERT_TRUE(rows == 0 || c > cycle);
+    cycle = c;
+    ASSERT_EQ(p, unsigned(trace.propValueAt(0, c)));
+    ASSERT_EQ(v, trace.valueAt(trace.intSignal(0), c));
+    ++rows;
+  }
+  EXPECT_EQ(cycle, cycles - 1);
+  // the first and last cycle, every toggle and every change of the counter.
+  EXPECT_EQ(rows, 2 + 66666u + 19999u - 6666u);
+  std::remove(path.c_str());
+}
+
+TEST(TraceExportTest, WriteErrors) {
+  PVarMap varmap = std::make_shared<VarMap>();
+  PTrace trace = sample(varmap);
+
+  // a descriptor opened for reading refuses every write; the writer keeps the
+  // error and drops what follows.
+  const std::string path = testing::TempDir() + "libprop_export_error.txt";
+  const int fd = open(path.c_str(), O_RDONLY | O_CREAT | O_TRUNC, 0644);
+  ASSERT_GE(fd, 0);
+  {
+    TextWriter out(fd, 16);
+    EXPECT_FALSE(TraceExport::write(out, *trace, TextFormat::CSV, varmap.get()));
+    EXPECT_FALSE(out.good());
+    EXPECT_EQ(out.lastError(), EBADF);
+    EXPECT_FALSE(TraceExport::write(out, *trace, TextFormat::JSONL, varmap.get()));
+  }
+  close(fd);
+  std::remove(path.c_str());
+
+  EXPECT_FALSE(TraceExport::write(-1, *trace, TextFormat::CHANGE_LIST));
+
+  std::ostringstream failed;
+  failed.setstate(std::ios::badbit);
+  EXPECT_FALSE(TraceExport::write(failed, *trace, TextFormat::CHANGE_LIST));
+}
@@ -0,0 +1,96 @@
+#include <gtest/gtest.h>
+
+#include "testutils.h"
+
+using namespace HyperPLTL;
+
+TEST(HistoryTest, HorizonFromFormula) {
+  PVarMap varmap = std::make_shared<VarMap>();
+  varmap->addIntVar("x");
+  varmap->addIntVar("y");
+
+  EXPECT_EQ(historyHorizon(parse_formula("(G+ (EQ x))", varmap)), 1u);
+  EXPECT_EQ(historyHorizon(parse_formula("(AND (EQ x) (X- (EQ y)))", varmap)), 2u);
+  EXPECT_EQ(historyHorizon(parse_formula("(X- (OR (EQ x) (X+ (X- (EQ y)))))", varmap)),
+            4u);
+}
+
+TEST(HistoryTest, DiscardKeepsColumnsBounded) {
+  PropTrace sparse, dense;
+  VarTrace<uint32_t> ints;
+  const uint32_t window = 2048;
+
+  bool d = false;
+  for (uint32_t cycle = 0; cycle < 100000; ++cycle) {
+    sparse.updateValue(cycle, (cycle / 10) % 2);
+    if (rand() % 2) d = !d;
+    dense.updateValue(cycle, d);
+    ints.updateValue(cycle, cycle / 7);
+
+    if (cycle >= window) {
+      sparse.discardBefore(cycle - window);
+      dense.discardBefore(cycle - window);
+      ints.discardBefore(cycle - window);
+    }
+
+    ASSERT_LE(sparse.size(), 4 * window);
+    ASSERT_LE(ints.size(), 4 * window);
+    ASSERT_LE(dense.size(), 4 * window);
+    ASSERT_EQ(dense[cycle], d);
+  }
+
+  EXPECT_TRUE(dense.isDense());
+  for (uint32_t cycle = 100000 - window; cycle < 100000; ++cycle) {
+    EXPECT_EQ(sparse[cycle], (cycle / 10) % 2 == 1);
+    EXPECT_EQ(ints[cycle], cycle / 7);
+  }
+}
+
+TEST(HistoryTest, BoundedTraceMatchesFull) {
+  PVarMap varmap(new VarMap());
+  unsigned fast = varmap->addPropVar("fast");
+  unsigned slow = varmap->addPropVar("slow");
+  unsigned xid = varmap->addIntVar("x");
+  unsigned mid = varmap->addArrayVar("mem", 2);
+
+  PTrace full = varmap->createTrace();
+  PTrace bounded = varmap->createTrace();
+  const uint32_t limit = 4;
+  bounded->setHistoryLimit(limit);
+
+  bool f = false, s = false;
+  std::vector<uint32_t> mem(2, 0);
+  const uint32_t cycles = 50000;
+
+  for (uint32_t cycle = 0; cycle < cycles; ++cycle) {
+    if (rand() % 2) f = !f;
+    if (rand() % 200 == 0) s = !s;
+    uint32_t x = rand() % 4;
+    if (cycle % 50 == 0) mem[1] = cycle;
+
+    for (auto& tr : {full, bounded}) {
+      tr->updatePropValue(fast, cycle, f);
+      tr->updatePropValue(slow, cycle, s);
+      tr->updateTermValue(xid, cycle, x);
+      tr->updateArrayValue(mid, cycle, mem);
+    }
+
+    uint32_t from = cycle + 1 > limit ? cycle + 1 - limit : 0;
+    ASSERT_LE(bounded->firstCycle(), from);
+    for (uint32_t c = from; c <= cycle; ++c) {
+      ASSERT_EQ(bounded->propValueAt(fast, c), full->propValueAt(fast, c));
+      ASSERT_EQ(bounded->propValueAt(slow, c), full->propValueAt(slow, c));
+      ASSERT_EQ(bounded->termValueAt(xid, c), full->termValueAt(xid, c));
+      ASSERT_EQ(bounded->arrayValueAt(mid, c), full->arrayValueAt(mid, c));
+    }
+  }
+
+  EXPECT_GT(bounded->firstCycle(), 0u);
+  EXPECT_EQ(bounded->length(), full->length());
+
+  // cycles released from the history can no longer be read.
+  const uint32_t gone = bounded->firstCycle() - 1;
+  EXPECT_DEBUG_DEATH(bounded->propValueAt(fast, gone), "firstCycle");
+  EXPECT_DEBUG_DEATH(bounded->termValueAt(xid, gone), "firstCycle");
+  EXPECT_DEBUG_DEATH(bounded->arrayValueAt(mid, gone), "firstCycle");
+}
@@ -0,0 +1,94 @@
+#include <gtest/gtest.h>
+
+#include "testutils.h"
+
+using namespace HyperPLTL;
+
+TEST(ChangeIngestTest, ChangeOnlyMatchesPerCycle) {
+  PVarMap varmap(new VarMap());
+  unsigned pid = varmap->addPropVar("valid");
+  unsigned cid = varmap->addIntVar("config");
+  unsigned did = varmap->addIntVar("data");
+  unsigned mid = varmap->addArrayVar("mem", 2);
+
+  PTrace perCycle = varmap->createTrace();
+  PTrace changeOnly = varmap->createTrace();
+
+  bool valid = false;
+  uint32_t config = 0, data = 0;
+  std::vector<uint32_t> mem(2, 0);
+  const uint32_t lastCycle = 999;
+
+  for (uint32_t cycle = 0; cycle <= lastCycle; ++cycle) {
+    bool validChanged = rand() % 10 == 0;
+    bool configChanged = cycle == 500;
+    bool dataChanged = cycle > 0 && rand() % 3 == 0;
+    bool memChanged = cycle == 20 || cycle == 700;
+
+    if (validChanged) valid = !valid;
+    if (configChanged) config = 7;
+    if (dataChanged) data = rand() % 100;
+    if (memChanged) mem[cycle % 2] += 1;
+
+    perCycle->updatePropValue(pid, cycle, valid);
+    perCycle->updateTermValue(cid, cycle, config);
+    perCycle->updateTermValue(did, cycle, data);
+    perCycle->updateArrayValue(mid, cycle, mem);
+
+    // only report what changed; nothing is reported at cycle 0 for signals
+    // that start out at their default value.
+    if (validChanged) changeOnly->updatePropValue(pid, cycle, valid);
+    if (configChanged) changeOnly->updateTermValue(cid, cycle, config);
+    if (dataChanged) changeOnly->updateTermValue(did, cycle, data);
+    if (memChanged) changeOnly->updateArrayValue(mid, cycle, mem);
+  }
+
+  changeOnly->seal(lastCycle);
+
+  EXPECT_TRUE(changeOnly->isSealed());
+  EXPECT_EQ(perCycle->length(), changeOnly->length());
+  EXPECT_EQ(*perCycle, *changeOnly);
+
+  auto cursor = changeOnly->cursor();
+  for (uint32_t cycle = 0; cycle <= lastCycle; ++cycle) {
+    EXPECT_EQ(perCycle->propValueAt(pid, cycle), cursor.propValueAt(pid, cycle));
+    EXPECT_EQ(perCycle->termValueAt(cid, cycle), cursor.termValueAt(cid, cycle));
+    EXPECT_EQ(perCycle->termValueAt(did, cycle), cursor.termValueAt(did, cycle));
+    EXPECT_EQ(perCycle->termValueAt(mid, cycle), cursor.termValueAt(mid, cycle));
+  }
+}
+
+TEST(ChangeIngestTest, SealFillsSilentSignals) {
+  Trace trace(2, 1);
+  trace.updatePropValue(0, 3, true);
+  trace.seal(10);
+
+  EXPECT_EQ(11u, trace.length());
+  EXPECT_FALSE(trace.propValueAt(0, 2));
+  EXPECT_TRUE(trace.propValueAt(0, 10));
+  EXPECT_FALSE(trace.propValueAt(1, 10));
+}
+
+TEST(ChangeIngestTest, StoreUndeclaredVars) {
+  // variable 1 is never declared nor recorded.
+  PTrace trace(new Trace(1, 3));
+  for (uint32_t cycle = 0; cycle < 10; cycle += 3) {
+    trace->updatePropValue(0, cycle, cycle % 2);
+    trace->updateTermValue(0, cycle, cycle);
+    trace->updateArrayValue(2, cycle, std::vector<uint32_t>{cycle, 1});
+  }
+  trace->seal(10);
+  EXPECT_EQ(trace->termKind(1), TermKind::NONE);
+  EXPECT_EQ(trace->termStats(1).changes, 0u);
+
+  for (TraceFormat format :
+       {TraceFormat::EXPANDED, TraceFormat::CHANGES, TraceFormat::MAPPED}) {
+    std::vector<uint64_t> mem((TraceSerialize::getByteSize(trace, format) + 7) / 8);
+    uint8_t* source = reinterpret_cast<uint8_t*>(mem.data());
+    TraceSerialize::store(source, trace, format);
+    PTrace p = TraceSerialize::load(source);
+    ASSERT_NE(p, nullptr);
+    EXPECT_EQ(p->termKind(1), TermKind::NONE);
+    EXPECT_EQ(*p, *trace);
+  }
+}
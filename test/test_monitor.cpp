@@ -0,0 +1,122 @@
+#include <gtest/gtest.h>
+
+#include "monitor.h"
+#include "testutils.h"
+
+using namespace HyperPLTL;
+
+namespace {
+
+/// odds under which two traces rarely differ, so verdicts come late.
+const RandomOdds RARE = {20, 20, 8, 16};
+
+Monitor::Verdict verdictOf(bool value) {
+  return value ? Monitor::Verdict::SATISFIED : Monitor::Verdict::VIOLATED;
+}
+
+}  // namespace
+
+TEST(MonitorTest, MatchesEvaluateTraces) {
+  PVarMap varmap = makeRandomVarMap();
+  for (unsigned k = 0; k < 300; ++k) {
+    const unsigned numTraces = 1 + rand() % 3;
+    TraceList traces;
+    for (unsigned t = 0; t < numTraces; ++t) traces.push_back(varmap->createTrace());
+
+    std::string text = randomFormula(1 + rand() % 4, numTraces);
+    if (text[0] != '(' || text[1] == 'E') text = "(NOT " + text + ")";
+    Monitor monitor(parse_formula(text, varmap), traces);
+
+    // a verdict reported early is never changed by the cycles that follow.
+    const uint32_t length = 1 + rand() % 100;
+    Monitor::Verdict early = Monitor::Verdict::UNKNOWN;
+    for (uint32_t cycle = 0; cycle < length; ++cycle) {
+      appendRandomCycle(traces, cycle, RARE);
+      const Monitor::Verdict v = monitor.step();
+      if (early == Monitor::Verdict::UNKNOWN) early = v;
+      ASSERT_EQ(v, early) << text;
+    }
+    EXPECT_EQ(monitor.cycles(), length);
+
+    const Monitor::Verdict expected =
+        verdictOf(evaluateTraces(parse_formula(text, varmap), traces));
+    EXPECT_EQ(monitor.finish(), expected) << text;
+    if (early != Monitor::Verdict::UNKNOWN) {
+      EXPECT_EQ(early, expected) << text;
+    }
+  }
+}
+
+TEST(MonitorTest, EarlyVerdicts) {
+  PVarMap varmap = makeRandomVarMap();
+  PTrace trace = varmap->createTrace();
+  TraceList traces = {trace};
+  Monitor always(parse_formula("(G+ (OR p.0 (X+ q.0)))", varmap), traces);
+  Monitor once(parse_formula("(F- (AND q.0 (X- p.0)))", varmap), traces);
+  Monitor both(parse_formula("(IMPLIES (NOT p.0) (G+ p.0))", varmap), traces);
+
+  for (uint32_t cycle = 0; cycle < 10; ++cycle) {
+    trace->updatePropValue(0, cycle, cycle != 5);
+    trace->updatePropValue(1, cycle, cycle == 7);
+    always.step();
+    once.step();
+    both.step();
+    // p fails at 5 and q at 6, which arrives one cycle later.
+    EXPECT_EQ(always.isFinal(), cycle >= 6) << cycle;
+    EXPECT_EQ(once.isFinal(), cycle >= 8) << cycle;
+    EXPECT_TRUE(both.isFinal());
+  }
+  EXPECT_EQ(always.verdict(), Monitor::Verdict::VIOLATED);
+  EXPECT_EQ(once.verdict(), Monitor::Verdict::SATISFIED);
+  EXPECT_EQ(both.verdict(), Monitor::Verdict::SATISFIED);
+}
+
+TEST(MonitorTest, BoundedHistory) {
+  // a formula decided online only reads historyHorizon() cycles back.
+  PVarMap varmap = makeRandomVarMap();
+  const std::string text =
+      "(AND (G+ (IMPLIES q.0 (X+ (X+ (EQ x))))) (F- (NOT (EQ m))))";
+  TraceList full = {varmap->createTrace(), varmap->createTrace()};
+  TraceList bounded = {varmap->createTrace(), varmap->createTrace()};
+  for (auto& trace : bounded) {
+    trace->setHistoryLimit(historyHorizon(parse_formula(text, varmap)));
+  }
+  Monitor monitor(parse_formula(text, varmap), bounded);
+
+  const uint32_t length = 20000;
+  for (uint32_t cycle = 0; cycle < length; ++cycle) {
+    for (size_t t = 0; t < 2; ++t) {
+      for (auto& trace : {full[t], bounded[t]}) {
+        trace->updatePropValue(1, cycle, cycle % 100 == 0);
+        trace->updateTermValue(0, cycle, 0u);
+        const std::vector<uint32_t> m = {cycle, t == 1 && cycle == 15000};
+        trace->updateArrayValue(1, cycle, m);
+      }
+    }
+    ASSERT_EQ(monitor.step(), Monitor::Verdict::UNKNOWN);
+  }
+  EXPECT_GT(bounded[0]->firstCycle(), 0u);
+  EXPECT_EQ(monitor.finish(),
+            verdictOf(evaluateTraces(parse_formula(text, varmap), full)));
+  EXPECT_EQ(monitor.verdict(), Monitor::Verdict::SATISFIED);
+}
+
+TEST(MonitorTest, RejectBoundedHistory) {
+  // U is only evaluated over the whole run, which a bounded trace no longer
+  // holds by then.
+  PVarMap varmap = makeRandomVarMap();
+  const std::string text = "(AND (G+ (EQ x)) (U p.0 q.1))";
+  TraceList traces = {varmap->createTrace(), varmap->createTrace()};
+  for (auto& trace : traces) trace->setHistoryLimit(4);
+  Monitor monitor(parse_formula(text, varmap), traces);
+  for (uint32_t cycle = 0; cycle < 3000; ++cycle) {
+    for (auto& trace : traces) {
+      trace->updatePropValue(0, cycle, true);
+      trace->updatePropValue(1, cycle, false);
+      trace->updateTermValue(0, cycle, 0u);
+    }
+    ASSERT_EQ(monitor.step(), Monitor::Verdict::UNKNOWN);
+  }
+  ASSERT_GT(traces[0]->firstCycle(), 0u);
+  EXPECT_EXIT(monitor.finish(), ::testing::ExitedWithCode(1), "whole run");
+}
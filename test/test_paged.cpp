@@ -0,0 +1,75 @@
+#include <gtest/gtest.h>
+
+#include "trace.h"
+
+TEST(PagedVectorTest, AppendNeverMovesFullPages) {
+  PagedVector<uint32_t, 4> vec;
+  const size_t n = 1000;
+
+  vec.push_back(0);
+  const uint32_t* first = nullptr;
+  for (uint32_t i = 1; i < n; ++i) {
+    vec.push_back(i);
+    if (i == vec.PAGE_SIZE) first = vec.page(0);
+  }
+  EXPECT_EQ(vec.size(), n);
+  EXPECT_EQ(vec.page(0), first);
+  for (uint32_t i = 0; i < n; ++i) ASSERT_EQ(vec[i], i);
+
+  // capacity never runs more than a page ahead of the contents.
+  EXPECT_LT(vec.capacity(), n + vec.PAGE_SIZE);
+
+  PagedVector<uint32_t, 4> copy = vec;
+  EXPECT_EQ(copy, vec);
+
+  vec.dropPages(3);
+  EXPECT_EQ(vec.size(), n - 3 * vec.PAGE_SIZE);
+  EXPECT_EQ(vec[0], 3 * vec.PAGE_SIZE);
+  EXPECT_NE(copy, vec);
+
+  PagedVector<uint32_t, 4> rows;
+  rows.setWidth(3);
+  for (uint32_t i = 0; i < 40; ++i) {
+    uint32_t row[3] = {i, i + 1, i + 2};
+    rows.appendRow(row);
+  }
+  rows.shrink_to_fit();
+  EXPECT_EQ(rows.capacity(), 40u);
+  EXPECT_EQ(rows.row(37)[2], 39u);
+}
+
+TEST(PagedVectorTest, SearchAcrossPages) {
+  PagedVector<uint32_t, 3> times;
+  std::vector<uint32_t> flat;
+  uint32_t t = 0;
+  for (int i = 0; i < 300; ++i) {
+    flat.push_back(t);
+    times.push_back(t);
+    t += 1 + rand() % 5;
+  }
+
+  size_t hint = 0;
+  for (uint32_t key = 0; key < t + 10; ++key) {
+    size_t expected = searchChange(flat.data(), flat.size(), key);
+    ASSERT_EQ(searchChange(times, key), expected);
+    hint = seekChange(times, hint, key);
+    ASSERT_EQ(hint, expected);
+    // hints from anywhere, including past the end, give the same answer.
+    ASSERT_EQ(seekChange(times, rand() % 400, key), expected);
+  }
+}
+
+TEST(PagedVectorTest, LongVarTrace) {
+  VarTrace<uint32_t> vartr;
+  const uint32_t cycles = 20000;
+  for (uint32_t cycle = 0; cycle < cycles; ++cycle) vartr.updateValue(cycle, cycle / 3);
+
+  EXPECT_EQ(vartr.size(), (cycles + 2) / 3);
+  auto cursor = vartr.cursor();
+  for (uint32_t cycle = 0; cycle < cycles; ++cycle) {
+    ASSERT_EQ(cursor[cycle], cycle / 3);
+  }
+  for (uint32_t cycle = cycles; cycle-- > 0;) {
+    ASSERT_EQ(cursor[cycle], cycle / 3);
+  }
+}
@@ -0,0 +1,73 @@
+#include <gtest/gtest.h>
+
+#include "testutils.h"
+#include "thread_pool.h"
+
+using namespace HyperPLTL;
+
+namespace {
+
+PTrace makeTrace(unsigned numProps, unsigned numVars, uint32_t cycles) {
+  PTrace trace(new Trace(numProps, numVars));
+  std::vector<uint32_t> mem(3, 0);
+  for (uint32_t cycle = 0; cycle < cycles; ++cycle) {
+    for (unsigned pid = 0; pid < numProps; ++pid) {
+      if (rand() % 8 == 0) trace->updatePropValue(pid, cycle, rand() % 2);
+    }
+    for (unsigned vid = 0; vid + 1 < numVars; ++vid) {
+      if (rand() % 4 == 0) trace->updateTermValue(vid, cycle, uint32_t(rand() % 100));
+    }
+    if (cycle % 20 == 0) mem[rand() % 3] = rand();
+    trace->updateArrayValue(numVars - 1, cycle, mem);
+  }
+  trace->seal(cycles - 1);
+  return trace;
+}
+
+}  // namespace
+
+TEST(ParallelLoadTest, NestedLoops) {
+  ThreadPool pool(4);
+  std::vector<std::atomic<unsigned>> hits(64 * 100);
+  pool.parallelFor(64, [&](size_t i) {
+    pool.parallelFor(100, [&](size_t j) { ++hits[i * 100 + j]; });
+  });
+  for (auto& h : hits) ASSERT_EQ(h.load(), 1u);
+  pool.parallelFor(0, [](size_t) { FAIL(); });
+}
+
+TEST(ParallelLoadTest, LoadCorpus) {
+  ThreadPool pool(4);
+  TraceList traces;
+  for (int k = 0; k < 12; ++k) traces.push_back(makeTrace(20, 8, 300 + 50 * k));
+
+  for (TraceFormat format :
+       {TraceFormat::EXPANDED, TraceFormat::CHANGES, TraceFormat::MAPPED}) {
+    std::vector<std::vector<uint64_t>> buffers;
+    std::vector<uint8_t*> sources;
+    for (PTrace trace : traces) {
+      buffers.emplace_back((TraceSerialize::getByteSize(trace, format) + 7) / 8);
+      sources.push_back(reinterpret_cast<uint8_t*>(buffers.back().data()));
+      TraceSerialize::store(sources.back(), trace, format);
+    }
+
+    // many traces: one trace per task.
+    TraceList loaded = TraceSerialize::load(sources, pool);
+    ASSERT_EQ(loaded.size(), traces.size());
+    for (size_t k = 0; k < traces.size(); ++k) EXPECT_EQ(*loaded[k], *traces[k]);
+
+    // few traces: the signals of each are decoded in parallel.
+    std::vector<uint8_t*> few(sources.begin(), sources.begin() + 2);
+    loaded = TraceSerialize::load(few, pool);
+    EXPECT_EQ(*loaded[1], *traces[1]);
+    EXPECT_EQ(*TraceSerialize::load(sources[5], pool), *traces[5]);
+
+    TraceProjection projection;
+    projection.addProp(3);
+    projection.addVar(7);
+    loaded = TraceSerialize::load(few, projection, pool);
+    EXPECT_EQ(loaded[0]->termKind(0), TermKind::NONE);
+    EXPECT_EQ(loaded[0]->arrayValueAt(7, 299), traces[0]->arrayValueAt(7, 299));
+    EXPECT_EQ(loaded[1]->propValueAt(3, 123), traces[1]->propValueAt(3, 123));
+  }
+}
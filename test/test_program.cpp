@@ -0,0 +1,110 @@
+#include <gtest/gtest.h>
+
+#include "testutils.h"
+
+using namespace HyperPLTL;
+
+TEST(ProgramTest, MatchesFormula) {
+  PVarMap varmap = makeRandomVarMap();
+  for (unsigned k = 0; k < 300; ++k) {
+    const unsigned numTraces = 1 + rand() % 3;
+    TraceList traces;
+    for (unsigned t = 0; t < numTraces; ++t) {
+      traces.push_back(makeRandomTrace(varmap, 60));
+    }
+
+    // the root must be an operator, as the parser requires.
+    std::string text = randomFormula(1 + rand() % 5, numTraces);
+    if (text[0] != '(' || text[1] == 'E') text = "(NOT " + text + ")";
+    PHyperProp formula = parse_formula(text, varmap);
+    Program program(parse_formula(text, varmap));
+    ProgramState state(program);
+    for (long cycle = 59; cycle >= 0; --cycle) {
+      ASSERT_EQ(program.eval(cycle, traces, state), formula->eval(cycle, traces))
+          << text << " at " << cycle;
+    }
+
+    // the same state, reset, evaluates like a new one.
+    EXPECT_EQ(evaluateTraces(program, traces, state),
+              evaluateTraces(parse_formula(text, varmap), traces))
+        << text;
+    EXPECT_EQ(evaluateTraces(program, traces), evaluateTraces(program, traces, state))
+        << text;
+  }
+}
+
+TEST(ProgramTest, SharedNodes) {
+  // a node reached along two paths is evaluated twice per cycle, with a
+  // state for each path, by both the formula and the program.
+  PVarMap varmap = makeRandomVarMap();
+  TraceList traces = {makeRandomTrace(varmap, 40), makeRandomTrace(varmap, 40)};
+  PTraceProp p = std::make_shared<PropVar>(varmap, 0);
+  PHyperProp prev = std::make_shared<NextMinus>(
+      varmap, std::make_shared<TraceSelect>(varmap, 0, p));
+  PHyperProp shared = std::make_shared<And>(varmap, std::vector<PHyperProp>{prev, prev});
+  Program program(shared);
+  EXPECT_EQ(program.instructions().size(), 5u);
+  ProgramState state(program);
+  for (long cycle = 39; cycle >= 0; --cycle) {
+    ASSERT_EQ(program.eval(cycle, traces, state), shared->eval(cycle, traces)) << cycle;
+  }
+}
+
+TEST(ProgramTest, EvalAt) {
+  // a formula without G+, F- or U evaluates at any cycle by reading ahead.
+  PVarMap varmap = makeRandomVarMap();
+  const std::string text = "(AND (OR p.0 (X+ (EQ x))) (IMPLIES (X- (X+ q.1)) (EQ m)))";
+  TraceList traces = {makeRandomTrace(varmap, 50), makeRandomTrace(varmap, 50)};
+  Program program(parse_formula(text, varmap));
+  EXPECT_TRUE(program.isLocal());
+  EXPECT_EQ(program.lookahead(), 2u);
+  EXPECT_FALSE(Program(parse_formula("(G+ (X+ p.0))", varmap)).isLocal());
+
+  PHyperProp formula = parse_formula(text, varmap);
+  std::vector<bool> expected(50);
+  for (long cycle = 49; cycle >= 0; --cycle) {
+    expected[cycle] = formula->eval(cycle, traces);
+  }
+  ProgramState state(program);
+  for (uint32_t cycle = 0; cycle < 50; ++cycle) {
+    ASSERT_EQ(program.evalAt(cycle, 49, traces, state), expected[cycle]) << cycle;
+  }
+  // while the run goes on, the cycles read ahead decide.
+  for (uint32_t cycle = 0; cycle + 2 <= 49; ++cycle) {
+    ASSERT_EQ(program.evalAt(cycle, UINT32_MAX, traces, state), expected[cycle])
+        << cycle;
+  }
+}
+
+TEST(ProgramTest, UndeclaredColumnKinds) {
+  // traces built without the VarMap store x as arrays and m as integers;
+  // EQ then compares their values, like the formula, in every evaluator.
+  PVarMap varmap = makeRandomVarMap();
+  TraceList traces;
+  for (unsigned t = 0; t < 2; ++t) {
+    PTrace trace(new Trace(2, 2));
+    for (uint32_t cycle = 0; cycle < 100; ++cycle) {
+      trace->updateTermValue(0, cycle, ValueType(std::vector<uint32_t>{cycle / 10, 1}));
+      trace->updateTermValue(1, cycle, uint32_t(t == 1 && cycle < 30 ? 1 : 0));
+    }
+    trace->seal(99);
+    traces.push_back(trace);
+  }
+  const std::string text = "(AND (G+ (EQ x)) (G+ (EQ m)))";
+  PHyperProp formula = parse_formula(text, varmap);
+  Program program(parse_formula(text, varmap));
+  ProgramState state(program);
+  const std::vector<uint64_t> values =
+      BlockEvaluator(traces).evaluate(parse_formula(text, varmap));
+  for (long cycle = 99; cycle >= 0; --cycle) {
+    const bool expected = cycle >= 30;
+    ASSERT_EQ(formula->eval(cycle, traces), expected) << cycle;
+    ASSERT_EQ(program.eval(cycle, traces, state), expected) << cycle;
+    ASSERT_EQ(bool((values[cycle / 64] >> (cycle % 64)) & 1), expected) << cycle;
+  }
+  EXPECT_TRUE(evaluateTraces(parse_formula("(G+ (EQ x))", varmap), traces));
+  EXPECT_FALSE(evaluateTraces(parse_formula("(G+ (EQ m))", varmap), traces));
+  EXPECT_TRUE(evaluateBlocks(parse_formula("(G+ (EQ x))", varmap), traces));
+  EXPECT_TRUE(evaluateTraces(Program(parse_formula("(G+ (EQ x))", varmap)), traces));
+  EXPECT_FALSE(evaluateTraces(Program(parse_formula("(G+ (EQ m))", varmap)), traces));
+}
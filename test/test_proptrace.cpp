@@ -0,0 +1,109 @@
+#include <gtest/gtest.h>
+
+#include "testutils.h"
+
+using namespace HyperPLTL;
+
+static uint64_t expectedWord(const std::vector<bool>& values, uint32_t w) {
+  uint64_t word = 0;
+  for (uint32_t b = 0; b < 64; ++b) {
+    uint32_t cycle = std::min<uint32_t>(w * 64 + b, values.size() - 1);
+    if (values[cycle]) word |= uint64_t(1) << b;
+  }
+  return word;
+}
+
+TEST(PropTraceTest, SparseAndDenseForms) {
+  PropTrace sparse, dense;
+  std::vector<bool> sparseValues, denseValues;
+
+  for (uint32_t cycle = 0; cycle < 5000; ++cycle) {
+    bool sv = (cycle / 700) % 2;
+    bool dv = rand() % 2;
+    sparse.updateValue(cycle, sv);
+    dense.updateValue(cycle, dv);
+    sparseValues.push_back(sv);
+    denseValues.push_back(dv);
+  }
+
+  EXPECT_FALSE(sparse.isDense());
+  EXPECT_TRUE(dense.isDense());
+
+  auto sc = sparse.cursor();
+  auto dc = dense.cursor();
+  for (uint32_t cycle = 0; cycle < 5000; ++cycle) {
+    EXPECT_EQ(sparseValues[cycle], sc[cycle]);
+    EXPECT_EQ(denseValues[cycle], dc[cycle]);
+  }
+
+  size_t shint = 0, dhint = 0;
+  for (uint32_t w = 0; w < 5000 / 64 + 2; ++w) {
+    EXPECT_EQ(expectedWord(sparseValues, w), sparse.word(w, shint));
+    EXPECT_EQ(expectedWord(denseValues, w), dense.word(w, dhint));
+  }
+}
+
+TEST(PropTraceTest, CompactKeepsValues) {
+  PropTrace prop, copy;
+
+  // toggles every cycle first, then stays constant for a long time.
+  for (uint32_t cycle = 0; cycle < 2000; ++cycle) prop.updateValue(cycle, cycle % 2);
+  EXPECT_TRUE(prop.isDense());
+  for (uint32_t cycle = 2000; cycle < 200000; ++cycle) prop.updateValue(cycle, true);
+
+  copy = prop;
+  prop.compact();
+  EXPECT_FALSE(prop.isDense());
+  EXPECT_TRUE(copy.isDense());
+  EXPECT_EQ(prop, copy);
+  EXPECT_EQ(2000u, prop.size());
+
+  for (uint32_t cycle = 0; cycle < 200000; cycle += 97) {
+    EXPECT_EQ(copy[cycle], prop[cycle]);
+  }
+}
+
+TEST(PropTraceTest, ChangesInRange) {
+  PropTrace sparse, dense;
+  for (uint32_t cycle = 0; cycle < 5000; ++cycle) {
+    sparse.updateValue(cycle, (cycle / 300) % 2);
+    dense.updateValue(cycle, rand() % 2);
+  }
+  ASSERT_TRUE(dense.isDense());
+
+  // the toggles in a range are those of the whole trace that fall in it.
+  const uint32_t ranges[][2] = {{0, 4999}, {0, 0}, {63, 64}, {299, 900}, {1000, 1127}};
+  for (const PropTrace* prop : {&sparse, &dense}) {
+    for (auto& range : ranges) {
+      std::vector<uint32_t> all, some;
+      prop->forEachChange([&](uint32_t t) {
+        if (t > range[0] && t <= range[1]) all.push_back(t);
+      });
+      prop->forEachChange(range[0], range[1], [&](uint32_t t) { some.push_back(t); });
+      EXPECT_EQ(all, some) << range[0] << " to " << range[1];
+    }
+  }
+}
+
+TEST(PropTraceTest, TraceSelectWord) {
+  PVarMap varmap = std::make_shared<VarMap>();
+  unsigned xid = varmap->addPropVar("x");
+  PTraceProp x(new PropVar(varmap, xid));
+  auto select = std::make_shared<TraceSelect>(varmap, 1, x);
+
+  PTrace trace1(new Trace(1, 0));
+  PTrace trace2(new Trace(1, 0));
+  TraceList tracelist({trace1, trace2});
+
+  std::vector<bool> values;
+  for (uint32_t cycle = 0; cycle < 300; ++cycle) {
+    bool v = rand() % 3 == 0;
+    trace1->updatePropValue(0, cycle, !v);
+    trace2->updatePropValue(0, cycle, v);
+    values.push_back(v);
+  }
+
+  for (uint32_t w = 0; w < 5; ++w) {
+    EXPECT_EQ(expectedWord(values, w), select->evalWord(w, tracelist));
+  }
+}
@@ -3,6 +3,8 @@
 
 #include "testutils.h"
 
+using namespace HyperPLTL;
+
 TEST(TraceSerializeTest, StoreTraceObject) {
 
   PTrace trace(new Trace(0, 2));
@@ -54,3 +56,206 @@ TEST(TraceSerializeTest, StoreTraceWithArrayVar) {
   EXPECT_EQ(bstorage, memsize);
   EXPECT_EQ(*p, *trace);
 }
+
+TEST(TraceSerializeTest, StoreChangePoints) {
+  PTrace trace(new Trace(3, 5));
+  const uint32_t cycles = 5000;
+
+  std::vector<uint32_t> arr(4, 0);
+  std::vector<uint32_t> ragged(2, 7);
+  bool busy = false;
+  for (uint32_t cycle = 0; cycle < cycles; ++cycle) {
+    if (rand() % 2) busy = !busy;
+    if (cycle % 64 == 0) randomizeVecData(arr);
+    if (cycle == 300) ragged.push_back(1);
+
+    trace->updatePropValue(0, cycle, busy);
+    trace->updatePropValue(1, cycle, cycle % 1000 == 0);
+    trace->updateTermValue(0, cycle, uint32_t(cycle / 10));
+    trace->updateTermValue(1, cycle, uint32_t(rand() % 3 ? 5 : 4000000000u));
+    trace->updateTermValue(2, cycle, arr);
+    trace->updateTermValue(3, cycle, ragged);
+  }
+  // proposition 2 and term variable 4 are never recorded.
+
+  size_t memsize = TraceSerialize::getByteSize(trace, TraceFormat::CHANGES);
+  std::vector<uint8_t> mem(memsize);
+  EXPECT_EQ(TraceSerialize::store(mem.data(), trace, TraceFormat::CHANGES), memsize);
+  EXPECT_EQ(TraceSerialize::getFormat(mem.data()), TraceFormat::CHANGES);
+  // expanded to a value per cycle, the recorded signals take over 180KB.
+  EXPECT_LT(memsize, 30000u);
+
+  PTrace p = TraceSerialize::load(mem.data());
+  EXPECT_EQ(p->length(), trace->length());
+  EXPECT_EQ(*p, *trace);
+  EXPECT_EQ(p->termKind(4), TermKind::NONE);
+  EXPECT_EQ(p->arrayValueAt(3, 299).size(), 2u);
+  EXPECT_EQ(p->arrayValueAt(3, 300).size(), 3u);
+
+  // the expanded format is still recognised.
+  PTrace q(new Trace(0, 1));
+  for (uint32_t cycle = 0; cycle < 10; ++cycle) q->updateTermValue(0, cycle, cycle);
+  std::vector<uint8_t> expanded(TraceSerialize::getByteSize(q));
+  TraceSerialize::store(expanded.data(), q);
+  EXPECT_EQ(TraceSerialize::getFormat(expanded.data()), TraceFormat::EXPANDED);
+  EXPECT_EQ(*TraceSerialize::load(expanded.data()), *q);
+}
+
+TEST(TraceSerializeTest, LoadProjection) {
+  PVarMap varmap(new VarMap());
+  for (int k = 0; k < 30; ++k) varmap->addPropVar("p" + std::to_string(k));
+  for (int k = 0; k < 10; ++k) varmap->addIntVar("x" + std::to_string(k));
+  varmap->addArrayVar("mem", 2);
+  const std::string formula = "(G+ (IMPLIES (AND p3.0 p3.1) (AND (EQ x7) (EQ mem))))";
+  PHyperProp property = parse_formula(formula, varmap);
+
+  TraceProjection projection = traceProjection(property);
+  EXPECT_EQ(projection.props, std::vector<unsigned>(1, varmap->getPropIndex("p3")));
+  EXPECT_EQ(projection.vars.size(), 2u);
+  EXPECT_TRUE(projection.hasVar(varmap->getVarIndex("x7")));
+  EXPECT_TRUE(projection.hasVar(varmap->getVarIndex("mem")));
+
+  TraceList traces;
+  for (int t = 0; t < 2; ++t) {
+    PTrace trace = varmap->createTrace();
+    std::vector<uint32_t> mem(2, 0);
+    for (uint32_t cycle = 0; cycle < 500; ++cycle) {
+      for (unsigned pid = 0; pid < trace->numProps(); ++pid) {
+        trace->updatePropValue(pid, cycle, rand() % 4 == 0);
+      }
+      for (int k = 0; k < 10; ++k) {
+        trace->updateTermValue(varmap->getVarIndex("x" + std::to_string(k)), cycle,
+                               uint32_t(rand() % 2));
+      }
+      if (cycle % 50 == 0) mem[rand() % 2] = rand() % 3;
+      trace->updateArrayValue(varmap->getVarIndex("mem"), cycle, mem);
+    }
+    trace->seal(499);
+    traces.push_back(trace);
+  }
+  const bool expected = evaluateTraces(property, traces);
+
+  for (TraceFormat format :
+       {TraceFormat::EXPANDED, TraceFormat::CHANGES, TraceFormat::MAPPED}) {
+    TraceList loaded;
+    for (PTrace trace : traces) {
+      std::vector<uint64_t> mem((TraceSerialize::getByteSize(trace, format) + 7) / 8);
+      uint8_t* source = reinterpret_cast<uint8_t*>(mem.data());
+      TraceSerialize::store(source, trace, format);
+      loaded.push_back(TraceSerialize::load(source, projection));
+    }
+
+    PTrace p = loaded[0];
+    EXPECT_EQ(p->length(), 500u);
+    EXPECT_EQ(p->propStats(0).changes, 0u);
+    EXPECT_EQ(p->termKind(varmap->getVarIndex("x0")), TermKind::NONE);
+    const unsigned x7 = varmap->getVarIndex("x7");
+    const unsigned p3 = varmap->getPropIndex("p3");
+    for (uint32_t cycle = 0; cycle < 500; ++cycle) {
+      ASSERT_EQ(p->propValueAt(p3, cycle), traces[0]->propValueAt(p3, cycle));
+      ASSERT_EQ(p->termValueAt(x7, cycle), traces[0]->termValueAt(x7, cycle));
+    }
+    EXPECT_EQ(evaluateTraces(parse_formula(formula, varmap), loaded), expected);
+  }
+}
+
+TEST(TraceSerializeTest, PackDeclaredWidths) {
+  PVarMap varmap(new VarMap());
+  varmap->addIntVar("state", 4);
+  varmap->addArrayVar("regs", 16, 8);
+  varmap->addIntVar("addr");
+  EXPECT_EQ(varmap->getVarWidth(varmap->getVarIndex("state")), 4u);
+  EXPECT_EQ(varmap->getVarWidth(varmap->getVarIndex("addr")), Trace::MAX_WIDTH);
+
+  PTrace trace = varmap->createTrace();
+  const uint32_t cycles = 8000;
+  std::vector<uint32_t> regs(16, 0);
+  for (uint32_t cycle = 0; cycle < cycles; ++cycle) {
+    regs[rand() % 16] = rand() % 256;
+    trace->updateTermValue(0, cycle, uint32_t(rand() % 16));
+    trace->updateArrayValue(1, cycle, regs);
+    trace->updateTermValue(2, cycle, uint32_t(0xfffffff0u + cycle % 32));
+  }
+  trace->seal(cycles - 1);
+
+  // a 4-bit state and 8-bit registers, one of which changes every cycle, take
+  // less than 6 bytes per cycle; stored as 32-bit words they take 72.
+  size_t memsize = TraceSerialize::getByteSize(trace, TraceFormat::CHANGES);
+  std::vector<uint8_t> mem(memsize);
+  TraceSerialize::store(mem.data(), trace, TraceFormat::CHANGES);
+  EXPECT_LT(memsize, 6 * cycles);
+
+  PTrace p = TraceSerialize::load(mem.data());
+  EXPECT_EQ(*p, *trace);
+  EXPECT_EQ(p->termWidth(0), 4u);
+  EXPECT_EQ(p->termWidth(1), 8u);
+  EXPECT_EQ(p->termWidth(2), Trace::MAX_WIDTH);
+
+  const size_t mappedSize = TraceSerialize::getByteSize(trace, TraceFormat::MAPPED);
+  std::vector<uint64_t> mapped((mappedSize + 7) / 8);
+  uint8_t* source = reinterpret_cast<uint8_t*>(mapped.data());
+  TraceSerialize::store(source, trace, TraceFormat::MAPPED);
+  EXPECT_EQ(TraceSerialize::load(source)->termWidth(0), 4u);
+}
+
+TEST(TraceSerializeTest, ValuesAtWidthBoundary) {
+  PVarMap varmap(new VarMap());
+  varmap->addIntVar("state", 8);
+  varmap->addArrayVar("regs", 2, 12);
+  PTrace trace = varmap->createTrace();
+
+  // values wider than declared keep their low bits, in memory and on disk.
+  const uint32_t ints[] = {255, 256, 0x1ff, 0, 0xffffffffu};
+  const std::vector<uint32_t> regs[] = {
+      {0xfff, 0}, {0x1000, 0xfff}, {0x1fff, 0x1001}, {0, 0}, {0xffffffffu, 1}};
+  for (uint32_t cycle = 0; cycle < 5; ++cycle) {
+    trace->updateTermValue(0, cycle, ints[cycle]);
+    trace->updateArrayValue(1, cycle, regs[cycle]);
+  }
+  trace->seal(4);
+  for (uint32_t cycle = 0; cycle < 5; ++cycle) {
+    EXPECT_EQ(trace->termValueAt(0, cycle), ValueType(ints[cycle] & 0xff));
+    EXPECT_EQ(trace->arrayValueAt(1, cycle).toVector(),
+              (std::vector<uint32_t>{regs[cycle][0] & 0xfff, regs[cycle][1] & 0xfff}));
+  }
+
+  std::vector<uint8_t> mem(TraceSerialize::getByteSize(trace, TraceFormat::CHANGES));
+  TraceSerialize::store(mem.data(), trace, TraceFormat::CHANGES);
+  EXPECT_EQ(*TraceSerialize::load(mem.data()), *trace);
+}
+
+TEST(TraceSerializeTest, RejectUnknownFormats) {
+  PTrace trace(new Trace(1, 2));
+  for (uint32_t cycle = 0; cycle < 20; ++cycle) {
+    trace->updatePropValue(0, cycle, cycle % 3 == 0);
+    trace->updateTermValue(0, cycle, cycle / 4);
+    trace->updateArrayValue(1, cycle, std::vector<uint32_t>{cycle, 1});
+  }
+  trace->seal(19);
+
+  for (TraceFormat format : {TraceFormat::EXPANDED, TraceFormat::CHANGES}) {
+    std::vector<uint8_t> mem(TraceSerialize::getByteSize(trace, format));
+    TraceSerialize::store(mem.data(), trace, format);
+    EXPECT_EQ(TraceSerialize::getFormat(mem.data()), format);
+    ASSERT_NE(TraceSerialize::load(mem.data()), nullptr);
+
+    // a tagged buffer of a later version.
+    if (format == TraceFormat::CHANGES) {
+      std::vector<uint8_t> later = mem;
+      const uint32_t version = 9;
+      memcpy(later.data() + sizeof(uint32_t), &version, sizeof(version));
+      EXPECT_EQ(TraceSerialize::getFormat(later.data()), TraceFormat::UNKNOWN);
+      EXPECT_EQ(TraceSerialize::load(later.data()), nullptr);
+    }
+
+    // a header whose sizes do not add up.
+    std::vector<uint8_t> corrupt = mem;
+    corrupt[0] = 0xab;
+    corrupt[1] = 0xcd;
+    EXPECT_EQ(TraceSerialize::getFormat(corrupt.data()), TraceFormat::UNKNOWN);
+    EXPECT_EQ(TraceSerialize::load(corrupt.data()), nullptr);
+  }
+
+  std::vector<uint8_t> garbage(64, 0x5a);
+  EXPECT_EQ(TraceSerialize::load(garbage.data()), nullptr);
+}
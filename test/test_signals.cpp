@@ -0,0 +1,97 @@
+#include <gtest/gtest.h>
+
+#include "testutils.h"
+
+using namespace HyperPLTL;
+
+TEST(SignalHandleTest, TypedReadWrite) {
+  PVarMap varmap(new VarMap());
+  unsigned xid = varmap->addIntVar("x");
+  unsigned bid = varmap->addArrayVar("bytes", 3);
+
+  PTrace trace = varmap->createTrace();
+  EXPECT_EQ(TermKind::INT, trace->termKind(xid));
+  EXPECT_EQ(TermKind::ARRAY, trace->termKind(bid));
+
+  IntSignal x = trace->intSignal(xid);
+  ArraySignal bytes = trace->arraySignal(bid);
+
+  std::vector<uint32_t> arrval(3);
+  for (uint32_t cycle = 0; cycle < 40; ++cycle) {
+    arrval[cycle % 3] = cycle / 4;
+    trace->updateValue(x, cycle, cycle / 5);
+    trace->updateValue(bytes, cycle, arrval);
+  }
+
+  size_t xhint = 0, bhint = 0;
+  for (uint32_t cycle = 0; cycle < 40; ++cycle) {
+    EXPECT_EQ(cycle / 5, trace->valueAt(x, cycle));
+    EXPECT_EQ(cycle / 5, trace->valueAt(x, cycle, xhint));
+    EXPECT_EQ(ValueType(cycle / 5), trace->termValueAt(xid, cycle));
+    EXPECT_EQ(trace->valueAt(bytes, cycle), trace->valueAt(bytes, cycle, bhint));
+    EXPECT_EQ(trace->termValueAt(bid, cycle),
+              ValueType(trace->valueAt(bytes, cycle).toVector()));
+  }
+}
+
+TEST(SignalHandleTest, LazyBindingMatchesDeclaredTrace) {
+  PVarMap varmap(new VarMap());
+  unsigned xid = varmap->addIntVar("x");
+  unsigned yid = varmap->addIntVar("y");
+  PHyperProp property = parse_formula("(G+ (IMPLIES (EQ x) (EQ y)))", varmap);
+
+  // trace1 binds its columns in write order (y first), trace2 from the map.
+  PTrace trace1(new Trace(0, 2));
+  PTrace trace2 = varmap->createTrace();
+  TraceList tracelist({trace1, trace2});
+
+  for (uint32_t cycle = 0; cycle < 30; ++cycle) {
+    uint32_t xvalue = rand() % 4;
+    uint32_t yvalue = rand() % 4;
+    trace1->updateTermValue(yid, cycle, yvalue);
+    trace1->updateTermValue(xid, cycle, xvalue);
+    trace2->updateValue(trace2->intSignal(xid), cycle, xvalue);
+    trace2->updateValue(trace2->intSignal(yid), cycle, yvalue);
+  }
+
+  EXPECT_EQ(*trace1, *trace2);
+  EXPECT_TRUE(evaluateTraces(property, tracelist));
+}
+
+TEST(SignalHandleTest, CaptureBoundFrame) {
+  // simulator state laid out as a plain struct.
+  struct SimState {
+    bool valid[3];
+    uint32_t regs[40];
+    uint32_t mem[8];
+  } sim;
+  memset(&sim, 0, sizeof(sim));
+
+  PVarMap varmap(new VarMap());
+  for (unsigned p = 0; p < 3; ++p) varmap->addPropVar("valid" + std::to_string(p));
+  for (unsigned r = 0; r < 40; ++r) varmap->addIntVar("r" + std::to_string(r));
+  unsigned memid = varmap->addArrayVar("mem", 8);
+
+  PTrace captured = varmap->createTrace();
+  PTrace expected = varmap->createTrace();
+
+  for (unsigned p = 0; p < 3; ++p) captured->bindProp(p, &sim.valid[p]);
+  for (unsigned r = 0; r < 40; ++r) {
+    captured->bindTerm(captured->intSignal(r), &sim.regs[r]);
+  }
+  captured->bindArray(captured->arraySignal(memid), sim.mem);
+
+  for (uint32_t cycle = 0; cycle < 200; ++cycle) {
+    if (rand() % 4 == 0) sim.valid[rand() % 3] ^= true;
+    if (rand() % 2 == 0) sim.regs[rand() % 40] = rand() % 16;
+    if (rand() % 8 == 0) sim.mem[rand() % 8] = rand();
+
+    captured->captureCycle(cycle);
+
+    for (unsigned p = 0; p < 3; ++p) expected->updatePropValue(p, cycle, sim.valid[p]);
+    for (unsigned r = 0; r < 40; ++r) expected->updateTermValue(r, cycle, sim.regs[r]);
+    expected->updateArrayValue(memid, cycle, ArrayView(sim.mem, 8));
+  }
+
+  EXPECT_EQ(*expected, *captured);
+}
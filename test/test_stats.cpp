@@ -0,0 +1,71 @@
+#include <gtest/gtest.h>
+
+#include "testutils.h"
+
+using namespace HyperPLTL;
+
+TEST(TraceStatsTest, SignalStatistics) {
+  PVarMap varmap(new VarMap());
+  unsigned pid = varmap->addPropVar("valid");
+  unsigned cid = varmap->addIntVar("config");
+  unsigned mid = varmap->addArrayVar("mem", 4);
+
+  PTrace trace = varmap->createTrace();
+  std::vector<uint32_t> mem(4, 0);
+  const uint32_t cycles = 10000;
+
+  for (uint32_t cycle = 0; cycle < cycles; ++cycle) {
+    if (cycle % 100 == 0) mem[0] = cycle;
+    trace->updatePropValue(pid, cycle, (cycle / 1000) % 2);
+    trace->updateTermValue(cid, cycle, 3);
+    trace->updateArrayValue(mid, cycle, mem);
+  }
+  trace->seal(cycles - 1);
+
+  SignalStats valid = trace->propStats(pid);
+  EXPECT_EQ(valid.changes, 10u);
+  EXPECT_EQ(valid.cycles, cycles);
+  EXPECT_EQ(valid.expandedBytes, cycles * sizeof(bool));
+  EXPECT_DOUBLE_EQ(valid.density(), 0.001);
+  EXPECT_GT(valid.compressionRatio(), 100);
+
+  SignalStats config = trace->termStats(cid);
+  EXPECT_EQ(config.changes, 1u);
+  // one datapoint, in one page of times and one of values.
+  EXPECT_EQ(config.bytes, 2 * sizeof(uint32_t) + 2 * sizeof(void*));
+
+  SignalStats memStats = trace->termStats(mid);
+  EXPECT_EQ(memStats.changes, 100u);
+  EXPECT_EQ(memStats.bytes, 100 * 5 * sizeof(uint32_t) + 2 * sizeof(void*));
+  EXPECT_EQ(memStats.expandedBytes, sizeof(uint32_t) * (1 + 4 * cycles));
+
+  size_t columns = valid.bytes + config.bytes + memStats.bytes;
+  EXPECT_GT(trace->memoryUsage(), columns);
+  EXPECT_LT(trace->memoryUsage(), columns + 1024);
+}
+
+TEST(TraceStatsTest, ExpandedSizeMatchesSerializer) {
+  PTrace trace(new Trace(2, 2));
+  std::vector<uint32_t> arr(3, 0);
+  for (uint32_t cycle = 0; cycle < 50; ++cycle) {
+    randomizeVecData(arr);
+    trace->updatePropValue(0, cycle, rand() % 2);
+    trace->updatePropValue(1, cycle, true);
+    trace->updateTermValue(0, cycle, uint32_t(rand()));
+    trace->updateTermValue(1, cycle, arr);
+  }
+
+  size_t expanded = 4 * sizeof(uint32_t);
+  for (unsigned i = 0; i < trace->numProps(); ++i) {
+    expanded += trace->propStats(i).expandedBytes;
+  }
+  for (unsigned i = 0; i < trace->numVars(); ++i) {
+    expanded += trace->termStats(i).expandedBytes;
+  }
+
+  size_t byteSize = TraceSerialize::getByteSize(trace);
+  EXPECT_EQ(expanded, byteSize);
+
+  std::vector<uint8_t> buffer(byteSize);
+  EXPECT_EQ(TraceSerialize::store(buffer.data(), trace), byteSize);
+}
@@ -204,3 +204,61 @@ TEST(PropertyLibTest, ValidTracePropTermArray_Test3) {
   result = evaluateTraces(property, tracelist);
   EXPECT_FALSE(result);
 }
+
+TEST(PropertyLibTest, DeclaredArrayVarViews) {
+  std::string propstr = "(G+ (EQ bytes))";
+  PVarMap varmap(new VarMap());
+  unsigned vi = varmap->addArrayVar("bytes", 4);
+  PHyperProp property = parse_formula(propstr, varmap);
+
+  PTrace trace1 = varmap->createTrace();
+  PTrace trace2 = varmap->createTrace();
+  TraceList tracelist({trace1, trace2});
+
+  std::vector<std::vector<uint32_t>> values;
+  std::vector<uint32_t> arrval(4);
+
+  for (uint32_t cycle = 0; cycle < 50; ++cycle) {
+    if (rand() % 3 == 0) randomizeVecData(arrval);
+    trace1->updateArrayValue(vi, cycle, arrval);
+    trace2->updateTermValue(vi, cycle, arrval);
+    values.push_back(arrval);
+  }
+
+  EXPECT_TRUE(evaluateTraces(property, tracelist));
+
+  for (uint32_t cycle = 0; cycle < 50; ++cycle) {
+    ArrayView view = trace1->arrayValueAt(vi, cycle);
+    EXPECT_EQ(4u, view.size());
+    EXPECT_EQ(ArrayView(values[cycle]), view);
+    EXPECT_EQ(ValueType(values[cycle]), trace2->termValueAt(vi, cycle));
+  }
+
+  // a trace loaded back without the declaration holds the same values.
+  size_t memsize = TraceSerialize::getByteSize(trace1);
+  std::vector<uint8_t> mem(memsize);
+  TraceSerialize::store(mem.data(), trace1);
+  EXPECT_EQ(*TraceSerialize::load(mem.data()), *trace1);
+}
+
+TEST(PropertyLibTest, UpdateFromOwnViews) {
+  // values read back from the trace itself, while its storage grows.
+  for (uint32_t dim : {0u, 3u}) {
+    Trace trace(0, 1);
+    trace.declareArrayVar(0, dim);
+    std::vector<std::vector<uint32_t>> values;
+    for (uint32_t cycle = 0; cycle < 3000; ++cycle) {
+      if (cycle < 2) {
+        values.push_back({cycle, cycle + 1, cycle + 2});
+        trace.updateArrayValue(0, cycle, values.back());
+      } else {
+        values.push_back(values[cycle - 2]);
+        trace.updateArrayValue(0, cycle, trace.arrayValueAt(0, cycle - 2));
+      }
+    }
+    for (uint32_t cycle = 0; cycle < 3000; ++cycle) {
+      ASSERT_EQ(trace.arrayValueAt(0, cycle).toVector(), values[cycle]) << cycle;
+    }
+  }
+  EXPECT_EQ(ArrayView(), ArrayView(nullptr, 0));
+}
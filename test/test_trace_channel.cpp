@@ -0,0 +1,140 @@
+#include <gtest/gtest.h>
+
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "testutils.h"
+#include "trace_channel.h"
+
+using namespace HyperPLTL;
+
+namespace {
+
+PTrace makeTrace(uint32_t seed, uint32_t cycles) {
+  PTrace trace(new Trace(1, 1));
+  for (uint32_t cycle = 0; cycle < cycles; ++cycle) {
+    trace->updatePropValue(0, cycle, (cycle + seed) % 5 == 0);
+    trace->updateTermValue(0, cycle, seed + cycle / 10);
+  }
+  trace->seal(cycles - 1);
+  return trace;
+}
+
+std::string channelName(const char* tag) {
+  return "/libprop_" + std::string(tag) + "_" + std::to_string(getpid());
+}
+
+}  // namespace
+
+TEST(TraceChannelTest, RingSlots) {
+  const std::string name = channelName("ring");
+  TraceChannel writer(name, 2, 1 << 16);
+  ASSERT_TRUE(writer.good());
+  TraceChannel reader(name);
+  ASSERT_TRUE(reader.good());
+  EXPECT_EQ(reader.numSlots(), 2u);
+  EXPECT_FALSE(TraceChannel(name + "_none").good());
+
+  EXPECT_EQ(reader.acquire(0), nullptr);
+  ASSERT_TRUE(writer.publish(*makeTrace(0, 100)));
+  ASSERT_TRUE(writer.publish(*makeTrace(1, 100)));
+  EXPECT_FALSE(writer.publish(*makeTrace(2, 100000)));
+  EXPECT_EQ(reader.published(), 2u);
+
+  // a held view keeps its slot from being reused, and the writer fills the
+  // other slot instead.
+  PTraceView first = reader.acquire(0);
+  ASSERT_NE(first, nullptr);
+  ASSERT_TRUE(writer.publish(*makeTrace(2, 100)));
+  EXPECT_EQ(reader.acquire(1), nullptr);
+  EXPECT_EQ(reader.oldest(), 2u);
+  PTraceView third = reader.acquire(2);
+  ASSERT_NE(third, nullptr);
+  EXPECT_FALSE(writer.publish(*makeTrace(3, 100)));
+  EXPECT_TRUE(*first == *makeTrace(0, 100));
+  EXPECT_TRUE(*third == *makeTrace(2, 100));
+  first.reset();
+  ASSERT_TRUE(writer.publish(*makeTrace(3, 100)));
+
+  // the first trace has been replaced by the fourth.
+  EXPECT_EQ(reader.oldest(), 2u);
+  EXPECT_EQ(reader.acquire(0), nullptr);
+  EXPECT_TRUE(*reader.acquire(3) == *makeTrace(3, 100));
+  EXPECT_FALSE(reader.isClosed());
+  writer.close();
+  EXPECT_TRUE(reader.isClosed());
+}
+
+TEST(TraceChannelTest, CheckerProcess) {
+  const std::string name = channelName("proc");
+  const unsigned count = 20;
+  TraceChannel writer(name, 4, 1 << 16);
+  ASSERT_TRUE(writer.good());
+
+  // the checker runs in a child process and exits with the number of traces
+  // on which the property did not hold. It skips the traces it fell too far
+  // behind to read.
+  const pid_t pid = fork();
+  ASSERT_GE(pid, 0);
+  if (pid == 0) {
+    TraceChannel channel(name);
+    if (!channel.good()) _exit(100);
+    PVarMap varmap = std::make_shared<VarMap>();
+    varmap->addPropVar("p");
+    varmap->addIntVar("x");
+    PHyperProp property = parse_formula("(G+ (IMPLIES p.0 (EQ x)))", varmap);
+    int failures = 0;
+    for (uint64_t seq = 0; seq < count;) {
+      seq = std::max(seq, channel.oldest());
+      PTraceView trace = channel.acquire(seq);
+      if (!trace) continue;
+      if (!evaluateTraces(property, {trace, trace})) ++failures;
+      ++seq;
+    }
+    _exit(failures);
+  }
+
+  for (unsigned k = 0; k < count;) {
+    if (writer.publish(*makeTrace(k, 1000))) ++k;
+  }
+  writer.close();
+  int status;
+  ASSERT_EQ(waitpid(pid, &status, 0), pid);
+  ASSERT_TRUE(WIFEXITED(status));
+  EXPECT_EQ(WEXITSTATUS(status), 0);
+}
+
+TEST(TraceChannelTest, KilledReader) {
+  const std::string name = channelName("killed");
+  TraceChannel writer(name, 1, 1 << 16);
+  ASSERT_TRUE(writer.good());
+  ASSERT_TRUE(writer.publish(*makeTrace(0, 100)));
+
+  // the reader holds a view of the only slot until it is killed.
+  int ready[2];
+  ASSERT_EQ(pipe(ready), 0);
+  const pid_t pid = fork();
+  ASSERT_GE(pid, 0);
+  if (pid == 0) {
+    TraceChannel channel(name);
+    PTraceView trace = channel.good() ? channel.acquire(0) : nullptr;
+    const char held = trace != nullptr;
+    if (write(ready[1], &held, 1) != 1) _exit(1);
+    for (;;) pause();
+  }
+  char held = 0;
+  ASSERT_EQ(read(ready[0], &held, 1), 1);
+  close(ready[0]);
+  close(ready[1]);
+  ASSERT_TRUE(held);
+  EXPECT_FALSE(writer.publish(*makeTrace(1, 100)));
+
+  kill(pid, SIGKILL);
+  int status;
+  ASSERT_EQ(waitpid(pid, &status, 0), pid);
+  ASSERT_TRUE(WIFSIGNALED(status));
+  ASSERT_TRUE(writer.publish(*makeTrace(1, 100)));
+  TraceChannel reader(name);
+  EXPECT_TRUE(*reader.acquire(1) == *makeTrace(1, 100));
+}
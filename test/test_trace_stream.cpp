@@ -0,0 +1,173 @@
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <filesystem>
+
+#include "trace_stream.h"
+
+namespace {
+
+/// Record the same random signals into a trace and a stream writer.
+void record(Trace& trace, TraceWriter& writer, uint32_t cycles) {
+  std::vector<uint32_t> mem(2, 0);
+  bool busy = false;
+  for (uint32_t cycle = 0; cycle < cycles; ++cycle) {
+    if (rand() % 3 == 0) busy = !busy;
+    if (cycle % 37 == 0) mem[rand() % 2] = rand() % 5;
+    trace.updatePropValue(0, cycle, busy);
+    writer.updatePropValue(0, cycle, busy);
+    if (cycle % 500 == 0) {
+      trace.updatePropValue(1, cycle, cycle % 1000 == 0);
+      writer.updatePropValue(1, cycle, cycle % 1000 == 0);
+    }
+    if (cycle % 7 == 0) {
+      trace.updateTermValue(0, cycle, cycle / 50);
+      writer.updateTermValue(0, cycle, cycle / 50);
+    }
+    trace.updateArrayValue(1, cycle, mem);
+    writer.updateArrayValue(1, cycle, mem);
+  }
+}
+
+void expectRange(const TraceReader& reader, const Trace& trace, uint32_t first,
+                 uint32_t last) {
+  PTrace range = reader.read(first, last);
+  ASSERT_EQ(range->length(), last - first + 1);
+  for (uint32_t cycle = first; cycle <= last; ++cycle) {
+    ASSERT_EQ(range->propValueAt(0, cycle - first), trace.propValueAt(0, cycle));
+    ASSERT_EQ(range->propValueAt(1, cycle - first), trace.propValueAt(1, cycle));
+    ASSERT_EQ(range->termValueAt(0, cycle - first), trace.termValueAt(0, cycle));
+    ASSERT_EQ(range->arrayValueAt(1, cycle - first), trace.arrayValueAt(1, cycle));
+  }
+}
+
+}  // namespace
+
+TEST(TraceStreamTest, ReadRanges) {
+  const std::string path = testing::TempDir() + "libprop_stream_test.trace";
+  const uint32_t cycles = 10000;
+  Trace trace(2, 3);
+  {
+    TraceWriter writer(path, 2, 3, 1024);
+    writer.declareArrayVar(1, 2);
+    trace.declareArrayVar(1, 2);
+    record(trace, writer, cycles);
+    writer.close(cycles + 99);
+  }
+  trace.seal(cycles + 99);
+
+  TraceReader reader(path);
+  ASSERT_TRUE(reader.good());
+  EXPECT_TRUE(reader.isComplete());
+  EXPECT_EQ(reader.numChunks(), 10u);
+  EXPECT_EQ(reader.length(), cycles + 100);
+  EXPECT_EQ(reader.getChunk(3).firstCycle, 3072u);
+  EXPECT_EQ(TermKind::NONE, reader.read(0, 10)->termKind(2));
+
+  expectRange(reader, trace, 0, cycles + 99);
+  expectRange(reader, trace, 1023, 1024);
+  expectRange(reader, trace, 5000, 5000);
+  for (int k = 0; k < 20; ++k) {
+    uint32_t first = rand() % cycles;
+    uint32_t last = std::min<uint32_t>(first + rand() % 3000, cycles + 99);
+    expectRange(reader, trace, first, last);
+  }
+
+  // a whole trace appended in blocks reads back the same.
+  {
+    TraceWriter writer(path, 2, 3, 1000);
+    writer.declareArrayVar(1, 2);
+    for (uint32_t first = 0; first < trace.length(); first += 2500) {
+      Trace block(2, 3);
+      const uint32_t last = std::min<uint32_t>(first + 2499, trace.length() - 1);
+      block.copyCycles(trace, first, last, 0);
+      writer.append(block);
+    }
+  }
+  TraceReader appended(path);
+  EXPECT_TRUE(appended.isComplete());
+  EXPECT_EQ(appended.length(), trace.length());
+  expectRange(appended, trace, 0, trace.length() - 1);
+  std::remove(path.c_str());
+}
+
+TEST(TraceStreamTest, ReadWhileWriting) {
+  const std::string path = testing::TempDir() + "libprop_stream_partial.trace";
+  Trace trace(2, 2);
+  TraceWriter writer(path, 2, 2, 256);
+  record(trace, writer, 1000);
+
+  // the chunks written so far can be read before the file is closed.
+  TraceReader reader(path);
+  ASSERT_TRUE(reader.good());
+  EXPECT_FALSE(reader.isComplete());
+  EXPECT_EQ(reader.numChunks(), 3u);
+  expectRange(reader, trace, 100, 767);
+
+  writer.close(999);
+  reader.refresh();
+  EXPECT_TRUE(reader.isComplete());
+  EXPECT_EQ(reader.length(), 1000u);
+  expectRange(reader, trace, 700, 999);
+
+  EXPECT_FALSE(TraceReader(testing::TempDir() + "libprop_no_such.trace").good());
+  std::remove(path.c_str());
+}
+
+TEST(TraceStreamTest, DamagedFiles) {
+  const std::string path = testing::TempDir() + "libprop_stream_damaged.trace";
+  Trace trace(2, 2);
+  {
+    TraceWriter writer(path, 2, 2, 256);
+    record(trace, writer, 1000);
+    writer.close(999);
+  }
+  trace.seal(999);
+  auto patch = [&](uint64_t offset, const void* bytes, size_t size) {
+    std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+    file.seekp(offset);
+    file.write(static_cast<const char*>(bytes), size);
+  };
+  const uint64_t size = std::filesystem::file_size(path);
+  TraceReader reader(path);
+  ASSERT_TRUE(reader.isComplete());
+  const TraceChunk chunk = reader.getChunk(1);
+  // the index entry of chunk 1, before the 16-byte footer.
+  const uint64_t entry = size - 16 - (reader.numChunks() - 1) * sizeof(TraceChunk);
+
+  // an index entry past the end of the file, or of no cycles, is not trusted:
+  // the chunks are found by walking their headers instead.
+  TraceChunk bad = chunk;
+  bad.offset = size;
+  patch(entry, &bad, sizeof(bad));
+  TraceReader pastEnd(path);
+  EXPECT_FALSE(pastEnd.isComplete());
+  EXPECT_EQ(pastEnd.length(), 1000u);
+  expectRange(pastEnd, trace, 0, 999);
+  bad = chunk;
+  bad.lastCycle = bad.firstCycle - 1;
+  patch(entry, &bad, sizeof(bad));
+  TraceReader empty(path);
+  EXPECT_FALSE(empty.isComplete());
+  expectRange(empty, trace, 0, 999);
+
+  // a chunk whose header declares no cycles cannot be read, and the walk
+  // stops before it.
+  patch(entry, &chunk, sizeof(chunk));
+  const uint32_t zero = 0;
+  patch(chunk.offset + 16, &zero, sizeof(zero));
+  TraceReader damaged(path);
+  EXPECT_TRUE(damaged.isComplete());
+  EXPECT_NE(damaged.read(0, 255), nullptr);
+  EXPECT_EQ(damaged.read(200, 300), nullptr);
+  patch(size - 4, &zero, sizeof(zero));
+  TraceReader walked(path);
+  EXPECT_FALSE(walked.isComplete());
+  EXPECT_EQ(walked.length(), chunk.firstCycle);
+
+  // a file cut after it was opened reads up to the cut.
+  std::filesystem::resize_file(path, chunk.offset + chunk.size / 2);
+  EXPECT_NE(reader.read(0, 255), nullptr);
+  EXPECT_EQ(reader.read(300, 400), nullptr);
+  std::remove(path.c_str());
+}
@@ -0,0 +1,157 @@
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <fstream>
+#include <type_traits>
+
+#include "testutils.h"
+#include "trace_view.h"
+
+using namespace HyperPLTL;
+
+namespace {
+
+PTrace makeTrace(PVarMap varmap, uint32_t cycles) {
+  PTrace trace = varmap->createTrace();
+  std::vector<uint32_t> mem(3, 0);
+  bool busy = false;
+  for (uint32_t cycle = 0; cycle < cycles; ++cycle) {
+    if (rand() % 2) busy = !busy;
+    if (cycle % 40 == 0) mem[cycle % 3] = rand() % 4;
+    trace->updatePropValue(0, cycle, busy);
+    trace->updatePropValue(1, cycle, cycle % 700 < 350);
+    trace->updateTermValue(0, cycle, uint32_t(rand() % 2));
+    trace->updateArrayValue(1, cycle, mem);
+  }
+  trace->seal(cycles - 1);
+  return trace;
+}
+
+/// Store trace in the mapped format, in a buffer aligned for a view.
+std::vector<uint64_t> storeMapped(PTrace trace) {
+  size_t size = TraceSerialize::getByteSize(trace, TraceFormat::MAPPED);
+  std::vector<uint64_t> buffer((size + 7) / 8);
+  uint8_t* dest = reinterpret_cast<uint8_t*>(buffer.data());
+  EXPECT_EQ(TraceSerialize::store(dest, trace, TraceFormat::MAPPED), size);
+  return buffer;
+}
+
+}  // namespace
+
+TEST(TraceViewTest, ViewMatchesTrace) {
+  PTrace trace(new Trace(3, 4));
+  std::vector<uint32_t> ragged(1, 0);
+  for (uint32_t cycle = 0; cycle < 3000; ++cycle) {
+    if (cycle % 500 == 0) ragged.push_back(cycle);
+    trace->updatePropValue(0, cycle, rand() % 2);
+    trace->updatePropValue(1, cycle, cycle > 100);
+    trace->updateTermValue(0, cycle, uint32_t(cycle / 3));
+    trace->updateTermValue(1, cycle, std::vector<uint32_t>{cycle / 100, 1});
+    trace->updateTermValue(2, cycle, ragged);
+  }
+  // proposition 2 and term variable 3 are never recorded.
+
+  std::vector<uint64_t> buffer = storeMapped(trace);
+  const uint8_t* source = reinterpret_cast<const uint8_t*>(buffer.data());
+  EXPECT_EQ(TraceSerialize::getFormat(source), TraceFormat::MAPPED);
+
+  PTraceView view = std::make_shared<TraceView>(source);
+  EXPECT_TRUE(view->isSealed());
+  EXPECT_DEBUG_DEATH(view->extendToCycle(4000), "sealed");
+  // a view is destroyed through whatever Trace pointer owns it.
+  EXPECT_TRUE(std::has_virtual_destructor<Trace>::value);
+  delete static_cast<Trace*>(new TraceView(source));
+  EXPECT_EQ(view->length(), trace->length());
+  EXPECT_EQ(*view, *trace);
+  EXPECT_EQ(view->termKind(3), TermKind::NONE);
+
+  Trace::Cursor cursor = view->cursor();
+  for (uint32_t cycle = 0; cycle < 3000; ++cycle) {
+    ASSERT_EQ(cursor.propValueAt(0, cycle), trace->propValueAt(0, cycle));
+    ASSERT_EQ(cursor.termValueAt(0, cycle), trace->termValueAt(0, cycle));
+    ASSERT_EQ(view->arrayValueAt(1, cycle), trace->arrayValueAt(1, cycle));
+  }
+
+  // the view borrows its columns, only the page index is allocated.
+  EXPECT_LT(view->memoryUsage(), buffer.size() * sizeof(uint64_t) / 4);
+
+  // load() copies the columns into a trace that can be extended.
+  PTrace copy = TraceSerialize::load(reinterpret_cast<uint8_t*>(buffer.data()));
+  EXPECT_EQ(*copy, *trace);
+  copy->updatePropValue(1, 3000, false);
+  EXPECT_FALSE(copy->propValueAt(1, 3000));
+}
+
+TEST(TraceViewTest, EvaluateMappedFiles) {
+  PVarMap varmap(new VarMap());
+  varmap->addPropVar("busy");
+  varmap->addPropVar("phase");
+  varmap->addIntVar("x");
+  varmap->addArrayVar("mem", 3);
+  PHyperProp property =
+      parse_formula("(G+ (IMPLIES (AND phase.0 phase.1) (EQ mem)))", varmap);
+
+  srand(7);
+  PTrace t1 = makeTrace(varmap, 2000);
+  srand(8);
+  PTrace t2 = makeTrace(varmap, 2000);
+  bool expected = evaluateTraces(property, {t1, t2});
+
+  std::string path = testing::TempDir() + "libprop_view_test.trace";
+  std::vector<uint64_t> buffer = storeMapped(t2);
+  {
+    std::ofstream out(path, std::ios::binary);
+    out.write(reinterpret_cast<const char*>(buffer.data()),
+              buffer.size() * sizeof(uint64_t));
+  }
+
+  PTraceView view = TraceView::open(path);
+  ASSERT_NE(view, nullptr);
+  EXPECT_EQ(*view, *t2);
+  PHyperProp fresh =
+      parse_formula("(G+ (IMPLIES (AND phase.0 phase.1) (EQ mem)))", varmap);
+  EXPECT_EQ(evaluateTraces(fresh, {t1, view}), expected);
+
+  std::remove(path.c_str());
+  EXPECT_EQ(TraceView::open(path), nullptr);
+}
+
+TEST(TraceViewTest, RejectCorruptFiles) {
+  PVarMap varmap(new VarMap());
+  varmap->addPropVar("busy");
+  varmap->addPropVar("phase");
+  varmap->addIntVar("x");
+  varmap->addArrayVar("mem", 3);
+  const std::vector<uint64_t> good = storeMapped(makeTrace(varmap, 500));
+  const std::string path = testing::TempDir() + "libprop_view_corrupt.trace";
+  auto openBytes = [&](const void* data, size_t size) {
+    {
+      std::ofstream out(path, std::ios::binary | std::ios::trunc);
+      out.write(static_cast<const char*>(data), size);
+    }
+    return TraceView::open(path);
+  };
+  const size_t size = good.size() * sizeof(uint64_t);
+  EXPECT_NE(openBytes(good.data(), size), nullptr);
+
+  // a file that is no trace at all, whose first words are huge offsets.
+  const uint32_t garbage[16] = {0xFFFFFFF0, 0, 0, 0xFFFFFFFF};
+  EXPECT_EQ(openBytes(garbage, sizeof(garbage)), nullptr);
+
+  // a truncated file, and a trace in another format.
+  EXPECT_EQ(openBytes(good.data(), size / 2), nullptr);
+  PTrace trace = makeTrace(varmap, 500);
+  std::vector<uint8_t> changes(TraceSerialize::getByteSize(trace, TraceFormat::CHANGES));
+  TraceSerialize::store(changes.data(), trace, TraceFormat::CHANGES);
+  EXPECT_EQ(openBytes(changes.data(), changes.size()), nullptr);
+
+  // a directory entry and a record count that point past the end.
+  std::vector<uint64_t> bad = good;
+  bad[TraceSerialize::HEADER_SIZE / 8 + 1] = size + 8;
+  EXPECT_EQ(openBytes(bad.data(), size), nullptr);
+  bad = good;
+  const size_t record = good[TraceSerialize::HEADER_SIZE / 8 + 2] / 8;
+  reinterpret_cast<uint32_t*>(&bad[record])[2] = 0x7FFFFFFF;
+  EXPECT_EQ(openBytes(bad.data(), size), nullptr);
+  std::remove(path.c_str());
+}
@@ -30,3 +30,61 @@ TEST(PropertyLibTest, TestVarTrace) {
 
   EXPECT_EQ(3, vartr[6]);
 }
+
+TEST(PropertyLibTest, TestVarTraceCursor) {
+
+  VarTrace<unsigned> vartr;
+  std::vector<unsigned> expected;
+
+  for (unsigned cycle = 0; cycle < 500; ++cycle) {
+    unsigned value = (rand() % 4 == 0) ? rand() % 8 : (cycle ? expected.back() : 0);
+    vartr.updateValue(cycle, value);
+    expected.push_back(value);
+  }
+
+  // forward scan
+  auto fwd = vartr.cursor();
+  for (unsigned cycle = 0; cycle < 500; ++cycle) EXPECT_EQ(expected[cycle], fwd[cycle]);
+
+  // backward scan continuing from the end of the forward scan
+  for (int cycle = 499; cycle >= 0; --cycle) EXPECT_EQ(expected[cycle], fwd[cycle]);
+
+  // random jumps
+  auto rnd = vartr.cursor();
+  for (unsigned i = 0; i < 500; ++i) {
+    unsigned cycle = rand() % 500;
+    EXPECT_EQ(expected[cycle], rnd[cycle]);
+  }
+}
+
+TEST(PropertyLibTest, TestTraceCursor) {
+
+  Trace trace(1, 2);
+  std::vector<uint32_t> arrval(3);
+
+  for (uint32_t cycle = 0; cycle < 100; ++cycle) {
+    trace.updatePropValue(0, cycle, (cycle / 7) % 2);
+    trace.updateTermValue(0, cycle, cycle / 3);
+    arrval[cycle % 3] = cycle / 5;
+    trace.updateTermValue(1, cycle, arrval);
+  }
+
+  auto cursor = trace.cursor();
+  for (int cycle = trace.length() - 1; cycle >= 0; --cycle) {
+    EXPECT_EQ(trace.propValueAt(0, cycle), cursor.propValueAt(0, cycle));
+    EXPECT_EQ(trace.termValueAt(0, cycle), cursor.termValueAt(0, cycle));
+    EXPECT_EQ(trace.termValueAt(1, cycle), cursor.termValueAt(1, cycle));
+  }
+}
+
+TEST(PropertyLibTest, TestSearchChange) {
+
+  std::vector<uint32_t> times(1, 0);
+  for (unsigned i = 1; i < 1000; ++i) times.push_back(times.back() + 1 + rand() % 5);
+
+  for (uint32_t key = 0; key < times.back() + 10; ++key) {
+    size_t expected =
+        std::upper_bound(times.begin(), times.end(), key) - times.begin() - 1;
+    EXPECT_EQ(expected, searchChange(times.data(), times.size(), key));
+  }
+}
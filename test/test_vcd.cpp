@@ -0,0 +1,232 @@
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <sstream>
+
+#include "testutils.h"
+#include "trace_stream.h"
+#include "vcd_reader.h"
+
+using namespace HyperPLTL;
+
+namespace {
+
+const char* DUMP = R"($date today $end
+$timescale 1ns $end
+$scope module top $end
+$var wire 1 ! clk $end
+$var wire 1 " valid $end
+$var reg 4 # state [3:0] $end
+$var reg 40 $ wide [39:0] $end
+$scope module ram $end
+$var reg 8 % mem[0] $end
+$var reg 8 & mem[1] $end
+$upscope $end
+$var real 1 ' temp $end
+$upscope $end
+$enddefinitions $end
+#0
+$dumpvars
+0!
+0"
+bx #
+b0 $
+b0 %
+b0 &
+r0.5 '
+$end
+#5
+1!
+1"
+b11 #
+#10
+0!
+b101 %
+#15
+1!
+b1 #
+b1000000000000000000000000000000000000011 $
+#20
+0!
+0"
+b111 &
+#25
+1!
+#30
+0!
+)";
+
+}  // namespace
+
+TEST(VcdReaderTest, Declarations) {
+  std::istringstream in(DUMP);
+  PVarMap varmap(new VarMap());
+  VcdReader reader(in, varmap);
+  ASSERT_TRUE(reader.good());
+
+  EXPECT_TRUE(varmap->hasPropVar("top_clk"));
+  EXPECT_TRUE(varmap->hasPropVar("top_valid"));
+  EXPECT_TRUE(varmap->hasIntVar("top_state"));
+  EXPECT_EQ(varmap->getVarWidth(varmap->getVarIndex("top_state")), 4u);
+  EXPECT_TRUE(varmap->hasArrayVar("top_wide"));
+  EXPECT_EQ(varmap->getArrayDim(varmap->getVarIndex("top_wide")), 2u);
+  EXPECT_TRUE(varmap->hasArrayVar("top_ram_mem"));
+  EXPECT_EQ(varmap->getArrayDim(varmap->getVarIndex("top_ram_mem")), 2u);
+  EXPECT_EQ(varmap->getVarWidth(varmap->getVarIndex("top_ram_mem")), 8u);
+  EXPECT_FALSE(varmap->hasVar("top_temp"));
+
+  std::istringstream noclock(DUMP);
+  VcdOptions options;
+  options.clock = "top_missing";
+  EXPECT_FALSE(VcdReader(noclock, PVarMap(new VarMap()), options).good());
+}
+
+TEST(VcdReaderTest, TimestampCycles) {
+  std::istringstream in(DUMP);
+  PVarMap varmap(new VarMap());
+  VcdReader reader(in, varmap);
+  PTrace trace = reader.read();
+
+  // one cycle per timestamp, holding the values after its changes.
+  ASSERT_EQ(trace->length(), 7u);
+  const unsigned state = varmap->getVarIndex("top_state");
+  const unsigned valid = varmap->getPropIndex("top_valid");
+  const unsigned mem = varmap->getVarIndex("top_ram_mem");
+  const unsigned wide = varmap->getVarIndex("top_wide");
+  EXPECT_EQ(trace->termValueAt(state, 0), ValueType(0u));
+  EXPECT_EQ(trace->termValueAt(state, 1), ValueType(3u));
+  EXPECT_EQ(trace->termValueAt(state, 3), ValueType(1u));
+  EXPECT_FALSE(trace->propValueAt(valid, 0));
+  EXPECT_TRUE(trace->propValueAt(valid, 3));
+  EXPECT_FALSE(trace->propValueAt(valid, 4));
+  EXPECT_EQ(trace->arrayValueAt(mem, 2).toVector(), (std::vector<uint32_t>{5, 0}));
+  EXPECT_EQ(trace->arrayValueAt(mem, 6).toVector(), (std::vector<uint32_t>{5, 7}));
+  EXPECT_EQ(trace->arrayValueAt(wide, 3).toVector(), (std::vector<uint32_t>{3, 0x80}));
+}
+
+TEST(VcdReaderTest, ClockEdgeSampling) {
+  std::istringstream in(DUMP);
+  PVarMap varmap(new VarMap());
+  VcdOptions options;
+  options.clock = "top_clk";
+  VcdReader reader(in, varmap, options);
+  ASSERT_TRUE(reader.good());
+
+  // rising edges at 5, 15 and 25 sample the values just before them.
+  const std::string path = testing::TempDir() + "libprop_vcd_test.trace";
+  uint32_t cycles;
+  {
+    TraceWriter writer(path, varmap->numProps(), varmap->numVars(), 2);
+    cycles = reader.read(writer);
+    writer.close(cycles - 1);
+  }
+  EXPECT_EQ(cycles, 3u);
+
+  TraceReader stream(path);
+  PTrace trace = stream.read(0, cycles - 1);
+  const unsigned state = varmap->getVarIndex("top_state");
+  const unsigned mem = varmap->getVarIndex("top_ram_mem");
+  EXPECT_EQ(trace->termValueAt(state, 0), ValueType(0u));
+  EXPECT_EQ(trace->termValueAt(state, 1), ValueType(3u));
+  EXPECT_EQ(trace->termValueAt(state, 2), ValueType(1u));
+  EXPECT_TRUE(trace->propValueAt(varmap->getPropIndex("top_valid"), 1));
+  EXPECT_FALSE(trace->propValueAt(varmap->getPropIndex("top_valid"), 2));
+  EXPECT_EQ(trace->arrayValueAt(mem, 1).toVector(), (std::vector<uint32_t>{5, 0}));
+  EXPECT_EQ(trace->arrayValueAt(mem, 2).toVector(), (std::vector<uint32_t>{5, 7}));
+  std::remove(path.c_str());
+}
+
+TEST(VcdReaderTest, StreamMoreProps) {
+  // more propositions than term variables, written through a TraceWriter.
+  std::istringstream in(R"($scope module top $end
+$var wire 1 ! a $end
+$var wire 1 " b $end
+$var wire 1 # c $end
+$var reg 8 $ bus [7:0] $end
+$upscope $end
+$enddefinitions $end
+#0
+1!
+0"
+1#
+b10100101 $
+#1
+0!
+1"
+b11 $
+)");
+  PVarMap varmap(new VarMap());
+  VcdReader reader(in, varmap);
+  ASSERT_TRUE(reader.good());
+  ASSERT_EQ(varmap->numProps(), 3u);
+  ASSERT_EQ(varmap->numVars(), 1u);
+
+  const std::string path = testing::TempDir() + "libprop_vcd_props.trace";
+  uint32_t cycles;
+  {
+    TraceWriter writer(path, varmap->numProps(), varmap->numVars(), 2);
+    cycles = reader.read(writer);
+    writer.close(cycles - 1);
+  }
+  EXPECT_EQ(cycles, 2u);
+
+  PTrace trace = TraceReader(path).read(0, cycles - 1);
+  const unsigned bus = varmap->getVarIndex("top_bus");
+  EXPECT_EQ(trace->termWidth(bus), 8u);
+  EXPECT_EQ(trace->termValueAt(bus, 0), ValueType(0xa5u));
+  EXPECT_EQ(trace->termValueAt(bus, 1), ValueType(3u));
+  EXPECT_TRUE(trace->propValueAt(varmap->getPropIndex("top_a"), 0));
+  EXPECT_FALSE(trace->propValueAt(varmap->getPropIndex("top_a"), 1));
+  EXPECT_TRUE(trace->propValueAt(varmap->getPropIndex("top_b"), 1));
+  EXPECT_TRUE(trace->propValueAt(varmap->getPropIndex("top_c"), 1));
+  std::remove(path.c_str());
+}
+
+TEST(VcdReaderTest, RangedMemoryWords) {
+  // memory words as Icarus and VCS dump them, with an index and a bit range.
+  const char* dump = R"($scope module top $end
+$var reg 8 ! mem[0] [7:0] $end
+$var reg 8 " mem[1] [7:0] $end
+$var reg 8 # mem [2] [7:0] $end
+$var reg 4 $ bus [3:0] $end
+$upscope $end
+$enddefinitions $end
+#0
+b1 !
+b10 "
+b11 #
+b1111 $
+#1
+b11111111 "
+)";
+  std::istringstream in(dump);
+  PVarMap varmap(new VarMap());
+  VcdReader reader(in, varmap);
+  ASSERT_TRUE(reader.good());
+  ASSERT_TRUE(varmap->hasArrayVar("top_mem"));
+  const unsigned mem = varmap->getVarIndex("top_mem");
+  EXPECT_EQ(varmap->getArrayDim(mem), 3u);
+  EXPECT_EQ(varmap->getVarWidth(mem), 8u);
+  EXPECT_TRUE(varmap->hasIntVar("top_bus"));
+
+  PTrace trace = reader.read();
+  ASSERT_EQ(trace->length(), 2u);
+  EXPECT_EQ(trace->arrayValueAt(mem, 0).toVector(), (std::vector<uint32_t>{1, 2, 3}));
+  EXPECT_EQ(trace->arrayValueAt(mem, 1).toVector(), (std::vector<uint32_t>{1, 255, 3}));
+}
+
+TEST(VcdReaderTest, NameCollisions) {
+  // a memory and a bus of the same name.
+  std::istringstream both(R"($var reg 8 ! m[0] $end
+$var reg 8 " m $end
+$enddefinitions $end
+)");
+  EXPECT_FALSE(VcdReader(both, PVarMap(new VarMap())).good());
+
+  // a name the VarMap already holds with another type.
+  PVarMap varmap(new VarMap());
+  varmap->addIntVar("top_clk");
+  std::istringstream in(DUMP);
+  EXPECT_FALSE(VcdReader(in, varmap).good());
+  EXPECT_EQ(varmap->numProps(), 0u);
+}
@@ -48,3 +48,60 @@ void newRandomVecData(std::vector<uint32_t>& vec) {
     }
   }
 }
+
+std::string randomFormula(unsigned depth, unsigned numTraces) {
+  const char* props[] = {"p", "q"};
+  const char* unary[] = {"NOT", "G+", "G-", "X+", "X-", "F+", "F-"};
+  const char* binary[] = {"AND", "OR", "IMPLIES", "U"};
+  const unsigned choice = depth == 0 ? rand() % 2 : rand() % 5;
+  switch (choice) {
+    case 0:
+      return std::string(props[rand() % 2]) + "." + std::to_string(rand() % numTraces);
+    case 1:
+      return rand() % 2 ? "(EQ x)" : "(EQ m)";
+    case 2:
+    case 3:
+      return "(" + std::string(unary[rand() % 7]) + " " +
+             randomFormula(depth - 1, numTraces) + ")";
+    default: {
+      const char* op = binary[rand() % 4];
+      std::string f = "(" + std::string(op) + " " + randomFormula(depth - 1, numTraces) +
+                      " " + randomFormula(depth - 1, numTraces);
+      if (op[0] != 'I' && op[0] != 'U' && rand() % 2) {
+        f += " " + randomFormula(depth - 1, numTraces);
+      }
+      return f + ")";
+    }
+  }
+}
+
+HyperPLTL::PVarMap makeRandomVarMap() {
+  HyperPLTL::PVarMap varmap = std::make_shared<HyperPLTL::VarMap>();
+  varmap->addPropVar("p");
+  varmap->addPropVar("q");
+  varmap->addIntVar("x", 8);
+  varmap->addArrayVar("m", 2, 8);
+  return varmap;
+}
+
+void appendRandomCycle(TraceList& traces, uint32_t cycle, RandomOdds odds) {
+  for (auto& trace : traces) {
+    std::vector<uint32_t> m(2, 0);
+    if (cycle > 0) m = trace->valueAt(trace->arraySignal(1), cycle - 1).toVector();
+    if (rand() % odds.m == 0) m[rand() % 2] = rand() % 2;
+    trace->updatePropValue(0, cycle, rand() % odds.p != 0);
+    trace->updatePropValue(1, cycle, rand() % odds.q == 0);
+    trace->updateTermValue(0, cycle, uint32_t(rand() % odds.x != 0));
+    trace->updateArrayValue(1, cycle, m);
+  }
+}
+
+PTrace makeRandomTrace(HyperPLTL::PVarMap varmap, uint32_t cycles,
+                       RandomOdds odds) {
+  TraceList traces = {varmap->createTrace()};
+  for (uint32_t cycle = 0; cycle < cycles; ++cycle) {
+    appendRandomCycle(traces, cycle, odds);
+  }
+  traces[0]->seal(cycles - 1);
+  return traces[0];
+}
@@ -98,4 +98,29 @@ namespace HyperPLTL {
 std::string parse_and_regen_string(std::string const& str);
 }  // namespace HyperPLTL
 
+// random formula text of the given depth over propositions p and q, integer
+// variable x and array variable m, selecting among numTraces traces.
+std::string randomFormula(unsigned depth, unsigned numTraces);
+
+// variable map of the formulas randomFormula() returns: propositions p and q,
+// 8-bit integer variable x and array variable m of two 8-bit words.
+HyperPLTL::PVarMap makeRandomVarMap();
+
+// how rarely appendRandomCycle() records each unusual value, once in so many
+// cycles on average: p false, q true, x 0 and a change to a word of m.
+struct RandomOdds {
+  unsigned p = 3;
+  unsigned q = 4;
+  unsigned x = 2;
+  unsigned m = 8;
+};
+
+// record cycle of random values of the variables of makeRandomVarMap() in
+// each of traces.
+void appendRandomCycle(TraceList& traces, uint32_t cycle, RandomOdds odds = {});
+
+// sealed trace of cycles random cycles, see appendRandomCycle().
+PTrace makeRandomTrace(HyperPLTL::PVarMap varmap, uint32_t cycles,
+                       RandomOdds odds = {});
+
 #endif